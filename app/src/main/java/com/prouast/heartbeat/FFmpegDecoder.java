@@ -0,0 +1,50 @@
+package com.prouast.heartbeat;
+
+/**
+ * Reads recordings written by FFmpegEncoder back as NV21 frames with their original timestamps.
+ */
+public class FFmpegDecoder {
+
+    public FFmpegDecoder() {
+        self = _initialise();
+    }
+
+    /**
+     * Open a video file and start decoding ahead.
+     * @param filename the file
+     * @param poolSize number of frames decoded ahead
+     * @return false if the file could not be opened
+     */
+    public boolean openFile(String filename, int poolSize) {
+        return _openFile(self, filename, poolSize);
+    }
+
+    public int getWidth() {
+        return _getWidth(self);
+    }
+
+    public int getHeight() {
+        return _getHeight(self);
+    }
+
+    /**
+     * Read the next frame.
+     * @param dataAddr address of a buffer of width x height * 3/2 bytes receiving the NV21 frame
+     * @return the timestamp the frame was written with, or -1 at the end of the file
+     */
+    public long readFrame(long dataAddr) {
+        return _readFrame(self, dataAddr);
+    }
+
+    public void closeFile() {
+        _closeFile(self);
+    }
+
+    private long self = 0;
+    private static native long _initialise();
+    private static native boolean _openFile(long self, String filename, int poolSize);
+    private static native int _getWidth(long self);
+    private static native int _getHeight(long self);
+    private static native long _readFrame(long self, long dataAddr);
+    private static native void _closeFile(long self);
+}
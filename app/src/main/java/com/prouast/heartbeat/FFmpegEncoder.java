@@ -2,25 +2,59 @@ package com.prouast.heartbeat;
 
 public class FFmpegEncoder {
 
+    /**
+     * Encoder threading modes, ordinals match the libavcodec FF_THREAD_* bitmask.
+     */
+    public enum ThreadType {
+        NONE, FRAME, SLICE, FRAME_AND_SLICE
+    }
+
     public FFmpegEncoder() {
         self = _initialise();
     }
 
-    public boolean openFile(String filename, int width, int height, int bitrate, int framerate) {
-        return _openFile(self, filename, width, height, bitrate, framerate);
+    /**
+     * Open a video file.
+     * @param cropWidth width of the window around the face to record, 0 records full frames.
+     *                  The window origin of each frame is written to filename.crop.csv, keyed by pts.
+     * @param cropHeight height of the window around the face to record
+     * @param lossless encode losslessly, ignoring bitrate
+     */
+    public boolean openFile(String filename, int width, int height, int bitrate, int framerate,
+                            int threads, ThreadType threadType, int gopSize, String preset,
+                            int cropWidth, int cropHeight, boolean lossless) {
+        return _openFile(self, filename, width, height, bitrate, framerate, threads, threadType.ordinal(), gopSize, preset, cropWidth, cropHeight, lossless);
+    }
+
+    /**
+     * Update the face box the crop window follows.
+     */
+    public void setCropBox(int x, int y, int width, int height) {
+        _setCropBox(self, x, y, width, height);
     }
 
     public void writeFrame(long dataAddr, long time) {
         _writeFrame(self, dataAddr, time);
     }
 
+    /**
+     * Write a camera-native NV21 frame without converting it to RGBA first.
+     * @param dataAddr address of the NV21 buffer (Y plane followed by interleaved VU)
+     * @param time timestamp
+     */
+    public void writeFrameNV21(long dataAddr, long time) {
+        _writeFrameNV21(self, dataAddr, time);
+    }
+
     public void closeFile() {
         _closeFile(self);
     }
 
     private long self = 0;
     private static native long _initialise();
-    private static native boolean _openFile(long self, String filename, int width, int height, int bitrate, int framerate);
+    private static native boolean _openFile(long self, String filename, int width, int height, int bitrate, int framerate, int threads, int threadType, int gopSize, String preset, int cropWidth, int cropHeight, boolean lossless);
+    private static native void _setCropBox(long self, int x, int y, int width, int height);
     private static native void _writeFrame(long self, long dataAddr, long time);
+    private static native void _writeFrameNV21(long self, long dataAddr, long time);
     private static native void _closeFile(long self);
 }
\ No newline at end of file
@@ -7,12 +7,14 @@ import org.opencv.android.CameraBridgeViewBase.CvCameraViewFrame;
 import org.opencv.android.CameraBridgeViewBase.CvCameraViewListener2;
 import org.opencv.android.LoaderCallbackInterface;
 import org.opencv.android.OpenCVLoader;
+import org.opencv.core.CvType;
 import org.opencv.core.Mat;
 
 import android.app.AlertDialog;
 import android.content.Context;
 import android.content.DialogInterface;
 import android.content.Intent;
+import android.content.pm.PackageManager;
 import android.graphics.Color;
 import android.support.v7.app.AppCompatActivity;
 import android.os.Bundle;
@@ -38,15 +40,40 @@ public class Main extends AppCompatActivity implements CvCameraViewListener2, RP
 
     /* Settings */
     private static final RPPG.RPPGAlgorithm ALGORITHM = RPPG.RPPGAlgorithm.g;
+    private static final boolean COMPARE_ALGORITHMS = false;
     private static final double SAMPLING_FREQUENCY = 1;
     private static final double RESCAN_FREQUENCY = 1;
+    private static final double MIN_TRACKING_CONFIDENCE = 0;
     private static final double TIME_BASE = 0.001;
     private static final int MIN_SIGNAL_SIZE = 2;
     private static final int MAX_SIGNAL_SIZE = 6;
+    private static final double MIN_SIGNAL_QUALITY = 0;
+    private static final RPPG.RPPGSpectrum SPECTRUM = RPPG.RPPGSpectrum.fft;
+    private static final int SPECTRAL_ZOOM = 4;
+    private static final int WELCH_LENGTH = 0;
+    private static final double[] QUANTILES = {0.25, 0.75};
+    private static final boolean SINGLE_PRECISION = false;
+    private static final boolean MOTION_COMPENSATION = false;
+    private static final int GRID_SIZE = 0;
+    private static final boolean SKIN_DETECTION = false;
+    private static final int MAX_FACES = 1;
+    private static final int THREADS = 0;
+    private static final boolean EYES = false;
     private static final boolean LOG = false;
     private static final boolean VIDEO = false;
     private static final boolean GUI = true;
+    private static final boolean NV21 = false;
     private static final int VIDEO_BITRATE = 100000;
+    private static final int VIDEO_THREADS = Runtime.getRuntime().availableProcessors();
+    private static final FFmpegEncoder.ThreadType VIDEO_THREAD_TYPE = FFmpegEncoder.ThreadType.FRAME;
+    private static final int VIDEO_GOP_SIZE = 30;
+    private static final String VIDEO_PRESET = "ultrafast";
+    private static final boolean VIDEO_CROP = false;
+    private static final int VIDEO_CROP_WIDTH = 320;
+    private static final int VIDEO_CROP_HEIGHT = 320;
+    private static final boolean VIDEO_LOSSLESS = false;
+    private static final boolean REPLAY = false;
+    private static final int REPLAY_POOL_SIZE = 8;
 
     /* Constants */
     private static final String TAG = "Heartbeat::Main";
@@ -63,6 +90,7 @@ public class Main extends AppCompatActivity implements CvCameraViewListener2, RP
 
     private FFmpegEncoder encoder;
     private File videoFile;
+    private int[] faceBox = new int[4];
 
     private RPPGNetworkClient client = null;
     private String serverAddress = null;
@@ -81,7 +109,11 @@ public class Main extends AppCompatActivity implements CvCameraViewListener2, RP
 
                     rPPG = new RPPG();
 
-                    mOpenCvCameraView.enableView();
+                    if (REPLAY) {
+                        startReplay();
+                    } else {
+                        mOpenCvCameraView.enableView();
+                    }
                 } break;
                 default:
                 {
@@ -93,8 +125,19 @@ public class Main extends AppCompatActivity implements CvCameraViewListener2, RP
 
     private String loadCascadeFile(File cascadeDir, int id, String filename) throws IOException {
 
-        InputStream is = getResources().openRawResource(id);
         File cascadeFile = new File(cascadeDir, filename);
+
+        // Copy once per install, the native side keeps a binary cascade converted from this file
+        try {
+            long updateTime = getPackageManager().getPackageInfo(getPackageName(), 0).lastUpdateTime;
+            if (cascadeFile.lastModified() > updateTime) {
+                return cascadeFile.getAbsolutePath();
+            }
+        } catch (PackageManager.NameNotFoundException e) {
+            Log.w(TAG, "Could not get install time: " + e);
+        }
+
+        InputStream is = getResources().openRawResource(id);
         FileOutputStream os = new FileOutputStream(cascadeFile);
 
         byte[] buffer = new byte[4096];
@@ -132,11 +175,13 @@ public class Main extends AppCompatActivity implements CvCameraViewListener2, RP
         super.onCreate(savedInstanceState);
         getWindow().addFlags(WindowManager.LayoutParams.FLAG_KEEP_SCREEN_ON);
 
-        // Clear directory from old log files
-        try {
-            FileUtils.deleteDirectory(getApplicationContext().getExternalFilesDir(null));
-        } catch (IOException e) {
-            Log.e(TAG, "Exception while clearing directory: " + e);
+        // Clear directory from old log files (keep the recording when replaying it)
+        if (!REPLAY) {
+            try {
+                FileUtils.deleteDirectory(getApplicationContext().getExternalFilesDir(null));
+            } catch (IOException e) {
+                Log.e(TAG, "Exception while clearing directory: " + e);
+            }
         }
 
         // Set the user interface layout for this Activity
@@ -249,6 +294,56 @@ public class Main extends AppCompatActivity implements CvCameraViewListener2, RP
         builder.show();
     }
 
+    /**
+     * Load rPPG for frames of the given size
+     * @param width - the frame width
+     * @param height - the frame height
+     */
+    private void loadRPPG(int width, int height) {
+
+        File cascadeDir = getDir("cascade", Context.MODE_PRIVATE);
+
+        // Initialise rPPG
+
+        try {
+            rPPG.load(this, ALGORITHM, COMPARE_ALGORITHMS, width, height, TIME_BASE, 1,
+                    SAMPLING_FREQUENCY, RESCAN_FREQUENCY, MIN_TRACKING_CONFIDENCE,
+                    MIN_SIGNAL_SIZE, MAX_SIGNAL_SIZE, MIN_SIGNAL_QUALITY, SPECTRUM, SPECTRAL_ZOOM, WELCH_LENGTH, QUANTILES,
+                    SINGLE_PRECISION, MOTION_COMPENSATION, GRID_SIZE, SKIN_DETECTION,
+                    MAX_FACES, THREADS,
+                    getApplicationContext().getExternalFilesDir(null).getAbsolutePath(),
+                    loadCascadeFile(cascadeDir, R.raw.haarcascade_frontalface_alt, "haarcascade_frontalface_alt.xml"),
+                    EYES ? loadCascadeFile(cascadeDir, R.raw.haarcascade_eye, "haarcascade_eye.xml") : "",
+                    LOG, GUI);
+            Log.i(TAG, "Loaded rPPG");
+        } catch (IOException e) {
+            Log.e(TAG, "Failed to load cascade. Exception thrown: " + e);
+        }
+
+        cascadeDir.delete();
+    }
+
+    /**
+     * Replay the recording made with VIDEO enabled into rPPG instead of using the camera
+     */
+    private void startReplay() {
+        new Thread(new Runnable() {
+            @Override
+            public void run() {
+                File file = new File(getApplicationContext().getExternalFilesDir(null), "Android_ffmpeg.mkv");
+                RPPGReplay replay = new RPPGReplay();
+                if (!replay.open(file.getAbsolutePath(), REPLAY_POOL_SIZE)) {
+                    Log.e(TAG, "Failed to open recording " + file);
+                    return;
+                }
+                loadRPPG(replay.getWidth(), replay.getHeight());
+                replay.run(rPPG);
+                replay.close();
+                rPPG.exit();
+            }
+        }).start();
+    }
+
     /* CvCameraViewListener2 methods */
 
     /**
@@ -260,33 +355,25 @@ public class Main extends AppCompatActivity implements CvCameraViewListener2, RP
 
         // Set up Mats
         mGray = new Mat();
-        mRgba = new Mat();
+        if (NV21 && !GUI) {
+            // Nothing is drawn: display a constant black frame instead of converting each frame
+            mRgba = Mat.zeros(height, width, CvType.CV_8UC4);
+        } else {
+            mRgba = new Mat();
+        }
 
         // Prepare FFmpegEncoder
         if (VIDEO) {
-            if (!encoder.openFile(videoFile.getAbsolutePath(), width, height, VIDEO_BITRATE, 30)) {
+            if (!encoder.openFile(videoFile.getAbsolutePath(), width, height, VIDEO_BITRATE, 30,
+                    VIDEO_THREADS, VIDEO_THREAD_TYPE, VIDEO_GOP_SIZE, VIDEO_PRESET,
+                    VIDEO_CROP ? VIDEO_CROP_WIDTH : 0, VIDEO_CROP ? VIDEO_CROP_HEIGHT : 0, VIDEO_LOSSLESS)) {
                 Log.e(TAG, "Encoder failed to open");
             } else {
                 Log.i(TAG, "Encoder loaded successfully");
             }
         }
 
-        File cascadeDir = getDir("cascade", Context.MODE_PRIVATE);
-
-        // Initialise rPPG
-
-        try {
-            rPPG.load(this, ALGORITHM, width, height, TIME_BASE, 1,
-                    SAMPLING_FREQUENCY, RESCAN_FREQUENCY, MIN_SIGNAL_SIZE, MAX_SIGNAL_SIZE,
-                    getApplicationContext().getExternalFilesDir(null).getAbsolutePath(),
-                    loadCascadeFile(cascadeDir, R.raw.haarcascade_frontalface_alt, "haarcascade_frontalface_alt.xml"),
-                    LOG, GUI);
-            Log.i(TAG, "Loaded rPPG");
-        } catch (IOException e) {
-            Log.e(TAG, "Failed to load cascade. Exception thrown: " + e);
-        }
-
-        cascadeDir.delete();
+        loadRPPG(width, height);
     }
 
     /**
@@ -300,21 +387,50 @@ public class Main extends AppCompatActivity implements CvCameraViewListener2, RP
         // This is where the timestamp for each video frame originates
         time = System.currentTimeMillis();
 
-        mRgba.release();
+        // Crop window follows the face box tracked up to the previous frame, it stays put while the signal is poor
+        if (VIDEO && VIDEO_CROP && rPPG.getFaceBox(faceBox)) {
+            encoder.setCropBox(faceBox[0], faceBox[1], faceBox[2], faceBox[3]);
+        }
+
         mGray.release();
 
-        // Get RGBA and Gray versions
-        mRgba = inputFrame.rgba();
-        mGray = inputFrame.gray();
+        if (NV21) {
 
-        // Write frame to video
-        if (VIDEO) {
-            encoder.writeFrame(mRgba.dataAddr(), time);
-        }
+            // Gray is a view on the Y plane of the camera's NV21 buffer and needs no conversion
+            mGray = inputFrame.gray();
 
-        // Send the frame to rPPG for processing
-        // To C++
-        rPPG.processFrame(mRgba.getNativeObjAddr(), mGray.getNativeObjAddr(), time);
+            // RGBA is only needed for display
+            if (GUI) {
+                mRgba.release();
+                mRgba = inputFrame.rgba();
+            }
+
+            // Write frame to video
+            if (VIDEO) {
+                encoder.writeFrameNV21(mGray.dataAddr(), time);
+            }
+
+            // Send the frame to rPPG for processing
+            // To C++
+            rPPG.processFrameNV21(mRgba.getNativeObjAddr(), mGray.getNativeObjAddr(), time);
+
+        } else {
+
+            mRgba.release();
+
+            // Get RGBA and Gray versions
+            mRgba = inputFrame.rgba();
+            mGray = inputFrame.gray();
+
+            // Write frame to video
+            if (VIDEO) {
+                encoder.writeFrame(mRgba.dataAddr(), time);
+            }
+
+            // Send the frame to rPPG for processing
+            // To C++
+            rPPG.processFrame(mRgba.getNativeObjAddr(), mGray.getNativeObjAddr(), time);
+        }
 
         return mRgba;
     }
@@ -348,11 +464,11 @@ public class Main extends AppCompatActivity implements CvCameraViewListener2, RP
      */
     public void onRPPGResult(RPPGResult result) {
 
-        // Push the result to the queue
-        if (client.isActive) {
+        // Push the result to the queue, the protocol carries the primary algorithm only
+        if (client.isActive && result.getAlgorithm() == ALGORITHM) {
             queue.push(result);
         }
-        Log.i(TAG, "RPPGResult: " + result.getTime() + " – " + result.getMean());
+        Log.i(TAG, "RPPGResult: " + result.getTime() + " – " + result.getId() + " – " + result.getAlgorithm() + " – " + result.getMean() + " – " + result.getMedian() + " – " + result.getSnr());
     }
 
     /* NetworkClientStateListener methods */
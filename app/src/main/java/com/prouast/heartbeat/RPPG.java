@@ -9,6 +9,10 @@ public class RPPG {
         g, pca, xminay
     }
 
+    public enum RPPGSpectrum {
+        fft, direct, chirpz
+    }
+
     /**
      * Listener must implement this interface.
      */
@@ -20,14 +24,35 @@ public class RPPG {
         self = _initialise();
     }
 
+    /**
+     * Load settings.
+     * @param compareAlgorithms also run the other algorithms on the same preprocessed traces, results tagged by algorithm; only algorithm decides on reacquisition
+     * @param rescanFrequency faces are detected again at least this often (Hz)
+     * @param minTrackingConfidence detect earlier once tracking confidence of a face drops below this, 0 to rescan on the timer only
+     * @param minSignalQuality estimates with a lower SNR (dB) are dropped; faces whose signal stays below it are reacquired
+     * @param spectrum how the spectrum within the band is evaluated: fft computes the full DFT and ignores spectralZoom, direct and chirpz only the band
+     * @param spectralZoom the spectrum within the band is evaluated this many times finer than the DFT bins, 1 for the DFT only
+     * @param welchLength average the spectra of half overlapping segments of this many seconds, clamped to the signal size, 0 for one spectrum of the whole signal
+     * @param quantiles quantiles of the estimates reported with each result besides the median, e.g. {0.25, 0.75}
+     * @param singlePrecision filter and transform the signal in float with the vector kernels, within about 1e-5 of double
+     * @param motionCompensation regress tracked head motion out of the color traces before filtering
+     * @param gridSize sample the face box in gridSize x gridSize blocks weighted by signal quality, 0 for the forehead ROI only
+     * @param skinDetection average only the skin pixels of the ROI, falling back to all of them if too few are found
+     * @param maxFaces number of faces tracked at once, each with its own signal; 1 tracks the nearest face only
+     * @param threads threads for per-face processing, 0 for one per core
+     * @param eyeClassifierPath eye cascade to place the ROI relative to the eyes at rescans, empty for fixed placement
+     */
     public void load(RPPGListener listener,
-                     RPPGAlgorithm algorithm,
+                     RPPGAlgorithm algorithm, boolean compareAlgorithms,
                      int width, int height, double timeBase, int downsample,
-                     double samplingFrequency, double rescanFrequency,
-                     int minSignalSize, int maxSignalSize,
-                     String logPath, String classifierPath,
+                     double samplingFrequency, double rescanFrequency, double minTrackingConfidence,
+                     int minSignalSize, int maxSignalSize, double minSignalQuality,
+                     RPPGSpectrum spectrum, int spectralZoom, int welchLength, double[] quantiles,
+                     boolean singlePrecision, boolean motionCompensation, int gridSize, boolean skinDetection,
+                     int maxFaces, int threads,
+                     String logPath, String classifierPath, String eyeClassifierPath,
                      boolean log, boolean gui) {
-        _load(self, listener, algorithm.ordinal(), width, height, timeBase, downsample, samplingFrequency, rescanFrequency, minSignalSize, maxSignalSize, logPath, classifierPath, log, gui);
+        _load(self, listener, algorithm.ordinal(), compareAlgorithms, width, height, timeBase, downsample, samplingFrequency, rescanFrequency, minTrackingConfidence, minSignalSize, maxSignalSize, minSignalQuality, spectrum.ordinal(), spectralZoom, welchLength, quantiles, singlePrecision, motionCompensation, gridSize, skinDetection, maxFaces, threads, logPath, classifierPath, eyeClassifierPath, log, gui);
     }
 
     public void exit() {
@@ -38,9 +63,30 @@ public class RPPG {
         _processFrame(self, frameRGB, frameGray, now);
     }
 
+    /**
+     * Process a camera frame without RGBA conversion.
+     * @param frameRGB RGBA frame, only drawn on in GUI mode
+     * @param frameGray gray frame as delivered by the camera, a view on the Y plane of its NV21 buffer
+     * @param now timestamp
+     */
+    public void processFrameNV21(long frameRGB, long frameGray, long now) {
+        _processFrameNV21(self, frameRGB, frameGray, now);
+    }
+
+    /**
+     * Get the box of the face tracked for the longest time.
+     * @param box receives x, y, width and height
+     * @return false if no face is tracked
+     */
+    public boolean getFaceBox(int[] box) {
+        return _getFaceBox(self, box);
+    }
+
     private long self = 0;
     private static native long _initialise();
-    private static native void _load(long self, RPPGListener listener, int algorithm, int width, int height, double timeBase, int downsample, double samplingFrequency, double rescanFrequency, int minSignalSize, int maxSignalSize, String logPath, String classifierPath, boolean log, boolean gui);
+    private static native void _load(long self, RPPGListener listener, int algorithm, boolean compareAlgorithms, int width, int height, double timeBase, int downsample, double samplingFrequency, double rescanFrequency, double minTrackingConfidence, int minSignalSize, int maxSignalSize, double minSignalQuality, int spectrum, int spectralZoom, int welchLength, double[] quantiles, boolean singlePrecision, boolean motionCompensation, int gridSize, boolean skinDetection, int maxFaces, int threads, String logPath, String classifierPath, String eyeClassifierPath, boolean log, boolean gui);
     private static native void _processFrame(long self, long frameRGB, long frameGray, long time);
+    private static native void _processFrameNV21(long self, long frameRGB, long frameGray, long time);
+    private static native boolean _getFaceBox(long self, int[] box);
     private static native void _exit(long self);
 }
@@ -0,0 +1,78 @@
+package com.prouast.heartbeat;
+
+import android.util.Log;
+
+import org.opencv.core.CvType;
+import org.opencv.core.Mat;
+
+/**
+ * Replays a recording into RPPG with the original timestamps, as fast as it can be decoded.
+ */
+public class RPPGReplay {
+
+    private static final String TAG = "Heartbeat::RPPGReplay";
+
+    private FFmpegDecoder decoder;
+
+    /**
+     * Open a recording.
+     * @param filename the file written by FFmpegEncoder
+     * @param poolSize number of frames decoded ahead
+     * @return false if the file could not be opened
+     */
+    public boolean open(String filename, int poolSize) {
+        decoder = new FFmpegDecoder();
+        return decoder.openFile(filename, poolSize);
+    }
+
+    public int getWidth() {
+        return decoder.getWidth();
+    }
+
+    public int getHeight() {
+        return decoder.getHeight();
+    }
+
+    /**
+     * Feed all frames to RPPG, which must be loaded with the recording's size.
+     * @param rPPG the loaded RPPG
+     * @return number of frames processed
+     */
+    public int run(RPPG rPPG) {
+
+        int width = decoder.getWidth();
+        int height = decoder.getHeight();
+
+        // Gray is a view on the Y plane, as with the camera
+        Mat nv21 = new Mat(height + height / 2, width, CvType.CV_8UC1);
+        Mat gray = nv21.submat(0, height, 0, width);
+        Mat rgba = Mat.zeros(height, width, CvType.CV_8UC4);
+
+        long start = System.currentTimeMillis();
+        long first = -1, last = -1;
+        int count = 0;
+        long time;
+        while ((time = decoder.readFrame(nv21.dataAddr())) >= 0) {
+            rPPG.processFrameNV21(rgba.getNativeObjAddr(), gray.getNativeObjAddr(), time);
+            if (first < 0) {
+                first = time;
+            }
+            last = time;
+            count++;
+        }
+        long elapsed = System.currentTimeMillis() - start;
+
+        Log.i(TAG, "Replayed " + count + " frames (" + (last - first) + " ms of video) in " + elapsed + " ms: "
+                + (elapsed > 0 ? count * 1000.0 / elapsed : 0) + " fps");
+
+        gray.release();
+        nv21.release();
+        rgba.release();
+
+        return count;
+    }
+
+    public void close() {
+        decoder.closeFile();
+    }
+}
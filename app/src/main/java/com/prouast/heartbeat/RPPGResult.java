@@ -8,20 +8,35 @@ public class RPPGResult {
     private double mean = Double.NaN;
     private double min = Double.NaN;
     private double max = Double.NaN;
+    private double median = Double.NaN;
+    private double[] quantiles = new double[0];
+    private double snr = Double.NaN;
     private long time = 0L;
+    private int id = 0;
+    private int algorithm = 0;
 
     /**
      * Constructor
      * @param time
+     * @param id
+     * @param algorithm
      * @param mean
      * @param min
      * @param max
+     * @param median
+     * @param quantiles
+     * @param snr
      */
-    public RPPGResult(long time, double mean, double min, double max) {
+    public RPPGResult(long time, int id, int algorithm, double mean, double min, double max, double median, double[] quantiles, double snr) {
         this.time = time;
+        this.id = id;
+        this.algorithm = algorithm;
         this.mean = mean;
         this.min = min;
         this.max = max;
+        this.median = median;
+        this.quantiles = quantiles;
+        this.snr = snr;
     }
 
     /**
@@ -32,6 +47,22 @@ public class RPPGResult {
         return time;
     }
 
+    /**
+     * Getter for the face id, which persists while the face is tracked
+     * @return id
+     */
+    public int getId() {
+        return id;
+    }
+
+    /**
+     * Getter for the algorithm this result was estimated with
+     * @return algorithm
+     */
+    public RPPG.RPPGAlgorithm getAlgorithm() {
+        return RPPG.RPPGAlgorithm.values()[algorithm];
+    }
+
     public double getMean() {
         return mean;
     }
@@ -43,4 +74,28 @@ public class RPPGResult {
     public double getMax() {
         return max;
     }
+
+    /**
+     * Getter for the approximate median of the estimates behind this result
+     * @return median
+     */
+    public double getMedian() {
+        return median;
+    }
+
+    /**
+     * Getter for the approximate quantiles of the estimates, in the order given to RPPG.load
+     * @return quantiles
+     */
+    public double[] getQuantiles() {
+        return quantiles;
+    }
+
+    /**
+     * Getter for the mean signal to noise ratio of the estimates behind this result
+     * @return snr in dB
+     */
+    public double getSnr() {
+        return snr;
+    }
 }
\ No newline at end of file
@@ -13,17 +13,40 @@ include $(CLEAR_VARS)
 LOCAL_MODULE := FFmpegEncoder
 LOCAL_LDLIBS := -llog -ljnigraphics -lz -landroid
 LOCAL_C_INCLUDES += $(FFMPEG_PATH)/include
-LOCAL_SRC_FILES := FFmpegEncoder.cpp com_prouast_heartbeat_FFmpegEncoder.cpp
+LOCAL_SRC_FILES := FFmpegEncoder.cpp com_prouast_heartbeat_FFmpegEncoder.cpp \
+                   FFmpegDecoder.cpp com_prouast_heartbeat_FFmpegDecoder.cpp \
+                   yuv.cpp
+# NEON kernels are built separately and selected at runtime
+ifeq ($(TARGET_ARCH_ABI),armeabi-v7a)
+LOCAL_SRC_FILES += yuv_neon.cpp.neon
+LOCAL_CFLAGS += -DHAVE_NEON=1
+endif
+ifeq ($(TARGET_ARCH_ABI),arm64-v8a)
+LOCAL_SRC_FILES += yuv_neon.cpp
+LOCAL_CFLAGS += -DHAVE_NEON=1
+endif
 LOCAL_SHARED_LIBRARIES := libavformat-55 libavcodec-55 libavutil-52 libswscale-2
+LOCAL_STATIC_LIBRARIES := cpufeatures
 include $(BUILD_SHARED_LIBRARY)
 
 include $(CLEAR_VARS)
 OPENCV_INSTALL_MODULES:=on
 include $(OPENCV_PATH)/sdk/native/jni/OpenCV.mk
 LOCAL_MODULE := RPPG
-LOCAL_SRC_FILES := RPPG.cpp opencv.cpp com_prouast_heartbeat_RPPG.cpp
+LOCAL_SRC_FILES := RPPG.cpp opencv.cpp ThreadPool.cpp FrameHistory.cpp similarity.cpp CascadeRegistry.cpp HaarCascade.cpp skin.cpp signal.cpp ChirpZ.cpp \
+                   RunningStatistics.cpp Welch.cpp com_prouast_heartbeat_RPPG.cpp
+ifeq ($(TARGET_ARCH_ABI),armeabi-v7a)
+LOCAL_SRC_FILES += skin_neon.cpp.neon signal_neon.cpp.neon
+LOCAL_CFLAGS += -DHAVE_NEON=1
+endif
+ifeq ($(TARGET_ARCH_ABI),arm64-v8a)
+LOCAL_SRC_FILES += skin_neon.cpp signal_neon.cpp
+LOCAL_CFLAGS += -DHAVE_NEON=1
+endif
 LOCAL_C_INCLUDES += $(LOCAL_PATH)
 LOCAL_LDLIBS := -llog -ldl
+LOCAL_STATIC_LIBRARIES += cpufeatures
 include $(BUILD_SHARED_LIBRARY)
 
-include $(FFMPEG_PATH)/Android.mk
\ No newline at end of file
+include $(FFMPEG_PATH)/Android.mk
+$(call import-module,android/cpufeatures)
\ No newline at end of file
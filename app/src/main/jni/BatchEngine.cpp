@@ -0,0 +1,188 @@
+//
+//  BatchEngine.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#include "BatchEngine.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <limits>
+
+#include "FFmpegDecoder.hpp"
+#include "RPPG.hpp"
+#include "WorkStealingPool.hpp"
+#include "log.hpp"
+
+#define LOG_TAG "Heartbeat::BatchEngine"
+#define TIME_BASE 0.001     // Decoder timestamps are milliseconds
+#define DECODER_THREADS 1   // Segments are decoded in parallel already, more threads only oversubscribe
+
+BatchEngine::BatchEngine(int algorithm, bool compareAlgorithms, double samplingFrequency, double rescanFrequency, double minTrackingConfidence,
+                         int minSignalSize, int maxSignalSize, double minSignalQuality,
+                         int spectrum, int spectralZoom, int welchLength,
+                         const std::vector<double> &quantiles, bool singlePrecision, bool motionCompensation, int gridSize, bool skinDetection,
+                         const std::string &classifierPath, const std::string &eyeClassifierPath,
+                         int segmentLength, int threads, int poolSize) :
+    algorithm(algorithm), compareAlgorithms(compareAlgorithms), samplingFrequency(samplingFrequency), rescanFrequency(rescanFrequency),
+    minTrackingConfidence(minTrackingConfidence),
+    minSignalSize(minSignalSize), maxSignalSize(maxSignalSize), minSignalQuality(minSignalQuality),
+    spectrum(spectrum), spectralZoom(spectralZoom), welchLength(welchLength), quantiles(quantiles), singlePrecision(singlePrecision),
+    motionCompensation(motionCompensation),
+    gridSize(gridSize), skinDetection(skinDetection),
+    classifierPath(classifierPath),
+    eyeClassifierPath(eyeClassifierPath),
+    segmentLength(segmentLength), threads(threads), poolSize(poolSize), frameCount(0), elapsed(0) {;}
+
+void BatchEngine::addFile(const std::string &filename, const std::string &outputPath) {
+    File file;
+    file.filename = filename;
+    file.outputPath = outputPath;
+    file.failed = false;
+    files.push_back(file);
+}
+
+bool BatchEngine::run() {
+
+    WorkStealingPool pool(threads);
+    threads = pool.size();
+    frameCount = 0;
+
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+    // Files are split into segments on the workers, which then queue the segments themselves
+    for (size_t i = 0; i < files.size(); i++) {
+        File &file = files[i];
+        pool.submit([this, &pool, &file]() { planFile(pool, file); });
+    }
+    pool.wait();
+
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    bool ok = true;
+    for (size_t i = 0; i < files.size(); i++) {
+        ok = !files[i].failed && writeResults(files[i]) && ok;
+    }
+
+    double fps = elapsed > 0 ? frameCount / elapsed : 0;
+    __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "Processed %lld frames of %d files in %.1f s: %.1f fps, %.1f fps per core",
+                        (long long)frameCount, (int)files.size(), elapsed, fps, fps / threads);
+
+    return ok;
+}
+
+void BatchEngine::planFile(WorkStealingPool &pool, File &file) {
+
+    FFmpegDecoder decoder;
+    if (!decoder.OpenFile(file.filename.c_str(), 1, DECODER_THREADS)) {
+        std::lock_guard<std::mutex> lock(mutex);
+        file.failed = true;
+        return;
+    }
+    int64_t start = decoder.GetStartTime();
+    int64_t end = start + decoder.GetDuration();
+    decoder.CloseFile();
+
+    // Last segment runs to the end of the file
+    int64_t length = segmentLength > 0 ? (int64_t)segmentLength * 1000 : end - start;
+    std::vector<int64_t> bounds;
+    for (int64_t t = start; t < end || bounds.empty(); t += std::max(length, (int64_t)1)) {
+        bounds.push_back(t);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        file.segments.resize(bounds.size());
+    }
+
+    for (size_t i = 0; i < bounds.size(); i++) {
+        int64_t segmentEnd = i + 1 < bounds.size() ? bounds[i + 1] : std::numeric_limits<int64_t>::max();
+        int64_t segmentStart = bounds[i];
+        pool.submit([this, &file, i, segmentStart, segmentEnd]() {
+            processSegment(file, i, segmentStart, segmentEnd);
+        });
+    }
+}
+
+void BatchEngine::processSegment(File &file, size_t segment, int64_t start, int64_t end) {
+
+    // The first segment needs no warm-up
+    int64_t warmup = segment == 0 ? -1 : start - (int64_t)maxSignalSize * 1000;
+
+    FFmpegDecoder decoder;
+    if (!decoder.OpenFile(file.filename.c_str(), poolSize, DECODER_THREADS, warmup)) {
+        std::lock_guard<std::mutex> lock(mutex);
+        file.failed = true;
+        return;
+    }
+
+    // Results of this segment only, warm-up results belong to the previous one
+    std::vector<Result> results;
+    RPPG::ResultCallback callback = [&results, start](int64_t time, int id, int algorithm, double meanBpm, double minBpm, double maxBpm,
+                                                      double medianBpm, const std::vector<double> &quantileBpms, double snr) {
+        if (time >= start) {
+            Result result = {time, id, algorithm, meanBpm, minBpm, maxBpm, medianBpm, quantileBpms, snr};
+            results.push_back(result);
+        }
+    };
+
+    RPPG rppg;
+    rppg.load(callback, algorithm, compareAlgorithms, decoder.GetWidth(), decoder.GetHeight(), TIME_BASE, 1,
+              samplingFrequency, rescanFrequency, minTrackingConfidence,
+              minSignalSize, maxSignalSize, minSignalQuality, spectrum, spectralZoom, welchLength, quantiles,
+              singlePrecision, motionCompensation, gridSize, skinDetection,
+              1, 1, "", classifierPath, eyeClassifierPath, false, false);
+
+    cv::Mat frameRGB;
+    cv::Mat frameNV21(decoder.GetHeight() * 3 / 2, decoder.GetWidth(), CV_8UC1);
+    int64_t time;
+    int64_t frames = 0;
+    while (decoder.ReadFrame(frameNV21.data, time) && time < end) {
+        rppg.processFrameNV21(frameRGB, frameNV21, time);
+        frames++;
+    }
+
+    rppg.exit();
+    decoder.CloseFile();
+
+    frameCount += frames;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    file.segments[segment].swap(results);
+}
+
+bool BatchEngine::writeResults(const File &file) {
+
+    std::ofstream out(file.outputPath.c_str());
+    if (!out) {
+        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Could not open %s", file.outputPath.c_str());
+        return false;
+    }
+
+    out << "time;face;algorithm;mean;min;max;median;";
+    for (size_t i = 0; i < quantiles.size(); i++) {
+        out << "q" << quantiles[i] << ";";
+    }
+    out << "snr\n";
+    for (size_t i = 0; i < file.segments.size(); i++) {
+        const std::vector<Result> &results = file.segments[i];
+        for (size_t j = 0; j < results.size(); j++) {
+            out << results[j].time << ";";
+            out << results[j].id << ";";
+            out << results[j].algorithm << ";";
+            out << results[j].meanBpm << ";";
+            out << results[j].minBpm << ";";
+            out << results[j].maxBpm << ";";
+            out << results[j].medianBpm << ";";
+            for (size_t k = 0; k < results[j].quantileBpms.size(); k++) {
+                out << results[j].quantileBpms[k] << ";";
+            }
+            out << results[j].snr << "\n";
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,106 @@
+//
+//  BatchEngine.hpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#ifndef BatchEngine_hpp
+#define BatchEngine_hpp
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class WorkStealingPool;
+
+// Host-side analysis of many recordings made with FFmpegEncoder.
+// Each file is split into segments of fixed length which run as independent tasks on a
+// work-stealing pool, each with its own RPPG instance and a decoder running ahead on its own thread.
+// The cascades are loaded once and shared through CascadeRegistry.
+// Segments start early by maxSignalSize seconds so that estimates are warmed up at the boundary.
+class BatchEngine {
+
+public:
+
+    // Settings as in RPPG::load
+    // segmentLength: seconds per task, 0 for one task per file
+    // threads: analysis workers, 0 for one per core
+    // poolSize: frames decoded ahead per task
+    BatchEngine(int algorithm, bool compareAlgorithms, double samplingFrequency, double rescanFrequency, double minTrackingConfidence,
+                int minSignalSize, int maxSignalSize, double minSignalQuality,
+                int spectrum, int spectralZoom, int welchLength,
+                const std::vector<double> &quantiles, bool singlePrecision, bool motionCompensation, int gridSize, bool skinDetection,
+                const std::string &classifierPath, const std::string &eyeClassifierPath,
+                int segmentLength, int threads, int poolSize);
+
+    // Queue a recording, results are written to outputPath as csv
+    void addFile(const std::string &filename, const std::string &outputPath);
+
+    // Process all queued files, false if any of them failed
+    bool run();
+
+    // Statistics of the last run
+    int64_t getFrameCount() const { return frameCount; }
+    double getElapsed() const { return elapsed; }       // seconds
+    int getThreads() const { return threads; }
+
+private:
+
+    struct Result {
+        int64_t time;
+        int id;
+        int algorithm;
+        double meanBpm;
+        double minBpm;
+        double maxBpm;
+        double medianBpm;
+        std::vector<double> quantileBpms;
+        double snr;
+    };
+
+    struct File {
+        std::string filename;
+        std::string outputPath;
+        std::vector<std::vector<Result> > segments;     // Results per segment, in order
+        bool failed;
+    };
+
+    void planFile(WorkStealingPool &pool, File &file);
+    void processSegment(File &file, size_t segment, int64_t start, int64_t end);
+    bool writeResults(const File &file);
+
+    // Settings
+    int algorithm;
+    bool compareAlgorithms;
+    double samplingFrequency;
+    double rescanFrequency;
+    double minTrackingConfidence;
+    int minSignalSize;
+    int maxSignalSize;
+    double minSignalQuality;
+    int spectrum;
+    int spectralZoom;
+    int welchLength;
+    std::vector<double> quantiles;
+    bool singlePrecision;
+    bool motionCompensation;
+    int gridSize;
+    bool skinDetection;
+    std::string classifierPath;
+    std::string eyeClassifierPath;
+    int segmentLength;
+    int threads;
+    int poolSize;
+
+    std::vector<File> files;
+    std::mutex mutex;                                   // Guards the files while tasks run
+
+    // Statistics
+    std::atomic<int64_t> frameCount;
+    double elapsed;
+};
+
+#endif /* BatchEngine_hpp */
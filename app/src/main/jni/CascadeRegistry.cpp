@@ -0,0 +1,166 @@
+//
+//  CascadeRegistry.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#include "CascadeRegistry.hpp"
+
+#include <map>
+#include <mutex>
+#include <sys/stat.h>
+
+#include "log.hpp"
+
+#define LOG_TAG "Heartbeat::CascadeRegistry"
+
+using namespace cv;
+using namespace std;
+
+// A loaded cascade file and its idle detectors
+struct CascadeRegistry::Model {
+    mutex lock;
+    HaarCascade cascade;                    // Mapped binary model, immutable once loaded
+    FileStorage fs;                         // Parsed file, only kept if there is no binary model
+    vector<Ptr<HaarCascade::Buffers> > idleBuffers;
+    vector<Ptr<CascadeClassifier> > idle;
+    int detectors;                          // Created so far
+};
+
+// Milliseconds since start
+static double elapsedMs(int64 start) {
+    return (getTickCount() - start) * 1000. / getTickFrequency();
+}
+
+shared_ptr<CascadeRegistry::Model> CascadeRegistry::getModel(const string &path) {
+
+    static mutex registryLock;
+    static map<string, shared_ptr<Model> > models;
+
+    lock_guard<mutex> lock(registryLock);
+
+    map<string, shared_ptr<Model> >::iterator it = models.find(path);
+    if (it != models.end()) {
+        return it->second;
+    }
+
+    // Load once, failures are not cached so that a missing file can appear later
+    shared_ptr<Model> model = make_shared<Model>();
+    model->detectors = 0;
+    int64 start = getTickCount();
+
+    // Map the binary model if it was converted from this very file
+    struct stat xmlStat;
+    if (stat(path.c_str(), &xmlStat) != 0) {
+        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Could not open cascade %s", path.c_str());
+        return shared_ptr<Model>();
+    }
+    const HaarCascade::Source source = {(int64_t)xmlStat.st_size, (int64_t)xmlStat.st_mtime};
+    const string binPath = path + ".bin";
+    if (model->cascade.load(binPath, source)) {
+        __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "Mapped cascade %s in %.2f ms", binPath.c_str(), elapsedMs(start));
+        models[path] = model;
+        return model;
+    }
+
+    if (!model->fs.open(path, FileStorage::READ)) {
+        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Could not open cascade %s", path.c_str());
+        return shared_ptr<Model>();
+    }
+
+    __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "Parsed cascade %s in %.2f ms", path.c_str(), elapsedMs(start));
+
+    // Convert for the next start, keep the parsed file for CascadeClassifier if that fails
+    if (HaarCascade::convert(model->fs.getFirstTopLevelNode(), binPath, source) && model->cascade.load(binPath, source)) {
+        model->fs.release();
+    }
+    models[path] = model;
+
+    return model;
+}
+
+Ptr<CascadeClassifier> CascadeRegistry::createDetector(Model &model) {
+
+    // Called with model.lock held, reading the parsed file is not synchronised by OpenCV
+    Ptr<CascadeClassifier> detector = makePtr<CascadeClassifier>();
+    if (!detector->read(model.fs.getFirstTopLevelNode())) {
+        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Not a cascade: %s", model.fs.getFirstTopLevelNode().name().c_str());
+        return Ptr<CascadeClassifier>();
+    }
+    model.detectors++;
+
+    __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "Created detector %d", model.detectors);
+
+    return detector;
+}
+
+bool CascadeRegistry::load(const string &path) {
+
+    shared_ptr<Model> model = getModel(path);
+    if (!model) {
+        return false;
+    }
+
+    lock_guard<mutex> lock(model->lock);
+    if (!model->cascade.empty()) {
+        return true;
+    }
+    if (model->idle.empty() && model->detectors == 0) {
+        Ptr<CascadeClassifier> detector = createDetector(*model);
+        if (detector.empty()) {
+            return false;
+        }
+        model->idle.push_back(detector);
+    }
+    return true;
+}
+
+CascadeRegistry::Lease CascadeRegistry::acquire(const string &path) {
+
+    shared_ptr<Model> model = getModel(path);
+    if (!model) {
+        return Lease(model, Ptr<CascadeClassifier>(), Ptr<HaarCascade::Buffers>());
+    }
+
+    lock_guard<mutex> lock(model->lock);
+    if (!model->cascade.empty()) {
+        Ptr<HaarCascade::Buffers> buffers;
+        if (model->idleBuffers.empty()) {
+            buffers = makePtr<HaarCascade::Buffers>();
+        } else {
+            buffers = model->idleBuffers.back();
+            model->idleBuffers.pop_back();
+        }
+        return Lease(model, Ptr<CascadeClassifier>(), buffers);
+    }
+    Ptr<CascadeClassifier> detector;
+    if (model->idle.empty()) {
+        detector = createDetector(*model);
+    } else {
+        detector = model->idle.back();
+        model->idle.pop_back();
+    }
+    return Lease(model, detector, Ptr<HaarCascade::Buffers>());
+}
+
+void CascadeRegistry::Lease::detectMultiScale(const Mat &image, vector<Rect> &objects,
+                                              double scaleFactor, int minNeighbors, Size minSize) const {
+    if (!buffers.empty()) {
+        model->cascade.detectMultiScale(image, objects, scaleFactor, minNeighbors, minSize, *buffers);
+    } else if (!detector.empty()) {
+        detector->detectMultiScale(image, objects, scaleFactor, minNeighbors, CV_HAAR_SCALE_IMAGE, minSize);
+    } else {
+        objects.clear();
+    }
+}
+
+CascadeRegistry::Lease::~Lease() {
+    if (model && !buffers.empty()) {
+        lock_guard<mutex> lock(model->lock);
+        model->idleBuffers.push_back(buffers);
+    } else if (model && !detector.empty()) {
+        lock_guard<mutex> lock(model->lock);
+        model->idle.push_back(detector);
+    }
+}
@@ -0,0 +1,77 @@
+//
+//  CascadeRegistry.hpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#ifndef CascadeRegistry_hpp
+#define CascadeRegistry_hpp
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <opencv2/objdetect/objdetect.hpp>
+
+#include "HaarCascade.hpp"
+
+// Process-wide cache of cascade classifiers, safe to use from any thread.
+// Each cascade file is converted once to HaarCascade's binary format next to it (<path>.bin),
+// which later starts simply map. A binary file that does not match the size and modification
+// time of the cascade file, the format version or its checksum is converted again.
+// The mapped model is shared by all callers, each lease brings its own scratch buffers.
+// Cascades without a binary form fall back to CascadeClassifier, which keeps per-image state
+// while detecting: detectors built from the parsed file are pooled, so there are only ever
+// as many as there are concurrent detections.
+class CascadeRegistry {
+
+    struct Model;
+
+public:
+
+    // A detector lent for the duration of a detection, returned to the pool on destruction
+    class Lease {
+
+    public:
+
+        Lease(Lease &&other) : model(std::move(other.model)), detector(other.detector), buffers(other.buffers) {
+            other.detector.release();
+            other.buffers.release();
+        }
+        ~Lease();
+
+        // As cv::CascadeClassifier::detectMultiScale with CV_HAAR_SCALE_IMAGE
+        void detectMultiScale(const cv::Mat &image, std::vector<cv::Rect> &objects,
+                              double scaleFactor, int minNeighbors, cv::Size minSize) const;
+
+        bool empty() const { return detector.empty() && buffers.empty(); }
+
+    private:
+
+        friend class CascadeRegistry;
+
+        Lease(const std::shared_ptr<Model> &model, const cv::Ptr<cv::CascadeClassifier> &detector,
+              const cv::Ptr<HaarCascade::Buffers> &buffers) :
+            model(model), detector(detector), buffers(buffers) {;}
+        Lease(const Lease &);
+        Lease &operator=(const Lease &);
+
+        std::shared_ptr<Model> model;
+        cv::Ptr<cv::CascadeClassifier> detector;    // Fallback
+        cv::Ptr<HaarCascade::Buffers> buffers;      // For the mapped model
+    };
+
+    // Load a cascade file and prepare a detector ahead of the first detection.
+    // Returns false if the file could not be loaded.
+    static bool load(const std::string &path);
+
+    // Lend a detector for path, loading it if necessary. Empty if the file could not be loaded.
+    static Lease acquire(const std::string &path);
+
+private:
+
+    static std::shared_ptr<Model> getModel(const std::string &path);
+    static cv::Ptr<cv::CascadeClassifier> createDetector(Model &model);
+};
+
+#endif /* CascadeRegistry_hpp */
@@ -0,0 +1,121 @@
+//
+//  ChirpZ.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#include "ChirpZ.hpp"
+
+#include <math.h>
+
+using namespace cv;
+using namespace std;
+
+#define MAX_PLANS 4         // Window lengths alternate by a sample or two as the fps varies
+
+// With s = 1 / zoom and f_k = low + k s, n f_k = n low + s (n² + k² - (k - n)²) / 2, so that
+// X_k = e^(-iπ s k² / n) Σ x_j e^(-iπ (2 j low + s j²) / n) e^(iπ s (k - j)² / n).
+// The outer chirp does not change the magnitude and is left out.
+const ChirpZ::Plan &ChirpZ::getPlan(int n, int low, int high, int zoom, int depth) {
+
+    for (size_t i = 0; i < plans.size(); i++) {
+        if (plans[i].n == n && plans[i].low == low && plans[i].high == high && plans[i].zoom == zoom &&
+            plans[i].depth == depth) {
+            rotate(plans.begin() + i, plans.begin() + i + 1, plans.end());
+            return plans.back();
+        }
+    }
+
+    if (plans.size() >= MAX_PLANS) {
+        plans.erase(plans.begin());
+    }
+
+    Plan plan;
+    plan.n = n;
+    plan.low = low;
+    plan.high = high;
+    plan.zoom = zoom;
+    plan.depth = depth;
+
+    const int bins = (high - low) * zoom + 1;
+    const double s = 1.0 / zoom;
+    plan.length = getOptimalDFTSize(n + bins - 1);
+
+    plan.pre.create(1, n, CV_64FC2);
+    for (int j = 0; j < n; j++) {
+        const double angle = -CV_PI * (2.0 * j * low + s * j * j) / n;
+        plan.pre.at<Vec2d>(0, j) = Vec2d(cos(angle), sin(angle));
+    }
+
+    // Chirp for lags -(n - 1) .. bins - 1, negative lags wrapped around
+    Mat chirp = Mat::zeros(1, plan.length, CV_64FC2);
+    for (int m = 0; m < bins; m++) {
+        const double angle = CV_PI * s * m * m / n;
+        chirp.at<Vec2d>(0, m) = Vec2d(cos(angle), sin(angle));
+    }
+    for (int m = 1; m < n; m++) {
+        const double angle = CV_PI * s * m * m / n;
+        chirp.at<Vec2d>(0, plan.length - m) = Vec2d(cos(angle), sin(angle));
+    }
+    dft(chirp, plan.kernel);
+
+    // Tables are computed in double either way, then rounded once
+    plan.pre.convertTo(plan.pre, CV_MAKETYPE(depth, 2));
+    plan.kernel.convertTo(plan.kernel, CV_MAKETYPE(depth, 2));
+
+    plans.push_back(plan);
+    return plans.back();
+}
+
+// Signal times the chirp into the start of the zeroed buffer
+template <typename T>
+static void chirpSignal(const Mat &x, const Mat &pre, Mat &buffer) {
+    typedef Vec<T, 2> Complex;
+    for (int j = 0; j < x.rows; j++) {
+        buffer.at<Complex>(0, j) = pre.at<Complex>(0, j) * x.at<T>(j, 0);
+    }
+}
+
+template <typename T>
+static void magnitudes(const Mat &product, Mat &spectrum) {
+    typedef Vec<T, 2> Complex;
+    for (int k = 0; k < spectrum.rows; k++) {
+        const Complex &c = product.at<Complex>(0, k);
+        spectrum.at<double>(k, 0) = sqrt((double)c[0] * c[0] + (double)c[1] * c[1]);
+    }
+}
+
+void ChirpZ::magnitude(InputArray _signal, OutputArray _spectrum, int low, int high, int zoom) {
+
+    const int depth = _signal.depth() == CV_32F ? CV_32F : CV_64F;
+    Mat x;
+    _signal.getMat().convertTo(x, depth);
+    CV_Assert(x.cols == 1 && zoom > 0 && low <= high);
+
+    const int n = x.rows;
+    const Plan &plan = getPlan(n, low, high, zoom, depth);
+
+    // Chirped signal, zero-padded
+    buffer.create(1, plan.length, CV_MAKETYPE(depth, 2));
+    buffer.setTo(Scalar::all(0));
+    if (depth == CV_32F) {
+        chirpSignal<float>(x, plan.pre, buffer);
+    } else {
+        chirpSignal<double>(x, plan.pre, buffer);
+    }
+
+    // Convolution with the chirp
+    dft(buffer, buffer);
+    mulSpectrums(buffer, plan.kernel, product, 0);
+    dft(product, product, DFT_INVERSE | DFT_SCALE);
+
+    const int bins = (high - low) * zoom + 1;
+    _spectrum.create(bins, 1, CV_64F);
+    Mat spectrum = _spectrum.getMat();
+    if (depth == CV_32F) {
+        magnitudes<float>(product, spectrum);
+    } else {
+        magnitudes<double>(product, spectrum);
+    }
+}
@@ -0,0 +1,43 @@
+//
+//  ChirpZ.hpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#ifndef ChirpZ_hpp
+#define ChirpZ_hpp
+
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+// Magnitude spectrum of a real signal at equally spaced frequencies within a band, by the
+// chirp-z transform (Bluestein's algorithm): one convolution of optimal DFT length above
+// n + bins - 1 instead of n products per frequency. The chirp tables depend only on the
+// window length and the band, so they are kept for the last few of them and reused.
+// Float signals are transformed in float, anything else in double.
+class ChirpZ {
+
+public:
+
+    // Frequencies low + k / zoom in DFT bins of the signal, k = 0 .. (high - low) * zoom
+    void magnitude(cv::InputArray signal, cv::OutputArray spectrum, int low, int high, int zoom);
+
+private:
+
+    struct Plan {
+        int n, low, high, zoom;
+        int depth;          // Of the tables
+        int length;         // Of the convolution
+        cv::Mat pre;        // Chirp applied to the signal, 1 x n complex
+        cv::Mat kernel;     // DFT of the convolution chirp, 1 x length complex
+    };
+
+    const Plan &getPlan(int n, int low, int high, int zoom, int depth);
+
+    std::vector<Plan> plans;    // Most recently used last
+    cv::Mat buffer;             // Padded signal
+    cv::Mat product;            // Its convolution with the chirp
+};
+
+#endif /* ChirpZ_hpp */
@@ -0,0 +1,260 @@
+//
+//  FFmpegDecoder.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#include "FFmpegDecoder.hpp"
+#include "yuv.hpp"
+#include <string.h>
+#include "log.hpp"
+
+extern "C" {
+    #include "libavformat/avformat.h"
+    #include "libavcodec/avcodec.h"
+    #include "libswscale/swscale.h"
+    #include "libavutil/frame.h"
+    #include "libavutil/time.h"
+}
+
+#define LOG_TAG "Heartbeat::FFmpegDecoder"
+
+#define OUTPUT_PIX_FMT PIX_FMT_NV21 /* same layout as the camera preview */
+
+bool FFmpegDecoder::OpenFile(const char *filename, int poolSize, int threads, int64_t startTime) {
+
+    __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "Decode video file %s", filename);
+    __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "Settings: poolSize=%i threads=%i", poolSize, threads);
+
+    AVCodec *codec = NULL;
+
+    /* Initialize libavcodec, and register all codecs and formats. */
+    av_register_all();
+
+    /* open the input and read the stream parameters */
+    if (avformat_open_input(&fmtCtx, filename, NULL, NULL) < 0) {
+        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Could not open %s", filename);
+        return false;
+    }
+    if (avformat_find_stream_info(fmtCtx, NULL) < 0) {
+        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Could not find stream information");
+        return false;
+    }
+
+    /* find the video stream and its decoder */
+    stream = av_find_best_stream(fmtCtx, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+    if (stream < 0 || !codec) {
+        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Could not find a video stream");
+        return false;
+    }
+
+    codecCtx = fmtCtx->streams[stream]->codec;
+
+    codecCtx->thread_count = threads;
+
+    if (avcodec_open2(codecCtx, codec, NULL) < 0) {
+        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Could not open codec");
+        return false;
+    }
+
+    frame = av_frame_alloc();
+    if (!frame) {
+        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Could not allocate video frame");
+        return false;
+    }
+
+    width = codecCtx->width;
+    height = codecCtx->height;
+
+    AVRational ms = {1, 1000};
+    AVRational avTimeBase = {1, AV_TIME_BASE};
+    this->startTime = fmtCtx->start_time != AV_NOPTS_VALUE ? av_rescale_q(fmtCtx->start_time, avTimeBase, ms) : 0;
+    this->duration = fmtCtx->duration != AV_NOPTS_VALUE ? av_rescale_q(fmtCtx->duration, avTimeBase, ms) : 0;
+
+    /* start at the last keyframe before startTime */
+    if (startTime >= 0) {
+        int64_t ts = av_rescale_q(startTime, ms, fmtCtx->streams[stream]->time_base);
+        if (av_seek_frame(fmtCtx, stream, ts, AVSEEK_FLAG_BACKWARD) < 0) {
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Could not seek to %lld", (long long)startTime);
+            return false;
+        }
+        avcodec_flush_buffers(codecCtx);
+    }
+    decode_count = 0;
+    read_count = 0;
+
+    av_dump_format(fmtCtx, stream, filename, 0);
+
+    // Frame pool, NV21 with stride width (even sizes as written by FFmpegEncoder)
+    pool.resize(poolSize > 0 ? poolSize : 1);
+    for (size_t i = 0; i < pool.size(); i++) {
+        pool[i].data.resize(width * height * 3 / 2);
+        freeFrames.push(&pool[i]);
+    }
+
+    // Start decoding ahead
+    running = true;
+    finished = false;
+    thread = std::thread(&FFmpegDecoder::DecodeLoop, this);
+
+    __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "Settings: width=%i height=%i pool=%i duration=%lld",
+                        width, height, (int)pool.size(), (long long)duration);
+
+    return true;
+}
+
+void FFmpegDecoder::DecodeLoop() {
+
+    AVPacket pkt;
+    bool ok = true;
+
+    while (ok && av_read_frame(fmtCtx, &pkt) >= 0) {
+        if (pkt.stream_index == stream) {
+            ok = DecodePacket(&pkt);
+        }
+        av_free_packet(&pkt);
+    }
+
+    /* Flush frames delayed by the decoder */
+    if (ok) {
+        av_init_packet(&pkt);
+        pkt.data = NULL;
+        pkt.size = 0;
+        int got_frame = 1;
+        while (ok && got_frame) {
+            if (avcodec_decode_video2(codecCtx, frame, &got_frame, &pkt) < 0) {
+                break;
+            }
+            if (got_frame) {
+                ok = OutputFrame();
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+    }
+    cond.notify_all();
+
+    __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "Finished decoding %i frames", decode_count);
+}
+
+bool FFmpegDecoder::DecodePacket(AVPacket *pkt) {
+
+    int got_frame = 0;
+
+    if (avcodec_decode_video2(codecCtx, frame, &got_frame, pkt) < 0) {
+        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Error decoding video frame");
+        return true;
+    }
+
+    return got_frame ? OutputFrame() : true;
+}
+
+bool FFmpegDecoder::OutputFrame() {
+
+    // Wait for a free buffer in the pool
+    Frame *f;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [this]{ return !freeFrames.empty() || !running; });
+        if (!running) {
+            return false;
+        }
+        f = freeFrames.front();
+        freeFrames.pop();
+    }
+
+    // Recover the original timestamp, which the encoder stored as pts in milliseconds
+    AVRational ms = {1, 1000};
+    f->time = av_rescale_q(av_frame_get_best_effort_timestamp(frame), fmtCtx->streams[stream]->time_base, ms);
+
+    uint8_t *y = &f->data[0];
+    uint8_t *vu = y + width * height;
+
+    if (frame->format == PIX_FMT_YUV420P) {
+        // Copy luma and interleave chroma
+        for (int j = 0; j < height; j++) {
+            memcpy(y + j * width, frame->data[0] + j * frame->linesize[0], width);
+        }
+        yuv420pChromaToNV21(frame->data[1], frame->linesize[1], frame->data[2], frame->linesize[2],
+                            vu, width, width / 2, height / 2);
+    } else {
+        // Other formats: generic converter
+        imgConvertCtx = sws_getCachedContext(imgConvertCtx, width, height, (AVPixelFormat)frame->format,
+                                             width, height, OUTPUT_PIX_FMT, SWS_BILINEAR, NULL, NULL, NULL);
+        uint8_t *dstSlice[] = {y, vu};
+        int dstStride[] = {width, width};
+        sws_scale(imgConvertCtx, frame->data, frame->linesize, 0, height, dstSlice, dstStride);
+    }
+
+    decode_count++;
+
+    // Hand over to the reader
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        readyFrames.push(f);
+    }
+    cond.notify_all();
+
+    return true;
+}
+
+bool FFmpegDecoder::ReadFrame(uint8_t *dataAddr, int64_t &time) {
+
+    // Wait for a decoded frame
+    Frame *f;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [this]{ return !readyFrames.empty() || finished; });
+        if (readyFrames.empty()) {
+            return false;
+        }
+        f = readyFrames.front();
+        readyFrames.pop();
+    }
+
+    memcpy(dataAddr, &f->data[0], f->data.size());
+    time = f->time;
+    read_count++;
+
+    // Return the buffer to the pool
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        freeFrames.push(f);
+    }
+    cond.notify_all();
+
+    return true;
+}
+
+void FFmpegDecoder::CloseFile() {
+
+    __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "Stop decoding and release resources");
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    cond.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+
+    av_frame_free(&frame);
+    sws_freeContext(imgConvertCtx);
+    imgConvertCtx = NULL;
+    if (codecCtx) {
+        avcodec_close(codecCtx);
+        codecCtx = NULL;
+    }
+    avformat_close_input(&fmtCtx);
+
+    readyFrames = std::queue<Frame *>();
+    freeFrames = std::queue<Frame *>();
+    pool.clear();
+
+    __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "Finished, read %i frames", read_count);
+}
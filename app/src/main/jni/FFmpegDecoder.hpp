@@ -0,0 +1,93 @@
+//
+//  FFmpegDecoder.hpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#ifndef FFmpegDecoder_hpp
+#define FFmpegDecoder_hpp
+
+#include <stdio.h>
+#include <string>
+#include <queue>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+}
+
+// Reads recordings written by FFmpegEncoder back as NV21 frames with their original timestamps.
+// Frames are decoded ahead on a separate thread into a fixed pool of buffers.
+class FFmpegDecoder {
+
+public:
+
+    // Constructor
+    FFmpegDecoder() : running(false), finished(true),
+                      fmtCtx(NULL), codecCtx(NULL), frame(NULL), imgConvertCtx(NULL), stream(-1) {;}
+
+    // Open file and start decoding ahead
+    // poolSize: number of decoded frames buffered ahead of the reader
+    // threads: number of decoder threads (0 lets libavcodec decide, one per core)
+    // startTime: if not negative, start at the last keyframe before this time (milliseconds)
+    bool OpenFile(const char *filename, int poolSize, int threads, int64_t startTime = -1);
+
+    // Frame size
+    int GetWidth() const { return width; }
+    int GetHeight() const { return height; }
+
+    // Time span of the file in milliseconds, in the timestamps returned by ReadFrame
+    int64_t GetStartTime() const { return startTime; }
+    int64_t GetDuration() const { return duration; }
+
+    // Copy the next frame into dataAddr as NV21 (width x height * 3/2 bytes).
+    // time receives the timestamp passed to FFmpegEncoder::WriteFrame (milliseconds).
+    // Returns false at the end of the file.
+    bool ReadFrame(uint8_t *dataAddr, int64_t &time);
+
+    // Stop decoding, close file and free resources.
+    void CloseFile();
+
+private:
+
+    // A decoded frame in the pool
+    struct Frame {
+        std::vector<uint8_t> data;
+        int64_t time;
+    };
+
+    void DecodeLoop();                  // Runs on the decode thread
+    bool DecodePacket(AVPacket *pkt);   // Returns false once stopped
+    bool OutputFrame();
+
+    int width;
+    int height;
+    int64_t startTime;
+    int64_t duration;
+    int decode_count;
+    int read_count;
+
+    // Frame pool
+    std::vector<Frame> pool;
+    std::queue<Frame *> freeFrames;     // Available to the decode thread
+    std::queue<Frame *> readyFrames;    // Decoded, in presentation order
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::thread thread;
+    bool running;                       // Cleared to stop the decode thread
+    bool finished;                      // Set by the decode thread at the end of the file
+
+    AVFormatContext *fmtCtx;            // FFmpeg input
+    AVCodecContext *codecCtx;           // FFmpeg video decoder
+    AVFrame *frame;
+    struct SwsContext *imgConvertCtx;   // FFmpeg context convert image, only used for non-YUV420P input.
+    int stream;                         // Index of the video stream
+};
+
+#endif /* FFmpegDecoder_hpp */
@@ -7,8 +7,11 @@
 //
 
 #include "FFmpegEncoder.hpp"
+#include "yuv.hpp"
 #include <iostream>
-#include <android/log.h>
+#include <algorithm>
+#include <cmath>
+#include "log.hpp"
 
 extern "C" {
     #include "libavformat/avformat.h"
@@ -16,19 +19,45 @@ extern "C" {
     #include "libswscale/swscale.h"
     #include "libavutil/imgutils.h"
     #include "libavutil/frame.h"
+    #include "libavutil/dict.h"
+    #include "libavutil/time.h"
 }
 
 #define LOG_TAG "Heartbeat::FFmpegEncoder"
 
 #define STREAM_PIX_FMT PIX_FMT_YUV420P /* default pix_fmt */
 #define INPUT_PIX_FMT PIX_FMT_RGBA
+#define INPUT_PIX_FMT_NV21 PIX_FMT_NV21 /* camera-native preview format */
+#define LOSSLESS_CODEC AV_CODEC_ID_FFV1 /* intra-only lossless codec built into libavcodec */
+#define CROP_SMOOTHING 0.1 /* fraction of the face movement the crop window follows per frame */
+#define CROP_DEADZONE 8 /* face movement in pixels that is ignored by the crop window */
 
-bool FFmpegEncoder::OpenFile(const char *filename, int width, int height, int bitrate, int framerate) {
+bool FFmpegEncoder::OpenFile(const char *filename, int width, int height, int bitrate, int framerate,
+                             int threads, int threadType, int gopSize, const char *preset,
+                             int cropWidth, int cropHeight, bool lossless) {
 
     __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "Encode video file %s", filename);
     __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "Settings: width=%i height=%i bitrate=%i, framerate=%i", width, height, bitrate, framerate);
+    __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "Threading: threads=%i threadType=%i gopSize=%i preset=%s", threads, threadType, gopSize, preset ? preset : "default");
+    __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "Crop: cropWidth=%i cropHeight=%i lossless=%i", cropWidth, cropHeight, lossless);
+
+    // Crop mode encodes a fixed-size window around the face instead of the full frame.
+    // The window is kept at even coordinates so that chroma stays aligned.
+    srcWidth = width;
+    srcHeight = height;
+    cropMode = cropWidth > 0 && cropHeight > 0;
+    if (cropMode) {
+        width = std::min(cropWidth, srcWidth) & ~1;
+        height = std::min(cropHeight, srcHeight) & ~1;
+    }
+    cropCenterValid = false;
+    cropCenterX = srcWidth / 2.0;
+    cropCenterY = srcHeight / 2.0;
+    cropX = 0;
+    cropY = 0;
 
     AVCodec *codec;
+    AVDictionary *opts = NULL;
     
     /* Initialize libavcodec, and register all codecs and formats. */
     av_register_all();
@@ -56,8 +85,9 @@ bool FFmpegEncoder::OpenFile(const char *filename, int width, int height, int bi
         
         AVCodecContext *c;
         
-        /* find the encoder */
-        codec = avcodec_find_encoder(fmt->video_codec);
+        /* find the encoder, lossless recordings use a lossless codec */
+        AVCodecID codecId = lossless ? LOSSLESS_CODEC : fmt->video_codec;
+        codec = avcodec_find_encoder(codecId);
         if (!codec) {
             __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Codec not found");
             return false;
@@ -74,15 +104,27 @@ bool FFmpegEncoder::OpenFile(const char *filename, int width, int height, int bi
         c = st->codec;
         
         avcodec_get_context_defaults3(c, codec);
-        c->codec_id = fmt->video_codec;
+        c->codec_id = codecId;
         c->bit_rate = bitrate;
         c->width    = width;
         c->height   = height;
         c->time_base.num = 1;
         c->time_base.den = framerate;
         c->ticks_per_frame = 1;
-        //c->gop_size      = gopsize; /* emit one intra frame every x frames at most */
+        if (gopSize > 0) {
+            c->gop_size  = gopSize; /* emit one intra frame every x frames at most */
+        }
         c->pix_fmt       = STREAM_PIX_FMT;
+
+        /* Frame threading encodes several frames in parallel at the cost of latency,
+         * slice threading splits each frame; codecs ignore types they do not support. */
+        c->thread_count  = threads;
+        c->thread_type   = threadType;
+
+        /* Codec private options, e.g. the x264 preset */
+        if (preset && preset[0] != '\0') {
+            av_dict_set(&opts, "preset", preset, 0);
+        }
     }
     
     /* Now that all the parameters are set, we can open the
@@ -93,24 +135,40 @@ bool FFmpegEncoder::OpenFile(const char *filename, int width, int height, int bi
         AVCodecContext *c = st->codec;
         
         // Open codec
-        if (avcodec_open2(c, codec, NULL) < 0) {
+        if (avcodec_open2(c, codec, &opts) < 0) {
             __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Could not open codec");
+            av_dict_free(&opts);
             return false;
         }
+
+        // Options left in the dictionary were not consumed by the codec
+        AVDictionaryEntry *e = NULL;
+        while ((e = av_dict_get(opts, "", e, AV_DICT_IGNORE_SUFFIX))) {
+            __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "Codec ignored option %s=%s", e->key, e->value);
+        }
+        av_dict_free(&opts);
+
+        __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "Codec opened with thread_count=%i thread_type=%i", c->thread_count, c->active_thread_type);
         
-        /* Allocate the encoded raw picture. */
+        /* Allocate the encoded raw picture once, it is reused for every frame.
+         * The planes are owned separately so that NV21 input can lend its Y plane. */
         dst = av_frame_alloc();
-        if (!dst) {
+        if (!dst || av_image_alloc(planes, linesizes, c->width, c->height, c->pix_fmt, 16) < 0) {
             __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Could not allocate video frame");
             return false;
         }
-        
-        // Get image conversion context
-        imgConvertCtx = sws_getContext(c->width, c->height, INPUT_PIX_FMT, c->width, c->height, c->pix_fmt, SWS_BILINEAR, NULL, NULL, NULL);
+        dst->format = STREAM_PIX_FMT;
+        dst->width = c->width;
+        dst->height = c->height;
+
+        // Input frames are converted without scaling unless their size differs
+        imgConvertCtx = NULL;
+        UpdateCropOrigin();
         
         frame_count = 0;
         write_count = 0;
         buffer_count = 0;
+        encode_time = 0;
     }
     
     av_dump_format(oc, 0, filename, 1);
@@ -128,6 +186,17 @@ bool FFmpegEncoder::OpenFile(const char *filename, int width, int height, int bi
         __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Error occurred when writing header");
         return false;
     }
+
+    /* Crop windows move with the face, record where each frame was taken from. */
+    if (cropMode) {
+        std::string path = std::string(filename) + ".crop.csv";
+        cropLog.open(path.c_str());
+        if (!cropLog.is_open()) {
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Could not open %s", path.c_str());
+            return false;
+        }
+        cropLog << "pts;x;y;width;height\n";
+    }
     
     return true;
 }
@@ -136,9 +205,22 @@ void FFmpegEncoder::CloseFile() {
 
     __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "Write trailer and release resources");
 
+    if (write_count > 0 && encode_time > 0) {
+        __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "Encoded %i frames at %ix%i in %.3f s: %.2f fps with thread_count=%i thread_type=%i",
+                            write_count, st->codec->width, st->codec->height, encode_time / 1e6,
+                            write_count * 1e6 / encode_time, st->codec->thread_count, st->codec->active_thread_type);
+    }
+
     av_write_trailer(oc);
 
+    if (cropLog.is_open()) {
+        cropLog.close();
+    }
+
+    av_freep(&planes[0]);
     avcodec_free_frame(&dst);
+    sws_freeContext(imgConvertCtx);
+    imgConvertCtx = NULL;
     avcodec_close(st->codec);
 
     // Free streams
@@ -162,15 +244,104 @@ void FFmpegEncoder::WriteFrame(uint8_t *dataAddr, int64_t time) {
     
     __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "Writing a frame");
 
-    int ret;
     AVCodecContext *c = st->codec;
 
-    AVFrame *frame = avcodec_alloc_frame();
-    avpicture_fill((AVPicture *)frame, dataAddr, INPUT_PIX_FMT, c->width, c->height);
-    frame->pts = time;
-    frame->width = c->width;
-    frame->height = c->height;
-    frame->format = INPUT_PIX_FMT;
+    /* Copy to dst in YUV format */
+    for (int i = 0; i < 3; i++) {
+        dst->data[i] = planes[i];
+        dst->linesize[i] = linesizes[i];
+    }
+
+    if (cropMode || (srcWidth == c->width && srcHeight == c->height)) {
+        // Same size or crop: dedicated color conversion kernel
+        rgbaToYuv420p(dataAddr + (cropY * srcWidth + cropX) * 4, srcWidth * 4, dst->data, dst->linesize, c->width, c->height);
+    } else {
+        // Resize: generic scaler
+        imgConvertCtx = sws_getCachedContext(imgConvertCtx, srcWidth, srcHeight, INPUT_PIX_FMT,
+                                             c->width, c->height, c->pix_fmt, SWS_BILINEAR, NULL, NULL, NULL);
+        const uint8_t *srcSlice[] = {dataAddr};
+        int srcStride[] = {srcWidth * 4};
+        sws_scale(imgConvertCtx, srcSlice, srcStride, 0, srcHeight, dst->data, dst->linesize);
+    }
+
+    EncodeFrame(time);
+}
+
+void FFmpegEncoder::WriteFrameNV21(uint8_t *dataAddr, int64_t time) {
+
+    __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "Writing an NV21 frame");
+
+    AVCodecContext *c = st->codec;
+
+    uint8_t *vu = dataAddr + srcWidth * srcHeight;
+
+    if (cropMode || (srcWidth == c->width && srcHeight == c->height)) {
+        // Same size or crop: encode the camera Y plane in place and only split the interleaved chroma
+        dst->data[0] = dataAddr + cropY * srcWidth + cropX;
+        dst->linesize[0] = srcWidth;
+        for (int i = 1; i < 3; i++) {
+            dst->data[i] = planes[i];
+            dst->linesize[i] = linesizes[i];
+        }
+        nv21ChromaToYuv420p(vu + (cropY / 2) * srcWidth + cropX, srcWidth,
+                            dst->data[1], dst->linesize[1], dst->data[2], dst->linesize[2],
+                            (c->width + 1) / 2, (c->height + 1) / 2);
+    } else {
+        // Resize: generic scaler
+        for (int i = 0; i < 3; i++) {
+            dst->data[i] = planes[i];
+            dst->linesize[i] = linesizes[i];
+        }
+        imgConvertCtx = sws_getCachedContext(imgConvertCtx, srcWidth, srcHeight, INPUT_PIX_FMT_NV21,
+                                             c->width, c->height, c->pix_fmt, SWS_BILINEAR, NULL, NULL, NULL);
+        const uint8_t *srcSlice[] = {dataAddr, vu};
+        int srcStride[] = {srcWidth, srcWidth};
+        sws_scale(imgConvertCtx, srcSlice, srcStride, 0, srcHeight, dst->data, dst->linesize);
+    }
+
+    EncodeFrame(time);
+}
+
+void FFmpegEncoder::SetCropBox(int x, int y, int width, int height) {
+
+    if (!cropMode) {
+        return;
+    }
+
+    const double cx = x + width / 2.0;
+    const double cy = y + height / 2.0;
+
+    if (!cropCenterValid) {
+        // First face: jump to it
+        cropCenterX = cx;
+        cropCenterY = cy;
+        cropCenterValid = true;
+    } else if (std::abs(cx - cropCenterX) > CROP_DEADZONE || std::abs(cy - cropCenterY) > CROP_DEADZONE) {
+        // Follow larger movements smoothly, ignore tracking jitter
+        cropCenterX += CROP_SMOOTHING * (cx - cropCenterX);
+        cropCenterY += CROP_SMOOTHING * (cy - cropCenterY);
+    }
+
+    UpdateCropOrigin();
+}
+
+void FFmpegEncoder::UpdateCropOrigin() {
+
+    if (!cropMode) {
+        return;
+    }
+
+    AVCodecContext *c = st->codec;
+    int x = (int)(cropCenterX - c->width / 2.0 + 0.5);
+    int y = (int)(cropCenterY - c->height / 2.0 + 0.5);
+    cropX = std::max(0, std::min(x, srcWidth - c->width)) & ~1;
+    cropY = std::max(0, std::min(y, srcHeight - c->height)) & ~1;
+}
+
+void FFmpegEncoder::EncodeFrame(int64_t time) {
+
+    int ret;
+    AVCodecContext *c = st->codec;
 
     /* encode the image */
     AVPacket pkt;
@@ -180,20 +351,17 @@ void FFmpegEncoder::WriteFrame(uint8_t *dataAddr, int64_t time) {
     pkt.data = NULL;    // packet data will be allocated by the encoder
     pkt.size = 0;
 
-    /* Copy to dst in YUV format */
-    int bufferImgSize = avpicture_get_size(c->pix_fmt, c->width, c->height);
-    uint8_t *buffer = (uint8_t*)av_mallocz(bufferImgSize);
-    avpicture_fill((AVPicture *)dst, buffer, c->pix_fmt, c->width, c->height);
-    dst->format = STREAM_PIX_FMT;
-    dst->width = c->width;
-    dst->height = c->height;
     dst->pts = av_rescale_q(frame_count++, c->time_base, st->time_base);
 
-    sws_scale(imgConvertCtx, frame->data, frame->linesize, 0, c->height, dst->data, dst->linesize);
-
     pts_queue.push(time);
 
+    if (cropMode) {
+        cropLog << time << ";" << cropX << ";" << cropY << ";" << c->width << ";" << c->height << "\n";
+    }
+
+    int64_t start = av_gettime();
     ret = avcodec_encode_video2(c, &pkt, dst, &got_output);
+    encode_time += av_gettime() - start;
     if (ret < 0) {
         __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Error encoding video frame");
         exit(1);
@@ -202,7 +370,7 @@ void FFmpegEncoder::WriteFrame(uint8_t *dataAddr, int64_t time) {
     /* If size is zero, it means the image was buffered. */
     if (got_output) {
 
-        int64_t &pts = pts_queue.front();
+        int64_t pts = pts_queue.front();
         pts_queue.pop();
 
         pkt.pts = pts;
@@ -231,8 +399,6 @@ void FFmpegEncoder::WriteFrame(uint8_t *dataAddr, int64_t time) {
         __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Error while writing video frame");
         exit(1);
     }
-
-    avcodec_free_frame(&frame);
 }
 
 void FFmpegEncoder::WriteBufferedFrames() {
@@ -249,14 +415,16 @@ void FFmpegEncoder::WriteBufferedFrames() {
         pkt.data = NULL;    // packet data will be allocated by the encoder
         pkt.size = 0;
 
+        int64_t start = av_gettime();
         ret = avcodec_encode_video2(c, &pkt, NULL, &got_output);
+        encode_time += av_gettime() - start;
         if (ret < 0) {
             __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Error encoding video frame");
             exit(1);
         }
 
         if (got_output) {
-            int64_t &pts = pts_queue.front();
+            int64_t pts = pts_queue.front();
             pts_queue.pop();
             pkt.pts = pts;
             pkt.dts = pts;
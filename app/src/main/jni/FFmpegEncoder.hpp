@@ -12,12 +12,14 @@
 #include <stdio.h>
 #include <string>
 #include <queue>
+#include <fstream>
 
 extern "C" {
 #include <libavformat/avformat.h>
 #include <libavcodec/avcodec.h>
 #include <libswscale/swscale.h>
 #include <libavutil/imgutils.h>
+#include <libavutil/dict.h>
 }
 
 class FFmpegEncoder {
@@ -28,10 +30,25 @@ public:
     FFmpegEncoder() : fmt(NULL), oc(NULL), st(NULL), imgConvertCtx(NULL), dst(NULL) {;}
     
     // Open file
-    bool OpenFile(const char *filename, int width, int height, int bitrate, int framerate);
+    // threads: number of encoder threads (0 lets libavcodec decide)
+    // threadType: FF_THREAD_FRAME and/or FF_THREAD_SLICE bitmask (0 disables threading)
+    // gopSize: maximum distance between intra frames (0 keeps the codec default)
+    // preset: encoder preset such as "ultrafast" (NULL or empty keeps the codec default)
+    // cropWidth, cropHeight: size of the window around the face to record (0 records full frames).
+    //     The window origin of every frame is written to <filename>.crop.csv, keyed by pts.
+    // lossless: encode with a lossless codec, ignoring bitrate
+    bool OpenFile(const char *filename, int width, int height, int bitrate, int framerate,
+                  int threads, int threadType, int gopSize, const char *preset,
+                  int cropWidth, int cropHeight, bool lossless);
     
     // Write next frame.
     void WriteFrame(uint8_t *dataAddr, int64_t time);
+
+    // Write next frame from a camera-native NV21 buffer (Y plane followed by interleaved VU).
+    void WriteFrameNV21(uint8_t *dataAddr, int64_t time);
+    
+    // Update the face box the crop window follows (in frame coordinates).
+    void SetCropBox(int x, int y, int width, int height);
     
     // Write buffered frames.
     void WriteBufferedFrames();
@@ -40,18 +57,36 @@ public:
     void CloseFile();
     
 private:
+
+    // Encode dst and write any packet the codec returns.
+    void EncodeFrame(int64_t time);
+
+    // Place the crop window around the smoothed face center, within the frame.
+    void UpdateCropOrigin();
     
     int frame_count;
     int write_count;
     int buffer_count;
+    int64_t encode_time;                // Time spent in the encoder in microseconds
+    int srcWidth;                       // Size of the input frames
+    int srcHeight;
+    bool cropMode;
+    bool cropCenterValid;
+    double cropCenterX;                 // Smoothed face center
+    double cropCenterY;
+    int cropX;                          // Origin of the crop window
+    int cropY;
+    std::ofstream cropLog;              // Crop window per frame
     std::queue<int64_t> pts_queue;
     
     AVFrame *dst;
+    uint8_t *planes[4];                 // YUV planes owned by the encoder
+    int linesizes[4];
     
     AVOutputFormat *fmt;                //
     AVFormatContext* oc;                //
     AVStream *st;                       // FFmpeg stream
-    struct SwsContext *imgConvertCtx;   // FFmpeg context convert image.
+    struct SwsContext *imgConvertCtx;   // FFmpeg context convert image, only used when resizing.
 };
 
 #endif /* FFmpegEncoder_hpp */
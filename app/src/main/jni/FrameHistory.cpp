@@ -0,0 +1,33 @@
+//
+//  FrameHistory.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#include "FrameHistory.hpp"
+
+#include <opencv2/video/video.hpp>
+
+using namespace cv;
+using namespace std;
+
+FrameHistory::FrameHistory(int length, Size winSize, int maxLevel) :
+    slots(max(length, 1)), latest(0), count(0), winSize(winSize), maxLevel(maxLevel) {;}
+
+void FrameHistory::push(const Mat &frameGray) {
+
+    latest = (latest + 1) % slots.size();
+
+    // Levels are reallocated only if the frame size changes. The frame is always copied into
+    // the bordered first level instead of being referenced, as the caller reuses its buffer.
+    buildOpticalFlowPyramid(frameGray, slots[latest], winSize, maxLevel, true,
+                            BORDER_REFLECT_101, BORDER_CONSTANT, false);
+
+    count = min(count + 1, (int)slots.size());
+}
+
+const vector<Mat> &FrameHistory::get(int age) const {
+    CV_Assert(age >= 0 && age < count);
+    return slots[(latest + slots.size() - age) % slots.size()];
+}
@@ -0,0 +1,47 @@
+//
+//  FrameHistory.hpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#ifndef FrameHistory_hpp
+#define FrameHistory_hpp
+
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+// The most recent gray frames as optical flow pyramids, for calcOpticalFlowPyrLK.
+// Slots are allocated once: each frame is written directly into the oldest slot when its
+// pyramid is built, and older frames are kept by rotating the slots, without copies.
+class FrameHistory {
+
+public:
+
+    // length: frames kept, winSize and maxLevel as passed to calcOpticalFlowPyrLK
+    explicit FrameHistory(int length = 2, cv::Size winSize = cv::Size(21, 21), int maxLevel = 3);
+
+    // Add the next frame, replacing the oldest one
+    void push(const cv::Mat &frameGray);
+
+    // Pyramid of the frame pushed age frames ago, 0 being the latest
+    const std::vector<cv::Mat> &get(int age) const;
+
+    // Number of frames available
+    int size() const { return count; }
+
+    void clear() { count = 0; }
+
+    cv::Size getWinSize() const { return winSize; }
+    int getMaxLevel() const { return maxLevel; }
+
+private:
+
+    std::vector<std::vector<cv::Mat> > slots;
+    int latest;         // Slot of the latest frame
+    int count;
+    cv::Size winSize;
+    int maxLevel;
+};
+
+#endif /* FrameHistory_hpp */
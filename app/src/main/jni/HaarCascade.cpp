@@ -0,0 +1,419 @@
+//
+//  HaarCascade.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#include "HaarCascade.hpp"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/objdetect/objdetect.hpp>
+
+#include "log.hpp"
+
+#define LOG_TAG "Heartbeat::HaarCascade"
+
+#define MAGIC "HBHAAR\0"
+#define VERSION 2
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+#define THRESHOLD_EPS 1e-5f     /* stage thresholds are lowered as in cv::CascadeClassifier */
+#define GROUP_EPS 0.2
+
+using namespace cv;
+using namespace std;
+
+// FNV-1a over 32-bit words, all sections are whole words
+static uint32_t checksum(const void *data, size_t bytes, uint32_t hash = FNV_OFFSET) {
+    const uint32_t *words = (const uint32_t *)data;
+    for (size_t i = 0; i < bytes / sizeof(uint32_t); i++) {
+        hash = (hash ^ words[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+HaarCascade::~HaarCascade() {
+    if (data) {
+        munmap(data, length);
+    }
+}
+
+Size HaarCascade::getOriginalWindowSize() const {
+    return empty() ? Size() : Size(header->width, header->height);
+}
+
+bool HaarCascade::convert(const FileNode &root, const string &path, const Source &source) {
+
+    if ((string)root["stageType"] != "BOOST" || (string)root["featureType"] != "HAAR") {
+        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Only BOOST cascades of HAAR features can be converted");
+        return false;
+    }
+
+    Header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, MAGIC, sizeof(h.magic));
+    h.version = VERSION;
+    h.sourceSize = (uint32_t)source.size;
+    h.sourceTime = (uint32_t)source.time;
+    h.width = (int)root["width"];
+    h.height = (int)root["height"];
+
+    vector<Stage> stages;
+    vector<Tree> trees;
+    vector<Node> nodes;
+    vector<float> leaves;
+    vector<Feature> features;
+
+    FileNode stagesNode = root["stages"];
+    for (FileNodeIterator it = stagesNode.begin(); it != stagesNode.end(); ++it) {
+        FileNode stageNode = *it;
+        Stage stage;
+        stage.firstTree = (int32_t)trees.size();
+        stage.threshold = (float)stageNode["stageThreshold"] - THRESHOLD_EPS;
+        FileNode weakNodes = stageNode["weakClassifiers"];
+        for (FileNodeIterator wit = weakNodes.begin(); wit != weakNodes.end(); ++wit) {
+            FileNode internalNodes = (*wit)["internalNodes"];
+            FileNode leafValues = (*wit)["leafValues"];
+            // Four values per node, categorical (LBP) splits are not supported
+            if (internalNodes.size() == 0 || internalNodes.size() % 4 != 0 ||
+                leafValues.size() != internalNodes.size() / 4 + 1) {
+                __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Unsupported weak classifier in stage %d", (int)stages.size());
+                return false;
+            }
+            Tree tree;
+            tree.nodeCount = (int32_t)internalNodes.size() / 4;
+            FileNodeIterator nit = internalNodes.begin();
+            for (int i = 0; i < tree.nodeCount; i++) {
+                Node node;
+                nit >> node.left >> node.right >> node.feature >> node.threshold;
+                nodes.push_back(node);
+            }
+            FileNodeIterator lit = leafValues.begin();
+            for (int i = 0; i <= tree.nodeCount; i++) {
+                float leaf;
+                lit >> leaf;
+                leaves.push_back(leaf);
+            }
+            trees.push_back(tree);
+        }
+        stage.treeCount = (int32_t)trees.size() - stage.firstTree;
+        stages.push_back(stage);
+    }
+
+    FileNode featuresNode = root["features"];
+    for (FileNodeIterator it = featuresNode.begin(); it != featuresNode.end(); ++it) {
+        Feature feature;
+        memset(&feature, 0, sizeof(feature));
+        feature.tilted = (int)(*it)["tilted"] != 0;
+        FileNode rectsNode = (*it)["rects"];
+        if (rectsNode.size() == 0 || rectsNode.size() > 3) {
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Unsupported feature %d", (int)features.size());
+            return false;
+        }
+        int i = 0;
+        for (FileNodeIterator rit = rectsNode.begin(); rit != rectsNode.end(); ++rit, i++) {
+            FileNodeIterator vit = (*rit).begin();
+            vit >> feature.rects[i].x >> feature.rects[i].y >> feature.rects[i].width >> feature.rects[i].height
+                >> feature.rects[i].weight;
+        }
+        h.tilted |= feature.tilted;
+        features.push_back(feature);
+    }
+
+    if (stages.empty() || features.empty()) {
+        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Empty cascade");
+        return false;
+    }
+    h.stageCount = (int32_t)stages.size();
+    h.treeCount = (int32_t)trees.size();
+    h.nodeCount = (int32_t)nodes.size();
+    h.leafCount = (int32_t)leaves.size();
+    h.featureCount = (int32_t)features.size();
+    uint32_t hash = checksum(&stages[0], stages.size() * sizeof(Stage));
+    hash = checksum(&trees[0], trees.size() * sizeof(Tree), hash);
+    hash = checksum(&nodes[0], nodes.size() * sizeof(Node), hash);
+    hash = checksum(&leaves[0], leaves.size() * sizeof(float), hash);
+    h.checksum = checksum(&features[0], features.size() * sizeof(Feature), hash);
+
+    // Write next to the final file and rename, so that readers never see a partial file
+    const string tmpPath = path + ".tmp";
+    FILE *f = fopen(tmpPath.c_str(), "wb");
+    if (!f) {
+        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Could not write %s", tmpPath.c_str());
+        return false;
+    }
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    ok = ok && fwrite(&stages[0], sizeof(Stage), stages.size(), f) == stages.size();
+    ok = ok && fwrite(&trees[0], sizeof(Tree), trees.size(), f) == trees.size();
+    ok = ok && fwrite(&nodes[0], sizeof(Node), nodes.size(), f) == nodes.size();
+    ok = ok && fwrite(&leaves[0], sizeof(float), leaves.size(), f) == leaves.size();
+    ok = ok && fwrite(&features[0], sizeof(Feature), features.size(), f) == features.size();
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Could not write %s", path.c_str());
+        remove(tmpPath.c_str());
+        return false;
+    }
+
+    __android_log_print(ANDROID_LOG_INFO, LOG_TAG, "Converted cascade to %s: stages=%d trees=%d nodes=%d features=%d",
+                        path.c_str(), h.stageCount, h.treeCount, h.nodeCount, h.featureCount);
+
+    return true;
+}
+
+bool HaarCascade::load(const string &path, const Source &source) {
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Header)) {
+        close(fd);
+        return false;
+    }
+    void *mapped = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Could not map %s", path.c_str());
+        return false;
+    }
+
+    if (data) {
+        munmap(data, length);
+    }
+    data = mapped;
+    length = st.st_size;
+
+    // Sections follow the header back to back, all 4-byte aligned
+    header = (const Header *)data;
+    stages = (const Stage *)(header + 1);
+    trees = (const Tree *)(stages + header->stageCount);
+    nodes = (const Node *)(trees + header->treeCount);
+    leaves = (const float *)(nodes + header->nodeCount);
+    features = (const Feature *)(leaves + header->leafCount);
+
+    if (!validate(source)) {
+        __android_log_print(ANDROID_LOG_WARN, LOG_TAG, "Invalid or outdated cascade %s", path.c_str());
+        munmap(data, length);
+        data = NULL;
+        length = 0;
+        return false;
+    }
+
+    return true;
+}
+
+bool HaarCascade::validate(const Source &source) const {
+
+    const Header &h = *header;
+    if (memcmp(h.magic, MAGIC, sizeof(h.magic)) != 0 || h.version != VERSION ||
+        h.sourceSize != (uint32_t)source.size || h.sourceTime != (uint32_t)source.time) {
+        return false;
+    }
+    const int maxCount = (int)(length / sizeof(int32_t));
+    if (h.stageCount > maxCount || h.treeCount > maxCount || h.nodeCount > maxCount ||
+        h.leafCount > maxCount || h.featureCount > maxCount) {
+        return false;
+    }
+    if (h.width < 3 || h.height < 3 || h.stageCount <= 0 || h.treeCount <= 0 ||
+        h.nodeCount <= 0 || h.leafCount <= 0 || h.featureCount <= 0) {
+        return false;
+    }
+    const size_t expected = sizeof(Header) + h.stageCount * sizeof(Stage) + h.treeCount * sizeof(Tree) +
+                            h.nodeCount * sizeof(Node) + h.leafCount * sizeof(float) + h.featureCount * sizeof(Feature);
+    if (expected != length || checksum(header + 1, length - sizeof(Header)) != h.checksum) {
+        return false;
+    }
+
+    // Everything evaluation indexes must stay inside the file and the detection window
+    int tree = 0;
+    for (int i = 0; i < h.stageCount; i++) {
+        if (stages[i].firstTree != tree || stages[i].treeCount <= 0) {
+            return false;
+        }
+        tree += stages[i].treeCount;
+    }
+    if (tree != h.treeCount) {
+        return false;
+    }
+    int nodeOffset = 0, leafOffset = 0;
+    for (int i = 0; i < h.treeCount; i++) {
+        const int n = trees[i].nodeCount;
+        if (n <= 0 || nodeOffset + n > h.nodeCount || leafOffset + n + 1 > h.leafCount) {
+            return false;
+        }
+        for (int j = nodeOffset; j < nodeOffset + n; j++) {
+            const Node &node = nodes[j];
+            if (node.left >= n || node.left < -n || node.right >= n || node.right < -n ||
+                node.feature < 0 || node.feature >= h.featureCount) {
+                return false;
+            }
+        }
+        nodeOffset += n;
+        leafOffset += n + 1;
+    }
+    if (nodeOffset != h.nodeCount || leafOffset != h.leafCount) {
+        return false;
+    }
+    for (int i = 0; i < h.featureCount; i++) {
+        for (int k = 0; k < 3; k++) {
+            const int x = features[i].rects[k].x, y = features[i].rects[k].y;
+            const int w = features[i].rects[k].width, ht = features[i].rects[k].height;
+            const bool inside = features[i].tilted ?
+                x - ht >= 0 && x + w <= h.width && y >= 0 && y + w + ht <= h.height :
+                x >= 0 && x + w <= h.width && y >= 0 && y + ht <= h.height;
+            if (w < 0 || ht < 0 || !inside) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void HaarCascade::detectMultiScale(const Mat &image, vector<Rect> &objects,
+                                   double scaleFactor, int minNeighbors, Size minSize, Buffers &buffers) const {
+
+    objects.clear();
+    if (empty() || image.empty()) {
+        return;
+    }
+    CV_Assert(image.type() == CV_8UC1 && scaleFactor > 1);
+
+    // Same pyramid as cv::CascadeClassifier, scales are single precision there too
+    const Size window(header->width, header->height);
+    for (double factor = 1; ; factor *= scaleFactor) {
+        const float scale = (float)factor;
+        Size windowSize(cvRound(window.width * scale), cvRound(window.height * scale));
+        Size scaledSize(cvRound(image.cols / scale), cvRound(image.rows / scale));
+        if (scaledSize.width <= window.width || scaledSize.height <= window.height ||
+            windowSize.width > image.cols || windowSize.height > image.rows) {
+            break;
+        }
+        if (windowSize.width < minSize.width || windowSize.height < minSize.height) {
+            continue;
+        }
+
+        const Mat *scaled = &image;
+        if (scaledSize != image.size()) {
+            resize(image, buffers.scaled, scaledSize, 0, 0, INTER_LINEAR);
+            scaled = &buffers.scaled;
+        }
+        if (header->tilted) {
+            integral(*scaled, buffers.sum, buffers.sqsum, buffers.tilted, CV_32S, CV_64F);
+        } else {
+            integral(*scaled, buffers.sum, buffers.sqsum, CV_32S, CV_64F);
+        }
+        scan(buffers, scale, objects);
+    }
+
+    groupRectangles(objects, minNeighbors, GROUP_EPS);
+}
+
+void HaarCascade::scan(Buffers &buffers, float factor, vector<Rect> &candidates) const {
+
+    const Mat &sum = buffers.sum;
+    const int step = (int)sum.step1();          // Same for sqsum and tilted
+    const int width = header->width, height = header->height;
+    const Size windowSize(cvRound(width * factor), cvRound(height * factor));
+    const int ystep = factor >= 2 ? 1 : 2;
+
+    // Rectangle corners relative to the window origin for this step
+    vector<int> &offsets = buffers.offsets;
+    offsets.resize(header->featureCount * 12);
+    for (int i = 0; i < header->featureCount; i++) {
+        const Feature &feature = features[i];
+        int *ofs = &offsets[i * 12];
+        for (int k = 0; k < 3; k++, ofs += 4) {
+            const int x = feature.rects[k].x, y = feature.rects[k].y;
+            const int w = feature.rects[k].width, h = feature.rects[k].height;
+            if (feature.tilted) {
+                ofs[0] = y * step + x;
+                ofs[1] = (y + h) * step + x - h;
+                ofs[2] = (y + w) * step + x + w;
+                ofs[3] = (y + w + h) * step + x + w - h;
+            } else {
+                ofs[0] = y * step + x;
+                ofs[1] = y * step + x + w;
+                ofs[2] = (y + h) * step + x;
+                ofs[3] = (y + h) * step + x + w;
+            }
+        }
+    }
+
+    // Variance normalisation over the window without its border
+    const int n0 = step + 1, n1 = step + width - 1;
+    const int n2 = (height - 1) * step + 1, n3 = (height - 1) * step + width - 1;
+    const double area = (width - 2) * (height - 2);
+
+    const int xEnd = sum.cols - width, yEnd = sum.rows - height;
+    for (int y = 0; y < yEnd; y += ystep) {
+        const int *sumRow = sum.ptr<int>(y);
+        const double *sqsumRow = buffers.sqsum.ptr<double>(y);
+        const int *tiltedRow = header->tilted ? buffers.tilted.ptr<int>(y) : sumRow;
+        for (int x = 0; x < xEnd; x += ystep) {
+            const int *p = sumRow + x;
+            const double *q = sqsumRow + x;
+            const int *t = tiltedRow + x;
+
+            const int valsum = p[n0] - p[n1] - p[n2] + p[n3];
+            const double valsqsum = q[n0] - q[n1] - q[n2] + q[n3];
+            const double nf = area * valsqsum - (double)valsum * valsum;
+            if (nf <= 0) {
+                continue;
+            }
+            const float norm = (float)(1. / sqrt(nf));
+            if (!(area * norm < 1e-1)) {
+                continue;
+            }
+
+            // Evaluate stages until one rejects the window
+            int result = 1;
+            const Tree *tree = trees;
+            const Node *node0 = nodes;
+            const float *leaf0 = leaves;
+            for (int s = 0; s < header->stageCount && result > 0; s++) {
+                const Stage &stage = stages[s];
+                double stageSum = 0;
+                for (int k = 0; k < stage.treeCount; k++, tree++) {
+                    int idx = 0;
+                    do {
+                        const Node &node = node0[idx];
+                        const Feature &feature = features[node.feature];
+                        const int *ofs = &offsets[node.feature * 12];
+                        const int *base = feature.tilted ? t : p;
+                        float value = feature.rects[0].weight * (float)(base[ofs[0]] - base[ofs[1]] - base[ofs[2]] + base[ofs[3]]) +
+                                      feature.rects[1].weight * (float)(base[ofs[4]] - base[ofs[5]] - base[ofs[6]] + base[ofs[7]]);
+                        if (feature.rects[2].weight != 0) {
+                            value += feature.rects[2].weight * (float)(base[ofs[8]] - base[ofs[9]] - base[ofs[10]] + base[ofs[11]]);
+                        }
+                        value *= norm;
+                        idx = value < node.threshold ? node.left : node.right;
+                    } while (idx > 0);
+                    stageSum += leaf0[-idx];
+                    node0 += tree->nodeCount;
+                    leaf0 += tree->nodeCount + 1;
+                }
+                if (stageSum < stage.threshold) {
+                    result = -s;
+                }
+            }
+
+            if (result > 0) {
+                candidates.push_back(Rect(cvRound(x * factor), cvRound(y * factor), windowSize.width, windowSize.height));
+            } else if (result == 0) {
+                // Rejected by the first stage, the neighbour most likely will be too
+                x += ystep;
+            }
+        }
+    }
+}
@@ -0,0 +1,113 @@
+//
+//  HaarCascade.hpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#ifndef HaarCascade_hpp
+#define HaarCascade_hpp
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+// Haar cascade in a compact binary format that is memory-mapped and evaluated in place,
+// so that loading costs no parsing at all. Files are converted once from OpenCV's XML cascades
+// (BOOST stages of HAAR features, stumps or trees) and detection gives the same results as
+// cv::CascadeClassifier. The model is read-only and can be shared between threads;
+// each concurrent caller brings its own Buffers.
+class HaarCascade {
+
+public:
+
+    // Scratch for one caller
+    struct Buffers {
+        cv::Mat scaled;
+        cv::Mat sum;
+        cv::Mat sqsum;
+        cv::Mat tilted;
+        std::vector<int> offsets;       // Feature rectangle corners for the current integral image step
+    };
+
+    // Size and modification time of the XML file a binary cascade is converted from
+    struct Source {
+        int64_t size;
+        int64_t time;
+    };
+
+    HaarCascade() : data(NULL), length(0), header(NULL) {;}
+    ~HaarCascade();
+
+    // Convert a cascade read from XML, false if it is not a BOOST cascade of HAAR features
+    static bool convert(const cv::FileNode &root, const std::string &path, const Source &source);
+
+    // Map a converted file, false if it is missing, corrupt, of another format version
+    // or converted from a different source
+    bool load(const std::string &path, const Source &source);
+
+    bool empty() const { return data == NULL; }
+    cv::Size getOriginalWindowSize() const;
+
+    // As cv::CascadeClassifier::detectMultiScale, without maximum size
+    void detectMultiScale(const cv::Mat &image, std::vector<cv::Rect> &objects,
+                          double scaleFactor, int minNeighbors, cv::Size minSize, Buffers &buffers) const;
+
+private:
+
+    HaarCascade(const HaarCascade &);
+    HaarCascade &operator=(const HaarCascade &);
+
+    // File layout, native byte order, all fields 4 bytes: Header, Stage[], Tree[], Node[], float leaves[], Feature[]
+    struct Header {
+        char magic[8];
+        int32_t version;
+        uint32_t sourceSize;        // Low 32 bits of Source
+        uint32_t sourceTime;
+        uint32_t checksum;          // Of everything after the header
+        int32_t width;
+        int32_t height;
+        int32_t stageCount;
+        int32_t treeCount;
+        int32_t nodeCount;
+        int32_t leafCount;
+        int32_t featureCount;
+        int32_t tilted;             // Any feature is tilted
+    };
+    struct Stage {
+        int32_t firstTree;
+        int32_t treeCount;
+        float threshold;
+    };
+    struct Tree {
+        int32_t nodeCount;          // Followed by nodeCount + 1 leaves
+    };
+    struct Node {
+        int32_t left;               // > 0: next node in the tree, <= 0: negated leaf index
+        int32_t right;
+        int32_t feature;
+        float threshold;
+    };
+    struct Feature {
+        int32_t tilted;
+        struct {
+            int32_t x, y, width, height;
+            float weight;           // 0 for unused rectangles
+        } rects[3];
+    };
+
+    bool validate(const Source &source) const;
+    void scan(Buffers &buffers, float factor, std::vector<cv::Rect> &candidates) const;
+
+    void *data;                     // Mapped file
+    size_t length;
+    const Header *header;
+    const Stage *stages;
+    const Tree *trees;
+    const Node *nodes;
+    const float *leaves;
+    const Feature *features;
+};
+
+#endif /* HaarCascade_hpp */
@@ -8,12 +8,14 @@
 
 #include "RPPG.hpp"
 
-#include <android/log.h>
+#include <algorithm>
+#include "log.hpp"
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/core/core.hpp>
 #include <opencv2/video/video.hpp>
 
+#include "CascadeRegistry.hpp"
 #include "opencv.hpp"
 
 using namespace cv;
@@ -27,212 +29,492 @@ using namespace std;
 #define MIN_CORNERS 5
 #define QUALITY_LEVEL 0.01
 #define MIN_DISTANCE 25
+#define CORNER_MARGIN 3                 // Pixels around the tracking region for corner detection
+#define MAX_ASSOCIATION_DISTANCE 0.5    // Relative to the box width, for identities across rescans
+#define MAX_FB_ERROR 2                  // Forward-backward error of a tracked corner (px)
+#define FB_ERROR_SMOOTHING 0.1
+#define MAX_SCALE_DRIFT 0.2             // Relative scale change since the scan at zero confidence
+#define MAX_ROTATION_DRIFT 0.35         // Rotation since the scan at zero confidence (rad)
+#define REL_MIN_EYE_SIZE 0.15           // Relative to the box width
+#define MAX_EYE_TILT 0.5                // Vertical over horizontal eye distance
+#define ROI_TOP 0.7                     // Forehead above the eye line, in eye distances
+#define ROI_BOTTOM 0.32
+#define SNR_PEAK_WIDTH 1                // Bins around the peak and its harmonic that count as signal
+#define MIN_SKIN_FRACTION 0.25         // Of the ROI, below this its plain mean is taken
+
+// In the order of RPPGAlgorithm, compared in this order after the primary one
+static const char *const ALGORITHM_NAMES[] = {"g", "pca", "xminay"};
+#define ALGORITHMS (int)(sizeof(ALGORITHM_NAMES) / sizeof(ALGORITHM_NAMES[0]))
 
 #define LOG_TAG "Heartbeat::RPPG"
 #define LOGD(...) ((void)__android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__))
 
-bool RPPG::load(jobject listener, JNIEnv *jenv,
+bool RPPG::load(const ResultCallback &callback,
                 int algorithm,
+                const bool compareAlgorithms,
                 const int width, const int height, const double timeBase, const int downsample,
                 const double samplingFrequency, const double rescanFrequency,
+                const double minTrackingConfidence,
                 const int minSignalSize, const int maxSignalSize,
+                const double minSignalQuality,
+                const int spectrum,
+                const int spectralZoom,
+                const int welchLength,
+                const vector<double> &quantiles,
+                const bool singlePrecision,
+                const bool motionCompensation,
+                const int gridSize,
+                const bool skinDetection,
+                const int maxFaces, const int threads,
                 const string &logPath, const string &classifierPath,
+                const string &eyeClassifierPath,
                 const bool log, const bool gui) {
 
-    this->algorithm = (RPPGAlgorithm)algorithm;
+    // Primary algorithm first, it alone decides whether a face is reacquired
+    this->algorithms.assign(1, (RPPGAlgorithm)algorithm);
+    for (int a = 0; compareAlgorithms && a < ALGORITHMS; a++) {
+        if (a != algorithm) {
+            this->algorithms.push_back((RPPGAlgorithm)a);
+        }
+    }
+    this->filters.clear();
+    this->normalizedTraces = false;
+    this->detrendedTraces = false;
+    bool color = false;
+    for (size_t i = 0; i < algorithms.size(); i++) {
+        switch (algorithms[i]) {
+            case g:
+                this->filters.push_back(singlePrecision ? &RPPG::filterGreen<float> : &RPPG::filterGreen<double>);
+                this->detrendedTraces = true;
+                break;
+            case pca:
+                this->filters.push_back(singlePrecision ? &RPPG::filterPca<float> : &RPPG::filterPca<double>);
+                this->detrendedTraces = true;
+                color = true;
+                break;
+            case xminay:
+                this->filters.push_back(singlePrecision ? &RPPG::filterXminay<float> : &RPPG::filterXminay<double>);
+                this->normalizedTraces = true;
+                color = true;
+                break;
+        }
+    }
+
+    // Green alone unless an algorithm needs all channels
+    if (color) {
+        this->preprocessor = singlePrecision ? &RPPG::preprocess<3, float> : &RPPG::preprocess<3, double>;
+    } else {
+        this->preprocessor = singlePrecision ? &RPPG::preprocess<1, float> : &RPPG::preprocess<1, double>;
+    }
+    this->callback = callback;
     this->guiMode = gui;
-    this->lastSamplingTime = 0;
     this->logMode = log;
     this->minFaceSize = Size(min(width, height) * REL_MIN_FACE_SIZE, min(width, height) * REL_MIN_FACE_SIZE);
     this->maxSignalSize = maxSignalSize;
     this->minSignalSize = minSignalSize;
+    this->minSignalQuality = minSignalQuality;
+    this->spectrum = (RPPGSpectrum)spectrum;
+    this->spectralZoom = spectrum == fft ? 1 : max(spectralZoom, 1);
+    // Segments longer than the signal never complete, shorter ones resolve less than the shortest signal
+    this->welchLength = welchLength > 0 ? min(max(welchLength, minSignalSize), maxSignalSize) : 0;
+    if (this->welchLength != max(welchLength, 0)) {
+        __android_log_print(ANDROID_LOG_WARN, LOG_TAG, "Welch length %d s clamped to %d s, within the signal size",
+                            welchLength, this->welchLength);
+    }
+    this->quantiles = quantiles;
+    this->singlePrecision = singlePrecision;
+    this->motionCompensation = motionCompensation;
+    this->gridSize = max(gridSize, 0);
+    this->skinDetection = skinDetection;
+    this->maxFaces = max(maxFaces, 1);
     this->rescanFlag = false;
     this->rescanFrequency = rescanFrequency;
+    this->minTrackingConfidence = minTrackingConfidence;
     this->samplingFrequency = samplingFrequency;
     this->timeBase = timeBase;
+    this->nextId = 0;
+    this->subjects.clear();
+    this->frames.clear();
 
-    LOGD("Using algorithm %f", algorithm);
+    LOGD("Using algorithm %d and %d more in %s precision", algorithm, (int)algorithms.size() - 1,
+         singlePrecision ? "single" : "double");
 
-    // Save reference to Java VM
-    jenv->GetJavaVM(&jvm);
+    // Per-subject stages only run in parallel with several faces
+    this->pool.reset(new ThreadPool(this->maxFaces > 1 ? threads : 1));
 
-    // Save global reference to listener object
-    this->listener = jenv->NewGlobalRef(listener);
+    LOGD("Tracking up to %d faces with %d threads", this->maxFaces, pool->size());
 
-    // Load classifiers
-    classifier.load(classifierPath);
+    // Load classifiers, parsed once per process
+    this->classifierPath = classifierPath;
+    CascadeRegistry::load(classifierPath);
+    this->eyeClassifierPath = eyeClassifierPath;
+    if (!eyeClassifierPath.empty()) {
+        CascadeRegistry::load(eyeClassifierPath);
+    }
     
+    // No logfiles without a path
+    if (logPath.empty()) {
+        return true;
+    }
+
     // Setting up logfilepath
     std::ostringstream path_1;
-    path_1 << logPath << "_a=" << algorithm << "_min=" << minSignalSize << "_max=" << maxSignalSize << "_ds=" << downsample;
+    path_1 << logPath << "_a=" << algorithm << "_cmp=" << compareAlgorithms << "_min=" << minSignalSize << "_max=" << maxSignalSize << "_ds=" << downsample << "_spec=" << spectrum << "_zoom=" << this->spectralZoom << "_welch=" << this->welchLength << "_f32=" << singlePrecision << "_mc=" << motionCompensation << "_grid=" << this->gridSize << "_skin=" << skinDetection;
     this->logfilepath = path_1.str();
     
     // Logging bpm according to sampling frequency
     std::ostringstream path_2;
     path_2 << logfilepath << "_bpm.csv";
     logfile.open(path_2.str().c_str());
-    logfile << "time;face_valid;mean;min;max\n";
+    logfile << "time;face;face_valid;algorithm;mean;min;max;median;";
+    for (size_t i = 0; i < quantiles.size(); i++) {
+        logfile << "q" << quantiles[i] << ";";
+    }
+    logfile << "snr;shared_ms;ms\n";
     logfile.flush();
     
     // Logging bpm detailed
     std::ostringstream path_3;
     path_3 << logfilepath << "_bpmAll.csv";
     logfileDetailed.open(path_3.str().c_str());
-    logfileDetailed << "time;face_valid;bpm\n";
+    logfileDetailed << "time;face;face_valid;algorithm;bpm;snr\n";
     logfileDetailed.flush();
 
     return true;
 }
 
-void RPPG::exit(JNIEnv *jenv) {
-    jenv->DeleteGlobalRef(listener);
-    listener = NULL;
+void RPPG::exit() {
+    callback = ResultCallback();
     logfile.close();
     logfileDetailed.close();
+    subjects.clear();
+    pool.reset();
+}
+
+bool RPPG::getFaceBox(Rect &box) {
+    if (subjects.empty() || subjects[0].poorSince != 0) {
+        return false;
+    }
+    box = subjects[0].box;
+    return true;
 }
 
 void RPPG::processFrame(Mat &frameRGB, Mat &frameGray, int64_t time) {
+    process(frameRGB, frameGray, Mat(), time);
+}
+
+void RPPG::processFrameNV21(Mat &frameRGB, Mat &frameNV21, int64_t time) {
+    Mat frameGray = frameNV21.rowRange(0, frameNV21.rows * 2 / 3);
+    process(frameRGB, frameGray, frameNV21, time);
+}
+
+void RPPG::process(Mat &frameRGB, Mat &frameGray, const Mat &frameNV21, int64_t time) {
+
+    // Frames arriving between exit() and the next load() are dropped
+    if (!pool) {
+        return;
+    }
 
     // Set time
     this->time = time;
+
+    // Pyramid of this frame, the previous one is kept for tracking
+    frames.push(frameGray);
     
-    if (!faceValid) {
+    if (subjects.empty()) {
         
         LOGD("Not valid, finding a new face");
         
         lastScanTime = time;
-        detectFace(frameRGB, frameGray);
+        detectFaces(frameGray);
         
-    } else if ((time - lastScanTime) * timeBase >= 1/rescanFrequency) {
+    } else if (rescanDue()) {
         
         LOGD("Valid, but rescanning face");
         
         lastScanTime = time;
-        detectFace(frameRGB, frameGray);
         rescanFlag = true;
+        detectFaces(frameGray);
 
     } else {
         
         LOGD("Tracking face");
         
-        trackFace(frameGray);
+        pool->parallelFor((int)subjects.size(), [&](int i) {
+            trackFace(subjects[i], frameGray);
+        });
     }
-    
-    if (faceValid) {
 
-        // Update fps
-        fps = getFps(t, timeBase);
+    // Drop faces whose tracking failed
+    removeLostSubjects();
+
+    // Sample and estimate, subjects are independent
+    pool->parallelFor((int)subjects.size(), [&](int i) {
+        updateSignal(subjects[i], frameRGB, frameNV21);
+    });
+
+    // Deliver results and draw on the calling thread, after all subjects have sampled frameRGB
+    for (size_t i = 0; i < subjects.size(); i++) {
+        Subject &sub = subjects[i];
+        for (size_t j = 0; j < sub.estimates.size() && callback; j++) {
+            const Estimate &est = sub.estimates[j];
+            if (est.resultReady) {
+                callback(time, sub.id, est.algorithm, est.meanBpm, est.minBpm, est.maxBpm, est.medianBpm,
+                         est.quantileBpms, est.meanSnr);
+            }
+        }
+        if (sub.estimated) {
+            log(sub);
+        }
+        if (guiMode) {
+            draw(sub, frameRGB);
+        }
+        sub.rescanFlag = false;
+    }
+
+    if (!guiMode && frameNV21.empty()) {
+        // Indicator
+        frameRGB.setTo(BLACK);
+        // circle(frameRGB, Point(1250, 100), 25, faceValid ? GREEN : RED, -1, 8, 0);
+    }
+
+    rescanFlag = false;
+}
+
+void RPPG::updateSignal(Subject &sub, Mat &frameRGB, const Mat &frameNV21) {
+
+    sub.estimated = false;
+    for (size_t i = 0; i < sub.estimates.size(); i++) {
+        sub.estimates[i].resultReady = false;
+    }
+
+    // Update fps
+    sub.fps = getFps(sub.t, timeBase);
+
+    // Remove old values from buffer
+    while (sub.s.rows > sub.fps * maxSignalSize) {
+        push(sub.s);
+        push(sub.t);
+        push(sub.re);
+        push(sub.m);
+        if (gridSize > 0) {
+            push(sub.blocks);
+        }
+    }
+
+    assert(sub.s.rows == sub.t.rows && sub.s.rows == sub.re.rows && sub.s.rows == sub.m.rows);
 
-        // Remove old values from buffer
-        while (s.rows > fps * maxSignalSize) {
-            push(s);
-            push(t);
-            push(re);
+    bool switched = false;
+    if (gridSize > 0) {
+
+        // All blocks of the face box, from one integral image of the box
+        Mat1d blocks;
+        if (frameNV21.empty()) {
+            blockMeans(frameRGB, sub.box, gridSize, blocks);
+        } else {
+            blockMeansNV21(frameNV21, sub.box, gridSize, blocks);
         }
+        sub.blocks.push_back(blocks);
+
+        // Unweighted until the blocks are weighted for estimation
+        Mat1d values;
+        reduce(blocks.reshape(1, gridSize * gridSize), values, 0, REDUCE_AVG);
+        sub.s.push_back(values);
 
-        assert(s.rows == t.rows && s.rows == re.rows);
+    } else {
+
+        // New values, from the skin pixels of the ROI if enough of them are found
+        Scalar means;
+        bool skin = false;
+        if (skinDetection) {
+            skin = frameNV21.empty() ? meanSkin(frameRGB, sub.roi, MIN_SKIN_FRACTION, means)
+                                     : meanSkinNV21(frameNV21, sub.roi, MIN_SKIN_FRACTION, means);
+        }
+        if (!skin) {
+            means = frameNV21.empty() ? mean(frameRGB(sub.roi & Rect(0, 0, frameRGB.cols, frameRGB.rows)))
+                                      : meanNV21(frameNV21, sub.roi);
+        }
 
-        // New values
-        Scalar means = mean(frameRGB, mask);
+        // Skin and plain means differ in level, a switch between them is a step
+        switched = !sub.s.empty() && skin != sub.skin;
+        sub.skin = skin;
 
         // Add new values to raw signal buffer
         double values[] = {means(0), means(1), means(2)};
-        s.push_back(Mat(1, 3, CV_64F, values));
-        t.push_back<long>(time);
+        sub.s.push_back(Mat(1, 3, CV_64F, values));
+    }
+    sub.t.push_back<long>(time);
+    sub.samples++;
 
-        // Save rescan flag
-        re.push_back<bool>(rescanFlag);
+    // Save rescan flag, a switch between skin and plain means is flagged the same way
+    sub.re.push_back<bool>(sub.rescanFlag || switched);
 
-        // Update fps
-        fps = getFps(t, timeBase);
+    // Save motion, none for frames where the face was detected
+    double motion[] = {sub.shift.x, sub.shift.y, std::log(sub.motion.scale()), sub.motion.rotation()};
+    sub.m.push_back(Mat(1, 4, CV_64F, motion));
 
-        // Update band spectrum limits
-        low = (int)(s.rows * LOW_BPM / SEC_PER_MIN / fps);
-        high = (int)(s.rows * HIGH_BPM / SEC_PER_MIN / fps) + 1;
-        
-        // If valid signal is large enough: estimate
-        if (s.rows >= fps * minSignalSize) {
-
-            // Filtering
-            switch (algorithm) {
-                case g:
-                    extractSignal_g();
-                    break;
-                case pca:
-                    extractSignal_pca();
-                    break;
-                case xminay:
-                    extractSignal_xminay();
-                    break;
-            }
+    // Update fps
+    sub.fps = getFps(sub.t, timeBase);
+
+    // Update band spectrum limits
+    sub.low = (int)(sub.s.rows * LOW_BPM / SEC_PER_MIN / sub.fps);
+    sub.high = (int)(sub.s.rows * HIGH_BPM / SEC_PER_MIN / sub.fps) + 1;
 
-            // PSD estimation
-            estimateHeartrate();
+    // If valid signal is large enough: estimate
+    if (sub.s.rows >= sub.fps * minSignalSize) {
 
-            // Log
-            log();
+        // Weight the blocks by their current quality, sub.s keeps the unweighted means
+        Mat raw;
+        if (gridSize > 0) {
+            combineBlocks(sub.blocks, sub.re, raw);
+        } else {
+            raw = sub.s;
         }
 
-        if (guiMode) {
-            draw(frameRGB);
+        // Filtering shared by the algorithms
+        int64 start = getTickCount();
+        Mat normalized, detrended;
+        (this->*preprocessor)(sub, raw, normalized, detrended);
+        const double shared = (getTickCount() - start) * 1000. / getTickFrequency();
+        sub.sharedCost += shared;
+        sub.updates++;
+
+        // Filtering and PSD estimation of each algorithm
+        std::ostringstream costs;
+        for (size_t i = 0; i < sub.estimates.size(); i++) {
+            Estimate &est = sub.estimates[i];
+            start = getTickCount();
+            (this->*filters[i])(sub, est, normalized, detrended);
+            const bool estimated = estimateHeartrate(sub, est);
+            const double cost = (getTickCount() - start) * 1000. / getTickFrequency();
+            est.cost += cost;
+            costs << " " << ALGORITHM_NAMES[est.algorithm] << " " << cost;
+
+            // The primary algorithm alone decides on reacquisition
+            if (i > 0 || !estimated) {
+                continue;
+            }
+            if (est.snr >= minSignalQuality) {
+                sub.poorSince = 0;
+            } else if (sub.poorSince == 0) {
+                sub.poorSince = time;
+            } else if ((time - sub.poorSince) * timeBase >= minSignalSize) {
+                // As long as a new minimum signal would take, start over on a fresh scan
+                sub.reacquire = true;
+            }
         }
-    }
+        LOGD("Estimation of face %d took %.3f ms shared, then ms each:%s", sub.id, shared, costs.str().c_str());
 
-    if (!guiMode) {
-        // Indicator
-        frameRGB.setTo(BLACK);
-        // circle(frameRGB, Point(1250, 100), 25, faceValid ? GREEN : RED, -1, 8, 0);
-    }
+        sampleResults(sub);
 
-    rescanFlag = false;
-    
-    frameGray.copyTo(lastFrameGray);
+        sub.estimated = true;
+    }
 }
 
-void RPPG::detectFace(Mat &frameRGB, Mat &frameGray) {
+void RPPG::detectFaces(Mat &frameGray) {
     
     LOGD("Scanning for faces…");
     
+    // Borrow a detector, others may be in use by other instances
+    CascadeRegistry::Lease classifier = CascadeRegistry::acquire(classifierPath);
+    if (classifier.empty()) {
+        LOGD("No classifier loaded");
+        return;
+    }
+
     // Detect faces with Haar classifier
     vector<Rect> boxes;
-    classifier.detectMultiScale(frameGray, boxes, 1.1, 2, CV_HAAR_SCALE_IMAGE, minFaceSize);
+    classifier.detectMultiScale(frameGray, boxes, 1.1, 2, minFaceSize);
     
     if (boxes.size() > 0) {
         
-        LOGD("Found a face");
+        LOGD("Found %d faces", (int)boxes.size());
         
-        setNearestBox(boxes);
-        detectCorners(frameGray);
-        updateROI();
-        updateMask(frameGray);
-        faceValid = true;
+        associateBoxes(boxes);
+
+        // Reinitialise tracking of all faces on their new boxes
+        pool->parallelFor((int)subjects.size(), [&](int i) {
+            if (subjects[i].reacquire) {
+                resetSignal(subjects[i]);
+            }
+            detectCorners(subjects[i], frameGray);
+            resetConfidence(subjects[i]);
+            updateROI(subjects[i], frameGray);
+        });
 
     } else {
         
         LOGD("Found no face");
-        invalidateFace();
+        subjects.clear();
     }
 }
 
-void RPPG::setNearestBox(vector<Rect> boxes) {
-    int index = 0;
-    Point p = box.tl() - boxes.at(0).tl();
-    int min = p.x * p.x + p.y * p.y;
-    for (int i = 1; i < boxes.size(); i++) {
-        p = box.tl() - boxes.at(i).tl();
-        int d = p.x * p.x + p.y * p.y;
-        if (d < min) {
-            min = d;
-            index = i;
+void RPPG::associateBoxes(vector<Rect> &boxes) {
+
+    // Most prominent faces first, in case there are more than maxFaces
+    sort(boxes.begin(), boxes.end(), [](const Rect &a, const Rect &b) { return a.area() > b.area(); });
+    vector<bool> used(boxes.size(), false);
+
+    // Each tracked face keeps its identity on the nearest box
+    for (size_t i = 0; i < subjects.size(); i++) {
+        Subject &sub = subjects[i];
+        int index = -1;
+        int min = 0;
+        for (size_t j = 0; j < boxes.size(); j++) {
+            if (!used[j]) {
+                Point p = sub.box.tl() - boxes[j].tl();
+                int d = p.x * p.x + p.y * p.y;
+                if (index < 0 || d < min) {
+                    min = d;
+                    index = (int)j;
+                }
+            }
+        }
+        // With a single face, the nearest box is always taken
+        const double maxDistance = MAX_ASSOCIATION_DISTANCE * sub.box.width;
+        if (index >= 0 && (maxFaces == 1 || min <= maxDistance * maxDistance)) {
+            used[index] = true;
+            sub.box = boxes[index];
+            sub.rescanFlag = rescanFlag;
+        } else {
+            sub.valid = false;
+        }
+    }
+
+    // Faces without a box are lost
+    removeLostSubjects();
+
+    // Remaining boxes are new faces
+    for (size_t j = 0; j < boxes.size() && (int)subjects.size() < maxFaces; j++) {
+        if (!used[j]) {
+            LOGD("New face %d", nextId);
+            subjects.push_back(Subject(nextId++, boxes[j], algorithms, quantiles));
+            Subject &sub = subjects.back();
+            std::ostringstream path;
+            path << logfilepath;
+            if (maxFaces > 1) {
+                path << "_face=" << sub.id;
+            }
+            sub.logfilepath = path.str();
+        }
+    }
+}
+
+void RPPG::removeLostSubjects() {
+    for (vector<Subject>::iterator it = subjects.begin(); it != subjects.end();) {
+        if (it->valid) {
+            ++it;
+        } else {
+            LOGD("Lost face %d", it->id);
+            it = subjects.erase(it);
         }
     }
-    box = boxes.at(index);
 }
 
-void RPPG::detectCorners(Mat &frameGray) {
+void RPPG::detectCorners(Subject &sub, Mat &frameGray) {
     
     // Define tracking region
-    Mat trackingRegion = Mat::zeros(frameGray.rows, frameGray.cols, CV_8UC1);
+    const Rect &box = sub.box;
     Point points[1][4];
     points[0][0] = Point(box.tl().x + 0.22 * box.width,
                          box.tl().y + 0.21 * box.height);
@@ -242,13 +524,25 @@ void RPPG::detectCorners(Mat &frameGray) {
                          box.tl().y + 0.50 * box.height);
     points[0][3] = Point(box.tl().x + 0.30 * box.width,
                          box.tl().y + 0.50 * box.height);
+
+    // Only its bounding rectangle is searched, with a mask of that size. The margin covers
+    // the neighbourhoods of gradients, eigenvalues and non-maximum suppression at the edges.
+    Rect bounds = boundingRect(vector<Point>(points[0], points[0] + 4));
+    bounds = Rect(bounds.x - CORNER_MARGIN, bounds.y - CORNER_MARGIN,
+                  bounds.width + 2 * CORNER_MARGIN, bounds.height + 2 * CORNER_MARGIN) &
+             Rect(0, 0, frameGray.cols, frameGray.rows);
+    if (bounds.area() == 0) {
+        sub.corners.clear();
+        return;
+    }
+    Mat trackingRegion = Mat::zeros(bounds.size(), CV_8UC1);
     const Point *pts[1] = {points[0]};
     int npts[] = {4};
-    fillPoly(trackingRegion, pts, npts, 1, WHITE);
+    fillPoly(trackingRegion, pts, npts, 1, WHITE, LINE_8, 0, -bounds.tl());
     
     // Apply corner detection
-    goodFeaturesToTrack(frameGray,
-                        corners,
+    goodFeaturesToTrack(frameGray(bounds),
+                        sub.corners,
                         MAX_CORNERS,
                         QUALITY_LEVEL,
                         MIN_DISTANCE,
@@ -256,13 +550,18 @@ void RPPG::detectCorners(Mat &frameGray) {
                         3,
                         false,
                         0.04);
+
+    // Back to frame coordinates
+    for (size_t i = 0; i < sub.corners.size(); i++) {
+        sub.corners[i] += Point2f(bounds.tl());
+    }
 }
 
-void RPPG::trackFace(Mat &frameGray) {
+void RPPG::trackFace(Subject &sub, Mat &frameGray) {
     
     // Make sure enough corners are available
-    if (corners.size() < MIN_CORNERS) {
-        detectCorners(frameGray);
+    if (sub.corners.size() < MIN_CORNERS) {
+        detectCorners(sub, frameGray);
     }
 
     Contour2f corners_1;
@@ -272,19 +571,25 @@ void RPPG::trackFace(Mat &frameGray) {
     Mat err;
 
     // Track face features with Kanade-Lucas-Tomasi (KLT) algorithm
-    calcOpticalFlowPyrLK(lastFrameGray, frameGray, corners, corners_1, cornersFound_1, err);
+    const vector<Mat> &previous = frames.get(1);
+    const vector<Mat> &current = frames.get(0);
+    calcOpticalFlowPyrLK(previous, current, sub.corners, corners_1, cornersFound_1, err,
+                         frames.getWinSize(), frames.getMaxLevel());
 
     // Backtrack once to make it more robust
-    calcOpticalFlowPyrLK(frameGray, lastFrameGray, corners_1, corners_0, cornersFound_0, err);
+    calcOpticalFlowPyrLK(current, previous, corners_1, corners_0, cornersFound_0, err,
+                         frames.getWinSize(), frames.getMaxLevel());
 
     // Exclude no-good corners
     Contour2f corners_1v;
     Contour2f corners_0v;
-    for (size_t j = 0; j < corners.size(); j++) {
-        if (cornersFound_1[j] && cornersFound_0[j]
-            && cv::norm(corners[j]-corners_0[j]) < 2) {
+    double error = 0;
+    for (size_t j = 0; j < sub.corners.size(); j++) {
+        const double e = cv::norm(sub.corners[j]-corners_0[j]);
+        if (cornersFound_1[j] && cornersFound_0[j] && e < MAX_FB_ERROR) {
             corners_0v.push_back(corners_0[j]);
             corners_1v.push_back(corners_1[j]);
+            error += e;
         } else {
             LOGD("Mis!");
         }
@@ -293,176 +598,314 @@ void RPPG::trackFace(Mat &frameGray) {
     if (corners_1v.size() >= MIN_CORNERS) {
 
         // Save updated features
-        corners = corners_1v;
-
-        // Estimate affine transform
-        Mat transform = estimateRigidTransform(corners_0v, corners_1v, false);
+        sub.corners = corners_1v;
 
-        if (transform.total() > 0) {
+        // Estimate similarity transform
+        sub.motion = Similarity();
+        sub.shift = Point2f();
+        if (estimateSimilarity(corners_0v, corners_1v, sub.motion)) {
 
-            // Update box
-            Contour2f boxCoords;
-            boxCoords.push_back(box.tl());
-            boxCoords.push_back(box.br());
-            Contour2f transformedBoxCoords;
-            cv::transform(boxCoords, transformedBoxCoords, transform);
-            box = Rect(transformedBoxCoords[0], transformedBoxCoords[1]);
+            const Point2f centre = 0.5 * (Point2f(sub.box.tl()) + Point2f(sub.box.br()));
+            sub.shift = (sub.motion.apply(centre) - centre) * (1.0 / sub.box.width);
 
-            // Update roi
-            Contour2f roiCoords;
-            roiCoords.push_back(roi.tl());
-            roiCoords.push_back(roi.br());
-            Contour2f transformedRoiCoords;
-            cv::transform(roiCoords, transformedRoiCoords, transform);
-            roi = Rect(transformedRoiCoords[0], transformedRoiCoords[1]);
-
-            updateMask(frameGray);
+            // Update box and roi
+            sub.box = sub.motion.apply(sub.box);
+            sub.roi = sub.motion.apply(sub.roi);
         }
 
+        updateConfidence(sub, error / corners_1v.size());
+
     } else {
 
         LOGD("Tracking failed! Not enough corners left.");
-        invalidateFace();
+        sub.valid = false;
+    }
+}
+
+bool RPPG::detectEyes(Subject &sub, Mat &frameGray, Point2f &left, Point2f &right) {
+
+    // Only the upper half of the face box is searched
+    const Rect &box = sub.box;
+    Rect region = Rect(box.x, box.y, box.width, box.height / 2) & Rect(0, 0, frameGray.cols, frameGray.rows);
+    if (region.area() == 0) {
+        return false;
     }
+
+    CascadeRegistry::Lease classifier = CascadeRegistry::acquire(eyeClassifierPath);
+    if (classifier.empty()) {
+        return false;
+    }
+
+    vector<Rect> eyes;
+    const int minEyeSize = REL_MIN_EYE_SIZE * box.width;
+    classifier.detectMultiScale(frameGray(region), eyes, 1.1, 2, Size(minEyeSize, minEyeSize));
+
+    // Largest eye on either side of the box centre, in image coordinates
+    Rect l, r;
+    for (size_t i = 0; i < eyes.size(); i++) {
+        Rect eye = eyes[i] + region.tl();
+        if (eye.x + eye.width / 2 < box.x + box.width / 2) {
+            if (eye.area() > l.area()) {
+                l = eye;
+            }
+        } else if (eye.area() > r.area()) {
+            r = eye;
+        }
+    }
+    if (l.area() == 0 || r.area() == 0) {
+        return false;
+    }
+    left = Point2f(l.x + 0.5 * l.width, l.y + 0.5 * l.height);
+    right = Point2f(r.x + 0.5 * r.width, r.y + 0.5 * r.height);
+
+    // Reject pairs that cannot belong to an upright face
+    return fabs(right.y - left.y) <= MAX_EYE_TILT * (right.x - left.x);
 }
 
-void RPPG::updateROI() {
-    this->roi = Rect(Point(box.tl().x + 0.3 * box.width, box.tl().y + 0.1 * box.height),
-                     Point(box.tl().x + 0.7 * box.width, box.tl().y + 0.25 * box.height));
+void RPPG::resetConfidence(Subject &sub) {
+    sub.confidence = 1;
+    sub.scanCorners = (int)sub.corners.size();
+    sub.fbError = 0;
+    sub.scaleDrift = 1;
+    sub.rotationDrift = 0;
+    sub.motion = Similarity();
+    sub.shift = Point2f();
 }
 
-void RPPG::updateMask(Mat &frameGray) {
-    
-    LOGD("Update mask");
+void RPPG::updateConfidence(Subject &sub, double error) {
+
+    sub.fbError += FB_ERROR_SMOOTHING * (error - sub.fbError);
+    sub.scaleDrift *= sub.motion.scale();
+    sub.rotationDrift += sub.motion.rotation();
+
+    // The weakest of corners kept, corner agreement and deformation since the scan
+    const double corners = sub.scanCorners > 0 ? (double)sub.corners.size() / sub.scanCorners : 1;
+    const double agreement = 1 - sub.fbError / MAX_FB_ERROR;
+    const double deformation = 1 - max(fabs(std::log(sub.scaleDrift)) / MAX_SCALE_DRIFT,
+                                       fabs(sub.rotationDrift) / MAX_ROTATION_DRIFT);
+    sub.confidence = max(0.0, min(min(corners, 1.0), min(agreement, deformation)));
+}
 
-    mask = cv::Mat::zeros(frameGray.rows, frameGray.cols, CV_8U);
-    rectangle(mask, this->roi, WHITE, FILLED);
+void RPPG::resetSignal(Subject &sub) {
+    LOGD("Restarting signal of face %d", sub.id);
+    sub.s.release();
+    sub.t.release();
+    sub.re.release();
+    sub.m.release();
+    sub.blocks.release();
+    sub.samples = 0;
+    for (size_t i = 0; i < sub.estimates.size(); i++) {
+        Estimate &est = sub.estimates[i];
+        est.bpms.clear();
+        est.snrs.clear();
+        est.cost = 0;
+        est.welch.clear();
+    }
+    sub.updates = 0;
+    sub.sharedCost = 0;
+    sub.poorSince = 0;
+    sub.reacquire = false;
 }
 
-void RPPG::invalidateFace() {
+bool RPPG::rescanDue() {
+
+    // At the latest after the maximum interval
+    if ((time - lastScanTime) * timeBase >= 1/rescanFrequency) {
+        return true;
+    }
 
-    s = Mat1d();
-    s_f = Mat1d();
-    t = Mat1d();
-    re = Mat1b();
-    powerSpectrum = Mat1d();
-    faceValid = false;
+    // Earlier if tracking of any face has become unreliable
+    for (size_t i = 0; i < subjects.size(); i++) {
+        if (subjects[i].confidence < minTrackingConfidence) {
+            LOGD("Tracking confidence of face %d dropped to %.2f", subjects[i].id, subjects[i].confidence);
+            return true;
+        }
+        if (subjects[i].reacquire) {
+            LOGD("Signal of face %d stayed poor, reacquiring", subjects[i].id);
+            return true;
+        }
+    }
+    return false;
 }
 
-void RPPG::extractSignal_g() {
+void RPPG::updateROI(Subject &sub, Mat &frameGray) {
+
+    // Forehead between the eyes' centres, if both are found
+    Point2f left, right;
+    if (!eyeClassifierPath.empty() && detectEyes(sub, frameGray, left, right)) {
+        LOGD("Placing ROI of face %d relative to the eyes", sub.id);
+        const Point2f centre = 0.5 * (left + right);
+        const double distance = cv::norm(right - left);
+        sub.roi = Rect(Point(left.x, centre.y - ROI_TOP * distance),
+                       Point(right.x, centre.y - ROI_BOTTOM * distance)) & Rect(0, 0, frameGray.cols, frameGray.rows);
+        return;
+    }
 
-    // Denoise
-    Mat s_den = Mat(s.rows, 1, CV_64F);
-    denoise(s.col(1), re, s_den);
+    const Rect &box = sub.box;
+    sub.roi = Rect(Point(box.tl().x + 0.3 * box.width, box.tl().y + 0.1 * box.height),
+                   Point(box.tl().x + 0.7 * box.width, box.tl().y + 0.25 * box.height));
+}
 
-    // Normalise
-    normalization(s_den, s_den);
+void RPPG::compensateMotion(Subject &sub, Mat &s_den) {
+    int64 start = getTickCount();
+    regressMotion(s_den, sub.m, s_den);
+    LOGD("Motion regression of face %d over %d samples took %.3f ms",
+         sub.id, s_den.rows, (getTickCount() - start) * 1000. / getTickFrequency());
+}
 
-    // Detrend
-    Mat s_det = Mat(s_den.rows, s_den.cols, CV_64F);
-    detrend(s_den, s_det, fps);
+pipeline::Context &RPPG::filterContext(Subject &sub) {
+    pipeline::Context &context = sub.filter;
+    context.jumps = sub.re.ptr<uint8_t>(0);
+    context.lambda = (int)sub.fps;
+    context.window = (int)fmax(floor(sub.fps/6), 2);
+    context.passes = 3;
+    context.history = NULL;
+    return context;
+}
 
-    // Moving average
-    Mat s_mav = Mat(s_det.rows, s_det.cols, CV_64F);
-    movingAverage(s_det, s_mav, 3, fmax(floor(fps/6), 2));
+template <int C, typename T>
+void RPPG::preprocess(Subject &sub, const Mat &raw, Mat &normalized, Mat &detrended) {
 
-    s_mav.copyTo(s_f);
+    // Green alone or all channels in the working precision, filtered in place
+    Mat_<T> s(raw.rows, C);
+    pipeline::load<C, T>(raw.ptr<double>(0) + (C == 1 ? 1 : 0), (int)raw.step1(), raw.rows, s[0]);
+    pipeline::Trace<C, T> trace(s[0], s.rows);
+    pipeline::Context &context = filterContext(sub);
+    vector<double> history;
+    context.history = logMode ? &history : NULL;
+
+    // Denoise
+    pipeline::Pipeline<C, T, pipeline::Denoise>::run(trace, context);
+
+    // Remove head motion
+    if (motionCompensation) {
+        compensateMotion(sub, s);
+    }
+
+    // Normalize, then detrend for the algorithms that take detrended traces
+    pipeline::Pipeline<C, T, pipeline::Normalize>::run(trace, context);
+    if (detrendedTraces) {
+        normalized = normalizedTraces ? s.clone() : Mat_<T>();
+        pipeline::Pipeline<C, T, pipeline::Detrend>::run(trace, context);
+        detrended = s;
+    } else {
+        normalized = s;
+    }
+    context.history = NULL;
 
     // Logging
     if (logMode) {
+        static const char *const channels[] = {"r", "g", "b"};
+        static const char *const stages[] = {"den", "norm", "det"};
+        const int n = s.rows;
+        const int runs = (int)history.size() / (n * C);
         std::ofstream log;
         std::ostringstream filepath;
-        filepath << logfilepath << "_signal_" << time << ".csv";
+        filepath << sub.logfilepath << "_traces_" << time << ".csv";
         log.open(filepath.str().c_str());
-        log << "g;g_den;g_det;g_mav\n";
-        for (int i = 0; i < s.rows; i++) {
-            log << s.at<double>(i, 1) << ";";
-            log << s_den.at<double>(i, 0) << ";";
-            log << s_det.at<double>(i, 0) << ";";
-            log << s_mav.at<double>(i, 0) << "\n";
+        log << "re";
+        for (int k = -1; k < runs; k++) {
+            for (int c = 0; c < C; c++) {
+                log << ";" << channels[C == 1 ? 1 : c];
+                if (k >= 0) {
+                    log << "_" << stages[k];
+                }
+            }
+        }
+        log << "\n";
+        for (int i = 0; i < n; i++) {
+            log << sub.re.at<bool>(i, 0);
+            for (int c = 0; c < C; c++) {
+                log << ";" << raw.at<double>(i, C == 1 ? 1 : c);
+            }
+            for (int k = 0; k < runs; k++) {
+                for (int c = 0; c < C; c++) {
+                    log << ";" << history[(k * n + i) * C + c];
+                }
+            }
+            log << "\n";
         }
         log.close();
     }
 }
 
-void RPPG::extractSignal_pca() {
+template <typename T>
+void RPPG::filterGreen(Subject &sub, Estimate &est, const Mat &normalized, const Mat &detrended) {
+
+    // Green channel, moving average in place
+    const int green = detrended.cols == 1 ? 0 : 1;
+    Mat_<T> s = detrended.col(green).clone();
+    pipeline::Trace<1, T> trace(s[0], s.rows);
+    pipeline::Pipeline<1, T, pipeline::MovingAverage>::run(trace, sub.filter);
 
-    // Denoise signals
-    Mat s_den = Mat(s.rows, s.cols, CV_64F);
-    denoise(s, re, s_den);
+    est.s_f = s;
 
-    // Normalize signals
-    normalization(s_den, s_den);
+    // Logging
+    if (logMode) {
+        std::ofstream log;
+        std::ostringstream filepath;
+        filepath << sub.logfilepath << "_signal_" << ALGORITHM_NAMES[est.algorithm] << "_" << time << ".csv";
+        log.open(filepath.str().c_str());
+        log << "g_det;g_mav\n";
+        for (int i = 0; i < s.rows; i++) {
+            log << detrended.at<T>(i, green) << ";";
+            log << s(i, 0) << "\n";
+        }
+        log.close();
+    }
+}
 
-    // Detrend
-    Mat s_det = Mat(s.rows, s.cols, CV_64F);
-    detrend(s_den, s_det, fps);
+template <typename T>
+void RPPG::filterPca(Subject &sub, Estimate &est, const Mat &normalized, const Mat &detrended) {
 
     // PCA to reduce dimensionality
-    Mat s_pca = Mat(s.rows, 1, CV_32F);
-    Mat pc = Mat(s.rows, s.cols, CV_32F);
-    pcaComponent(s_det, s_pca, pc, low, high);
+    Mat s_pca, pc;
+    pcaComponent(detrended, s_pca, pc, sub.low, sub.high);
 
     // Moving average
-    Mat s_mav = Mat(s.rows, 1, CV_32F);
-    movingAverage(s_pca, s_mav, 3, fmax(floor(fps/6), 2));
+    Mat_<T> s_mav;
+    s_pca.copyTo(s_mav);
+    pipeline::Trace<1, T> component(s_mav[0], s_mav.rows);
+    pipeline::Pipeline<1, T, pipeline::MovingAverage>::run(component, sub.filter);
 
-    s_mav.copyTo(s_f);
+    est.s_f = s_mav;
 
     // Logging
     if (logMode) {
         std::ofstream log;
         std::ostringstream filepath;
-        filepath << logfilepath << "_signal_" << time << ".csv";
+        filepath << sub.logfilepath << "_signal_" << ALGORITHM_NAMES[est.algorithm] << "_" << time << ".csv";
         log.open(filepath.str().c_str());
-        log << "re;r;g;b;r_den;g_den;b_den;r_det;g_det;b_det;pc1;pc2;pc3;s_pca;s_mav\n";
-        for (int i = 0; i < s.rows; i++) {
-            log << re.at<bool>(i, 0) << ";";
-            log << s.at<double>(i, 0) << ";";
-            log << s.at<double>(i, 1) << ";";
-            log << s.at<double>(i, 2) << ";";
-            log << s_den.at<double>(i, 0) << ";";
-            log << s_den.at<double>(i, 1) << ";";
-            log << s_den.at<double>(i, 2) << ";";
-            log << s_det.at<double>(i, 0) << ";";
-            log << s_det.at<double>(i, 1) << ";";
-            log << s_det.at<double>(i, 2) << ";";
-            log << pc.at<double>(i, 0) << ";";
-            log << pc.at<double>(i, 1) << ";";
-            log << pc.at<double>(i, 2) << ";";
-            log << s_pca.at<double>(i, 0) << ";";
-            log << s_mav.at<double>(i, 0) << "\n";
+        log << "pc1;pc2;pc3;s_pca;s_mav\n";
+        for (int i = 0; i < s_mav.rows; i++) {
+            log << pc.at<T>(i, 0) << ";";
+            log << pc.at<T>(i, 1) << ";";
+            log << pc.at<T>(i, 2) << ";";
+            log << s_pca.at<T>(i, 0) << ";";
+            log << s_mav(i, 0) << "\n";
         }
         log.close();
     }
 }
 
-void RPPG::extractSignal_xminay() {
-
-    // Denoise signals
-    Mat s_den = Mat(s.rows, s.cols, CV_64F);
-    denoise(s, re, s_den);
+template <typename T>
+void RPPG::filterXminay(Subject &sub, Estimate &est, const Mat &normalized, const Mat &detrended) {
 
-    // Normalize raw signals
-    Mat s_n = Mat(s_den.rows, s_den.cols, CV_64F);
-    normalization(s_den, s_n);
-
-    // Calculate X_s signal
-    Mat x_s = Mat(s.rows, s.cols, CV_64F);
-    addWeighted(s_n.col(0), 3, s_n.col(1), -2, 0, x_s);
-
-    // Calculate Y_s signal
-    Mat y_s = Mat(s.rows, s.cols, CV_64F);
-    addWeighted(s_n.col(0), 1.5, s_n.col(1), 1, 0, y_s);
-    addWeighted(y_s, 1, s_n.col(2), -1.5, 0, y_s);
+    // Calculate X_s and Y_s signals
+    const Mat_<T> s = normalized;
+    Mat_<T> x_s(s.rows, 1), y_s(s.rows, 1);
+    for (int i = 0; i < s.rows; i++) {
+        x_s(i, 0) = 3 * s(i, 0) - 2 * s(i, 1);
+        y_s(i, 0) = 1.5 * s(i, 0) + s(i, 1) - 1.5 * s(i, 2);
+    }
 
     // Bandpass
-    Mat x_f = Mat(s.rows, s.cols, CV_32F);
-    bandpass(x_s, x_f, low, high);
-    x_f.convertTo(x_f, CV_64F);
-    Mat y_f = Mat(s.rows, s.cols, CV_32F);
-    bandpass(y_s, y_f, low, high);
-    y_f.convertTo(y_f, CV_64F);
+    Mat x_f = Mat(s.rows, 1, CV_32F);
+    bandpass(x_s, x_f, sub.low, sub.high);
+    x_f.convertTo(x_f, DataType<T>::type);
+    Mat y_f = Mat(s.rows, 1, CV_32F);
+    bandpass(y_s, y_f, sub.low, sub.high);
+    y_f.convertTo(y_f, DataType<T>::type);
 
     // Calculate alpha
     Scalar mean_x_f;
@@ -474,214 +917,274 @@ void RPPG::extractSignal_xminay() {
     double alpha = stddev_x_f.val[0]/stddev_y_f.val[0];
 
     // Calculate signal
-    Mat xminay = Mat(s.rows, 1, CV_64F);
+    Mat xminay = Mat(s.rows, 1, DataType<T>::type);
     addWeighted(x_f, 1, y_f, -alpha, 0, xminay);
 
     // Moving average
-    movingAverage(xminay, s_f, 3, fmax(floor(fps/6), 2));
+    Mat_<T> s_f = xminay.clone();
+    pipeline::Trace<1, T> signal(s_f[0], s_f.rows);
+    pipeline::Pipeline<1, T, pipeline::MovingAverage>::run(signal, sub.filter);
+
+    est.s_f = s_f;
 
     // Logging
     if (logMode) {
         std::ofstream log;
         std::ostringstream filepath;
-        filepath << logfilepath << "_signal_" << time << ".csv";
+        filepath << sub.logfilepath << "_signal_" << ALGORITHM_NAMES[est.algorithm] << "_" << time << ".csv";
         log.open(filepath.str().c_str());
-        log << "r;g;b;r_den;g_den;b_den;x_s;y_s;x_f;y_f;s;s_f\n";
+        log << "x_s;y_s;x_f;y_f;s;s_f\n";
         for (int i = 0; i < s.rows; i++) {
-            log << s.at<double>(i, 0) << ";";
-            log << s.at<double>(i, 1) << ";";
-            log << s.at<double>(i, 2) << ";";
-            log << s_den.at<double>(i, 0) << ";";
-            log << s_den.at<double>(i, 1) << ";";
-            log << s_den.at<double>(i, 2) << ";";
-            log << x_s.at<double>(i, 0) << ";";
-            log << y_s.at<double>(i, 0) << ";";
-            log << x_f.at<double>(i, 0) << ";";
-            log << y_f.at<double>(i, 0) << ";";
-            log << xminay.at<double>(i, 0) << ";";
-            log << s_f.at<double>(i, 0) << "\n";
+            log << x_s(i, 0) << ";";
+            log << y_s(i, 0) << ";";
+            log << x_f.at<T>(i, 0) << ";";
+            log << y_f.at<T>(i, 0) << ";";
+            log << xminay.at<T>(i, 0) << ";";
+            log << s_f(i, 0) << "\n";
         }
         log.close();
     }
 }
 
-void RPPG::estimateHeartrate() {
-
-    powerSpectrum = Mat(s_f.size(), CV_32F);
-    timeToFrequency(s_f, powerSpectrum, true);
+void RPPG::bandSpectrum(Estimate &est, const Mat &signal, int low, int high, Mat1d &spectrum) {
+    switch (this->spectrum) {
+        case fft: {
+            Mat magnitude;
+            timeToFrequency(signal, magnitude, true);
+            spectrum = magnitude.rowRange(low, high + 1).clone();
+            break;
+        }
+        case direct:
+            zoomSpectrum(signal, spectrum, low, high, spectralZoom);
+            break;
+        case chirpz:
+            est.czt.magnitude(signal, spectrum, low, high, spectralZoom);
+            break;
+    }
+}
 
-    // band mask
-    const int total = s_f.rows;
-    Mat bandMask = Mat::zeros(s_f.size(), CV_8U);
-    bandMask.rowRange(min(low, total), min(high, total) + 1).setTo(ONE);
+bool RPPG::welchSpectrum(Subject &sub, Estimate &est, int &length, int &low, int &high, bool &updated) {
 
-    if (!powerSpectrum.empty()) {
+    const int total = est.s_f.rows;
+    updated = est.welch.advance(sub.fps, welchLength, LOW_BPM, HIGH_BPM, sub.samples, total);
 
-        // grab index of max power spectrum
-        double min, max;
-        Point pmin, pmax;
-        minMaxLoc(powerSpectrum, &min, &max, &pmin, &pmax, bandMask);
-
-        // calculate BPM
-        bpm = pmax.y * fps / total * SEC_PER_MIN;
-        bpms.push_back(bpm);
-
-        // calculate BPM based on weighted squares power spectrum
-        //double weightedSquares = weightedSquaresMeanIndex(powerSpectrum, low, high);
-        //double bpm_ws = weightedSquares * fps / total * SEC_PER_MIN;
-        //bpms_ws.push_back(bpm_ws);
-
-        LOGD("FPS=%f Vals=%d Peak=%d BPM=%f", fps, powerSpectrum.rows, pmax.y, bpm);
-
-        // Logging
-        if (logMode) {
-            std::ofstream log;
-            std::ostringstream filepath;
-            filepath << logfilepath << "_estimation_" << time << ".csv";
-            log.open(filepath.str().c_str());
-            log << "i;powerSpectrum\n";
-            for (int i = 0; i < powerSpectrum.rows; i++) {
-                if (low <= i && i <= high) {
-                    log << i << ";";
-                    log << powerSpectrum.at<double>(i, 0) << "\n";
-                }
-            }
-            log.close();
-        }
+    // One spectrum of the signal until it covers a segment, or while no segment is left in it
+    if (est.welch.segmentLength() == 0 || (!updated && est.welch.segmentCount() == 0)) {
+        updated = true;
+        return false;
+    }
+    length = est.welch.segmentLength();
+    low = est.welch.bandLow();
+    high = est.welch.bandHigh();
+    if (!updated) {
+        return true;
     }
 
-    if ((time - lastSamplingTime) * timeBase >= 1/samplingFrequency) {
-        lastSamplingTime = time;
-
-        cv::sort(bpms, bpms, SORT_EVERY_COLUMN);
+    // Transform the newest segment once it is half a segment past the last one.
+    // Older segments keep the spectrum of the window they were cut from: the preprocessing of
+    // later windows is not applied to them again, which slightly changes their relative weight
+    // when the level or trend of the signal moves.
+    Mat1d segment, magnitude;
+    hann(est.s_f.rowRange(total - length, total), segment);
+    bandSpectrum(est, segment, low, high, magnitude);
+    Mat1d power = magnitude.mul(magnitude);
+    est.welch.add(vector<double>(power.begin(), power.end()));
+
+    // Mean power, as magnitude like the single spectrum
+    vector<double> mean;
+    est.welch.mean(mean);
+    sqrt(Mat1d(mean, true), est.powerSpectrum);
 
-        // average calculated BPMs since last sampling time
-        meanBpm = mean(bpms)(0);
-        minBpm = bpms.at<double>(0, 0);
-        maxBpm = bpms.at<double>(bpms.rows-1, 0);
+    return true;
+}
 
-        // cv::sort(bpms_ws, bpms_ws, SORT_EVERY_COLUMN);
-        // meanBpm_ws = mean(bpms_ws)(0);
-        // minBpm_ws = bpms_ws.at<double>(0, 0);
-        // maxBpm_ws = bpms_ws.at<double>(bpms_ws.rows-1, 0);
+bool RPPG::estimateHeartrate(Subject &sub, Estimate &est) {
 
-        callback(time, meanBpm, minBpm, maxBpm);
+    // Band in DFT bins of the transform length, within the Nyquist limit
+    int length, low, high;
+    bool updated = true;
+    if (welchLength <= 0 || !welchSpectrum(sub, est, length, low, high, updated)) {
+        length = est.s_f.rows;
+        low = min(sub.low, length / 2);
+        high = max(low, min(sub.high, length / 2));
+        bandSpectrum(est, est.s_f, low, high, est.powerSpectrum);
+    }
 
-        bpms.pop_back(bpms.rows);
-        // bpms_ws.pop_back(bpms_ws.rows);
+    // Between Welch segments the spectrum is unchanged, repeating its estimate would only weight it more
+    if (!updated || est.powerSpectrum.empty()) {
+        return false;
     }
-}
 
-void RPPG::log() {
+    // grab index of max power spectrum
+    Point pmax;
+    minMaxLoc(est.powerSpectrum, NULL, NULL, NULL, &pmax);
 
-    if (lastSamplingTime == time || lastSamplingTime == 0) {
-        logfile << time << ";";
-        logfile << faceValid << ";";
-        logfile << meanBpm << ";";
-        logfile << minBpm << ";";
-        logfile << maxBpm << "\n";
-        logfile.flush();
-    }
+    // Peak between bins
+    const double peak = low + interpolatePeak(est.powerSpectrum, pmax.y) / spectralZoom;
 
-    logfileDetailed << time << ";";
-    logfileDetailed << faceValid << ";";
-    logfileDetailed << bpm << "\n";
-    logfileDetailed.flush();
-}
+    // calculate BPM
+    est.bpm = peak * sub.fps / length * SEC_PER_MIN;
 
-void RPPG::callback(int64_t time, double meanBpm, double minBpm, double maxBpm) {
+    // Estimates from a flat spectrum are dropped
+    est.snr = signalToNoise(est.powerSpectrum, pmax.y, low * spectralZoom + 2 * pmax.y,
+                            SNR_PEAK_WIDTH * spectralZoom);
+    const bool good = est.snr >= minSignalQuality;
+    if (good) {
+        est.bpms.add(est.bpm);
+        est.snrs.add(est.snr);
+    }
 
-    JNIEnv *jenv;
-    int stat = jvm->GetEnv((void **)&jenv, JNI_VERSION_1_6);
+    // calculate BPM based on weighted squares power spectrum
+    //double weightedSquares = weightedSquaresMeanIndex(est.powerSpectrum, sub.low, sub.high);
+    //double bpm_ws = weightedSquares * sub.fps / total * SEC_PER_MIN;
+    //bpms_ws.push_back(bpm_ws);
 
-    if (stat == JNI_EDETACHED) {
-        LOGD("GetEnv: not attached");
-        if (jvm->AttachCurrentThread(&jenv, NULL) != 0) {
-            LOGD("GetEnv: Failed to attach");
-        } else {
-            LOGD("GetEnv: Attached to %d", jenv);
+    LOGD("FPS=%f Vals=%d Peak=%.2f BPM=%f SNR=%.1f dB (%s)", sub.fps, est.powerSpectrum.rows, peak, est.bpm, est.snr,
+         ALGORITHM_NAMES[est.algorithm]);
+
+    // Logging
+    if (logMode && good) {
+        std::ofstream log;
+        std::ostringstream filepath;
+        filepath << sub.logfilepath << "_estimation_" << ALGORITHM_NAMES[est.algorithm] << "_" << time << ".csv";
+        log.open(filepath.str().c_str());
+        log << "i;powerSpectrum\n";
+        for (int i = 0; i < est.powerSpectrum.rows; i++) {
+            log << low + (double)i / spectralZoom << ";";
+            log << est.powerSpectrum.at<double>(i, 0) << "\n";
         }
-    } else if (stat == JNI_OK) {
-        //
-    } else if (stat == JNI_EVERSION) {
-        LOGD("GetEnv: version not supported");
+        log.close();
     }
 
-    // Return object
+    return true;
+}
+
+void RPPG::sampleResults(Subject &sub) {
 
-    // Get Return object class reference
-    jclass returnObjectClassRef = jenv->FindClass("com/prouast/heartbeat/RPPGResult");
+    if ((time - sub.lastSamplingTime) * timeBase < 1/samplingFrequency) {
+        return;
+    }
+    sub.lastSamplingTime = time;
+
+    // Costs per estimate since last sampling time
+    sub.meanSharedCost = sub.sharedCost / max(sub.updates, 1);
+    for (size_t i = 0; i < sub.estimates.size(); i++) {
+        Estimate &est = sub.estimates[i];
+        est.meanCost = est.cost / max(sub.updates, 1);
+        est.cost = 0;
+    }
+    sub.sharedCost = 0;
+    sub.updates = 0;
 
-    // Get Return object constructor method
-    jmethodID constructorMethodID = jenv->GetMethodID(returnObjectClassRef, "<init>", "(JDDD)V");
+    for (size_t i = 0; i < sub.estimates.size(); i++) {
+        Estimate &est = sub.estimates[i];
 
-    // Create Info class
-    jobject returnObject = jenv->NewObject(returnObjectClassRef, constructorMethodID, (jlong)time, meanBpm, minBpm, maxBpm);
+        // No result if all estimates since last sampling time were poor
+        if (est.bpms.empty()) {
+            continue;
+        }
 
-    // Listener
+        // Statistics of the BPMs since last sampling time
+        est.meanBpm = est.bpms.mean();
+        est.minBpm = est.bpms.min();
+        est.maxBpm = est.bpms.max();
+        est.medianBpm = est.bpms.median();
+        for (int j = 0; j < est.bpms.quantiles(); j++) {
+            est.quantileBpms[j] = est.bpms.quantile(j);
+        }
+        est.meanSnr = est.snrs.mean();
 
-    // Get the Listener class reference
-    jclass listenerClassRef = jenv->GetObjectClass(listener);
+        // Delivered by the calling thread
+        est.resultReady = true;
 
-    // Use Listener class reference to load the eventOccurred method
-    jmethodID listenerEventOccuredMethodID = jenv->GetMethodID(listenerClassRef, "onRPPGResult", "(Lcom/prouast/heartbeat/RPPGResult;)V");
+        est.bpms.clear();
+        est.snrs.clear();
+    }
+}
 
-    // Invoke listener eventOccurred
-    jenv->CallVoidMethod(listener, listenerEventOccuredMethodID, returnObject);
+void RPPG::log(Subject &sub) {
+
+    for (size_t i = 0; i < sub.estimates.size(); i++) {
+        const Estimate &est = sub.estimates[i];
+
+        if (est.resultReady || sub.lastSamplingTime == 0) {
+            logfile << time << ";";
+            logfile << sub.id << ";";
+            logfile << sub.valid << ";";
+            logfile << ALGORITHM_NAMES[est.algorithm] << ";";
+            logfile << est.meanBpm << ";";
+            logfile << est.minBpm << ";";
+            logfile << est.maxBpm << ";";
+            logfile << est.medianBpm << ";";
+            for (size_t j = 0; j < est.quantileBpms.size(); j++) {
+                logfile << est.quantileBpms[j] << ";";
+            }
+            logfile << est.meanSnr << ";";
+            logfile << sub.meanSharedCost << ";";
+            logfile << est.meanCost << "\n";
+        }
 
-    // Cleanup
-    jenv->DeleteLocalRef(returnObject);
+        logfileDetailed << time << ";";
+        logfileDetailed << sub.id << ";";
+        logfileDetailed << sub.valid << ";";
+        logfileDetailed << ALGORITHM_NAMES[est.algorithm] << ";";
+        logfileDetailed << est.bpm << ";";
+        logfileDetailed << est.snr << "\n";
+    }
+    logfile.flush();
+    logfileDetailed.flush();
 }
 
-void RPPG::draw(Mat &frameRGB) {
+void RPPG::draw(Subject &sub, Mat &frameRGB) {
 
     // Draw roi
-    rectangle(frameRGB, roi, GREEN);
+    rectangle(frameRGB, sub.roi, GREEN);
 
     // Draw face shape
     //ellipse(frameRGB,
-    //        Point(box.tl().x + box.width / 2.0, box.tl().y + box.height / 2.0),
-    //        Size(box.width / 2.5, box.height / 2.0),
+    //        Point(sub.box.tl().x + sub.box.width / 2.0, sub.box.tl().y + sub.box.height / 2.0),
+    //        Size(sub.box.width / 2.5, sub.box.height / 2.0),
     //        0, 0, 360, GREEN);
 
     // Draw bounding box
-    rectangle(frameRGB, box, RED);
+    rectangle(frameRGB, sub.box, RED);
+
+    // Signal and spectrum of the primary algorithm
+    const Estimate &primary = sub.estimates[0];
 
     // Draw signal
-    if (!s_f.empty() && !powerSpectrum.empty()) {
+    if (!primary.s_f.empty() && !primary.powerSpectrum.empty()) {
 
         // Display of signals with fixed dimensions
-        double displayHeight = box.height/2.0;
-        double displayWidth = box.width*0.8;
+        double displayHeight = sub.box.height/2.0;
+        double displayWidth = sub.box.width*0.8;
 
         // Draw signal
+        const Mat1d signal = primary.s_f;
         double vmin, vmax;
         Point pmin, pmax;
-        minMaxLoc(s_f, &vmin, &vmax, &pmin, &pmax);
+        minMaxLoc(signal, &vmin, &vmax, &pmin, &pmax);
         double heightMult = displayHeight/(vmax - vmin);
-        double widthMult = displayWidth/(s_f.rows - 1);
-        double drawAreaTlX = box.tl().x + box.width + 20;
-        double drawAreaTlY = box.tl().y;
-        Point p1(drawAreaTlX, drawAreaTlY + (vmax - s_f.at<double>(0, 0))*heightMult);
+        double widthMult = displayWidth/(signal.rows - 1);
+        double drawAreaTlX = sub.box.tl().x + sub.box.width + 20;
+        double drawAreaTlY = sub.box.tl().y;
+        Point p1(drawAreaTlX, drawAreaTlY + (vmax - signal(0, 0))*heightMult);
         Point p2;
-        for (int i = 1; i < s_f.rows; i++) {
-            p2 = Point(drawAreaTlX + i * widthMult, drawAreaTlY + (vmax - s_f.at<double>(i, 0))*heightMult);
+        for (int i = 1; i < signal.rows; i++) {
+            p2 = Point(drawAreaTlX + i * widthMult, drawAreaTlY + (vmax - signal(i, 0))*heightMult);
             line(frameRGB, p1, p2, RED, 2);
             p1 = p2;
         }
 
         // Draw powerSpectrum
-        const int total = s_f.rows;
-        Mat bandMask = Mat::zeros(s_f.size(), CV_8U);
-        bandMask.rowRange(min(low, total), min(high, total) + 1).setTo(ONE);
-        minMaxLoc(powerSpectrum, &vmin, &vmax, &pmin, &pmax, bandMask);
+        minMaxLoc(primary.powerSpectrum, &vmin, &vmax, &pmin, &pmax);
         heightMult = displayHeight/(vmax - vmin);
-        widthMult = displayWidth/(high - low);
-        drawAreaTlX = box.tl().x + box.width + 20;
-        drawAreaTlY = box.tl().y + box.height/2.0;
-        p1 = Point(drawAreaTlX, drawAreaTlY + (vmax - powerSpectrum.at<double>(low, 0))*heightMult);
-        for (int i = low + 1; i <= high; i++) {
-            p2 = Point(drawAreaTlX + (i - low) * widthMult, drawAreaTlY + (vmax - powerSpectrum.at<double>(i, 0)) * heightMult);
+        widthMult = displayWidth/max(primary.powerSpectrum.rows - 1, 1);
+        drawAreaTlX = sub.box.tl().x + sub.box.width + 20;
+        drawAreaTlY = sub.box.tl().y + sub.box.height/2.0;
+        p1 = Point(drawAreaTlX, drawAreaTlY + (vmax - primary.powerSpectrum.at<double>(0, 0))*heightMult);
+        for (int i = 1; i < primary.powerSpectrum.rows; i++) {
+            p2 = Point(drawAreaTlX + i * widthMult, drawAreaTlY + (vmax - primary.powerSpectrum.at<double>(i, 0)) * heightMult);
             line(frameRGB, p1, p2, RED, 2);
             p1 = p2;
         }
@@ -690,21 +1193,28 @@ void RPPG::draw(Mat &frameRGB) {
     std::stringstream ss;
 
     // Draw BPM text
-    if (faceValid) {
+    if (sub.valid) {
         ss.precision(3);
-        ss << meanBpm << " bpm";
-        putText(frameRGB, ss.str(), Point(box.tl().x, box.tl().y - 10), FONT_HERSHEY_PLAIN, 2, RED, 2);
+        ss << primary.meanBpm << " bpm";
+        putText(frameRGB, ss.str(), Point(sub.box.tl().x, sub.box.tl().y - 10), FONT_HERSHEY_PLAIN, 2, RED, 2);
     }
 
     // Draw FPS text
     ss.str("");
-    ss << fps << " fps";
-    putText(frameRGB, ss.str(), Point(box.tl().x, box.br().y + 40), FONT_HERSHEY_PLAIN, 2, GREEN, 2);
+    ss << sub.fps << " fps";
+    putText(frameRGB, ss.str(), Point(sub.box.tl().x, sub.box.br().y + 40), FONT_HERSHEY_PLAIN, 2, GREEN, 2);
+
+    // Draw BPM text of the other algorithms below
+    for (size_t i = 1; i < sub.estimates.size(); i++) {
+        ss.str("");
+        ss << ALGORITHM_NAMES[sub.estimates[i].algorithm] << " " << sub.estimates[i].meanBpm << " bpm";
+        putText(frameRGB, ss.str(), Point(sub.box.tl().x, sub.box.br().y + 40 + 30 * i), FONT_HERSHEY_PLAIN, 2, RED, 2);
+    }
 
     // Draw corners
-    for (int i = 0; i < corners.size(); i++) {
-        //circle(frameRGB, corners[i], r, WHITE, -1, 8, 0);
-        line(frameRGB, Point(corners[i].x-5,corners[i].y), Point(corners[i].x+5,corners[i].y), GREEN, 1);
-        line(frameRGB, Point(corners[i].x,corners[i].y-5), Point(corners[i].x,corners[i].y+5), GREEN, 1);
+    for (int i = 0; i < sub.corners.size(); i++) {
+        //circle(frameRGB, sub.corners[i], r, WHITE, -1, 8, 0);
+        line(frameRGB, Point(sub.corners[i].x-5,sub.corners[i].y), Point(sub.corners[i].x+5,sub.corners[i].y), GREEN, 1);
+        line(frameRGB, Point(sub.corners[i].x,sub.corners[i].y-5), Point(sub.corners[i].x,sub.corners[i].y+5), GREEN, 1);
     }
 }
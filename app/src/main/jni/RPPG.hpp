@@ -10,16 +10,28 @@
 #define RPPG_hpp
 
 #include <fstream>
+#include <functional>
+#include <memory>
 #include <string>
 #include <opencv2/objdetect/objdetect.hpp>
 #include <stdio.h>
-#include <jni.h>
+
+#include "ChirpZ.hpp"
+#include "FrameHistory.hpp"
+#include "pipeline.hpp"
+#include "RunningStatistics.hpp"
+#include "similarity.hpp"
+#include "ThreadPool.hpp"
+#include "Welch.hpp"
 
 using namespace cv;
 using namespace std;
 
 enum RPPGAlgorithm { g, pca, xminay };
 
+// How the spectrum within the band is evaluated
+enum RPPGSpectrum { fft, direct, chirpz };
+
 class RPPG {
     
 public:
@@ -27,56 +39,199 @@ public:
     // Constructor
     RPPG() {;}
     
+    // Receives results, called on the thread calling processFrame
+    typedef std::function<void(int64_t time, int id, int algorithm, double meanBpm, double minBpm, double maxBpm,
+                               double medianBpm, const vector<double> &quantileBpms, double snr)> ResultCallback;
+
     // Load Settings
-    bool load(jobject listener, JNIEnv *jenv,                                   // Listener and environment for Java callback
+    bool load(const ResultCallback &callback,
               int algorithm,
+              const bool compareAlgorithms,                                      // Also run the other algorithms on the same traces, results tagged by algorithm
               const int width, const int height, const double timeBase, const int downsample,
-              const double samplingFrequency, const double rescanFrequency,
+              const double samplingFrequency, const double rescanFrequency,        // Rescan at least this often (Hz)
+              const double minTrackingConfidence,                                // Rescan earlier below this (0: never)
               const int minSignalSize, const int maxSignalSize,
+              const double minSignalQuality,                                     // SNR of estimates that count (dB), lower ones are dropped
+              const int spectrum,                                               // RPPGSpectrum, fft ignores spectralZoom
+              const int spectralZoom,                                           // Spectrum resolution within the band in DFT bins (1: DFT only)
+              const int welchLength,                                            // Average half overlapping segments of this many seconds, within the signal size (0: one periodogram of the signal)
+              const vector<double> &quantiles,                                  // Of the estimates in each result, besides the median
+              const bool singlePrecision,                                        // Filter and transform the signal in float with the vector kernels
+              const bool motionCompensation,                                     // Regress tracked head motion out of the color traces
+              const int gridSize,                                               // Sample the face box in gridSize x gridSize weighted blocks (0: ROI only)
+              const bool skinDetection,                                          // Average only the skin pixels of the ROI
+              const int maxFaces, const int threads,                            // Faces tracked at once (1: nearest face only), worker threads (0: one per core)
               const string &logPath, const string &classifierPath,
+              const string &eyeClassifierPath,                                  // Empty: ROI at fixed fractions of the face box
               const bool log, const bool gui);
     
     void processFrame(Mat &frameRGB, Mat &frameGray, int64_t time);
+
+    // Process a camera-native NV21 frame (Y plane followed by interleaved VU).
+    // The Y plane serves as gray frame; frameRGB is only drawn on in GUI mode.
+    void processFrameNV21(Mat &frameRGB, Mat &frameNV21, int64_t time);
     
-    void exit(JNIEnv *jenv);
+    // Box of the longest tracked face in frame coordinates, false if no face is tracked or its signal is poor
+    bool getFaceBox(Rect &box);
+
+    // Closes the logs and stops the worker threads; frames are ignored until the next load
+    void exit();
     
     typedef vector<Point2f> Contour2f;
     
 private:
-    
-    void detectFace(Mat &frameRGB, Mat &frameGray);
-    void setNearestBox(vector<Rect> boxes);
-    void detectCorners(Mat &frameGray);
-    void trackFace(Mat &frameGray);
-    void updateMask(Mat &frameGray);
-    void updateROI();
-    void extractSignal_g();
-    void extractSignal_pca();
-    void extractSignal_xminay();
-    void estimateHeartrate();
-    void draw(Mat &frameRGB);
-    void invalidateFace();
-    void log();
-
-    void callback(int64_t now, double meanBpm, double minBpm, double maxBpm);   // Callback to Java
-
-    // The JavaVM
-    JavaVM *jvm;
+
+    // Estimation of one algorithm from the signal of a face
+    struct Estimate {
+
+        Estimate(RPPGAlgorithm algorithm, const vector<double> &quantiles) : algorithm(algorithm), resultReady(false),
+                                           bpms(quantiles), bpm(0.0), snr(0), meanBpm(0), minBpm(0), maxBpm(0), medianBpm(0),
+                                           quantileBpms(quantiles.size()), meanSnr(0), cost(0), meanCost(0) {;}
+
+        RPPGAlgorithm algorithm;
+        bool resultReady;       // A result is due for the current frame
+
+        Mat s_f;                // Filtered signal in the working precision
+        RunningStatistics bpms; // Since the last result
+        RunningStatistics snrs; // Of the bpms
+        Mat1d powerSpectrum;    // Within the band, from low in steps of 1 / spectralZoom bins
+        ChirpZ czt;             // Tables for the window lengths of this subject
+        double bpm;
+        double snr;             // Of the last estimate (dB)
+        double meanBpm;
+        double minBpm;
+        double maxBpm;
+        double medianBpm;
+        vector<double> quantileBpms;
+        double meanSnr;
+
+        // Cost of the stages of this algorithm alone (ms)
+        double cost;            // Since the last result
+        double meanCost;        // Per estimate, in the last result
+
+        // Welch segments, each filtered within the window it was last in
+        Welch welch;
+    };
+
+    // State of one tracked face
+    struct Subject {
+
+        Subject(int id, const Rect &box, const vector<RPPGAlgorithm> &algorithms, const vector<double> &quantiles) :
+                                           id(id), confidence(1), scanCorners(0), fbError(0), scaleDrift(1),
+                                           rotationDrift(0), box(box), valid(true), rescanFlag(false), skin(false),
+                                           estimated(false), reacquire(false), lastSamplingTime(0),
+                                           poorSince(0), fps(0), low(0), high(0), samples(0), updates(0),
+                                           sharedCost(0), meanSharedCost(0) {
+            for (size_t i = 0; i < algorithms.size(); i++) {
+                this->estimates.push_back(Estimate(algorithms[i], quantiles));
+            }
+        }
+
+        int id;                 // Persists across rescans as long as the face is associated
+        string logfilepath;
+
+        // Tracking
+        Contour2f corners;
+        Similarity motion;      // Of the box in the last tracked frame
+        Point2f shift;          // Of the box centre in the last tracked frame, in box widths
+
+        // Tracking quality since the last scan
+        double confidence;      // In [0, 1]
+        int scanCorners;        // Corners found at the scan
+        double fbError;         // Smoothed forward-backward error of the corners (px)
+        double scaleDrift;      // Accumulated scale of the box
+        double rotationDrift;   // Accumulated rotation of the box (rad)
+
+        // Regions
+        Rect box;
+        Rect roi;
+
+        // State variables
+        bool valid;             // Cleared when tracking fails
+        bool rescanFlag;
+        bool skin;              // The last sample averaged the skin pixels of the ROI only
+        bool estimated;         // Estimation ran for the current frame
+        bool reacquire;         // Signal was poor for too long, start over at the next scan
+        int64_t lastSamplingTime;
+        int64_t poorSince;      // Time of the first poor estimate of the primary algorithm in a row, 0 if the last one was good
+        double fps;
+        int low;
+        int high;
+
+        // Raw signal
+        Mat1d s;
+        Mat1d t;
+        Mat1b re;
+        Mat1d m;                // Motion per sample: centre shift x and y, log scale, rotation
+        Mat1d blocks;           // Grid mode: r, g, b per block and sample
+        pipeline::Context filter;   // Scratch of the filter stages
+        int64_t samples;        // Added to the signal since it started
+
+        // Estimation, the primary algorithm first
+        vector<Estimate> estimates;
+        int updates;            // Estimates since the last result
+        double sharedCost;      // Of the preprocessing shared by the algorithms since the last result (ms)
+        double meanSharedCost;  // Per estimate, in the last result
+    };
+
+    void process(Mat &frameRGB, Mat &frameGray, const Mat &frameNV21, int64_t time);
+    void detectFaces(Mat &frameGray);
+    void associateBoxes(vector<Rect> &boxes);
+    void removeLostSubjects();
+    void detectCorners(Subject &sub, Mat &frameGray);
+    void trackFace(Subject &sub, Mat &frameGray);
+    void resetConfidence(Subject &sub);
+    void resetSignal(Subject &sub);
+    void updateConfidence(Subject &sub, double error);
+    bool rescanDue();
+    bool detectEyes(Subject &sub, Mat &frameGray, Point2f &left, Point2f &right);
+    void updateROI(Subject &sub, Mat &frameGray);
+    void updateSignal(Subject &sub, Mat &frameRGB, const Mat &frameNV21);
+    void compensateMotion(Subject &sub, Mat &s_den);
+    pipeline::Context &filterContext(Subject &sub);
+    template <int C, typename T> void preprocess(Subject &sub, const Mat &raw, Mat &normalized, Mat &detrended);
+    template <typename T> void filterGreen(Subject &sub, Estimate &est, const Mat &normalized, const Mat &detrended);
+    template <typename T> void filterPca(Subject &sub, Estimate &est, const Mat &normalized, const Mat &detrended);
+    template <typename T> void filterXminay(Subject &sub, Estimate &est, const Mat &normalized, const Mat &detrended);
+    void bandSpectrum(Estimate &est, const Mat &signal, int low, int high, Mat1d &spectrum);
+    bool welchSpectrum(Subject &sub, Estimate &est, int &length, int &low, int &high, bool &updated);
+    bool estimateHeartrate(Subject &sub, Estimate &est);
+    void sampleResults(Subject &sub);
+    void draw(Subject &sub, Mat &frameRGB);
+    void log(Subject &sub);
 
     // The listener
-    jobject listener;
+    ResultCallback callback;
 
-    // The algorithm
-    RPPGAlgorithm algorithm;
+    // The algorithms, the primary one first, and their stages in the working precision
+    vector<RPPGAlgorithm> algorithms;
+    typedef void (RPPG::*Preprocessor)(Subject &sub, const Mat &raw, Mat &normalized, Mat &detrended);
+    Preprocessor preprocessor;
+    typedef void (RPPG::*SignalFilter)(Subject &sub, Estimate &est, const Mat &normalized, const Mat &detrended);
+    vector<SignalFilter> filters;
+    bool normalizedTraces;  // Needed by xminay
+    bool detrendedTraces;   // Needed by g and pca
 
-    // The classifiers
-    CascadeClassifier classifier;
+    // The classifiers, shared through CascadeRegistry
+    string classifierPath;
+    string eyeClassifierPath;
 
     // Settings
     Size minFaceSize;
     int maxSignalSize;
+    bool motionCompensation;
+    int gridSize;
+    bool skinDetection;
     int minSignalSize;
+    double minSignalQuality;
+    RPPGSpectrum spectrum;
+    int spectralZoom;
+    int welchLength;
+    vector<double> quantiles;
+    bool singlePrecision;
+    int maxFaces;
     double rescanFrequency;
+    double minTrackingConfidence;
     double samplingFrequency;
     double timeBase;
     bool logMode;
@@ -84,43 +239,20 @@ private:
 
     // State variables
     int64_t time;
-    double fps;
-    int high;
-    int64_t lastSamplingTime;
     int64_t lastScanTime;
-    int low;
     int64_t now;
-    bool faceValid;
     bool rescanFlag;
-    
-    // Tracking
-    Mat lastFrameGray;
-    Contour2f corners;
-
-    // Mask
-    Rect box;
-    Mat1b mask;
-    Rect roi;
-
-    // Raw signal
-    Mat1d s;
-    Mat1d t;
-    Mat1b re;
-
-    // Estimation
-    Mat1d s_f;
-    Mat1d bpms;
-    //Mat1d bpms_ws;
-    Mat1d powerSpectrum;
-    double bpm = 0.0;
-    //double bpm_ws = 0.0;
-    double meanBpm;
-    double minBpm;
-    double maxBpm;
-    //double meanBpm_ws;
-    //double minBpm_ws;
-    //double maxBpm_ws;
-    
+    int nextId;
+
+    // Current and previous frame for tracking
+    FrameHistory frames;
+
+    // Tracked faces, oldest first
+    vector<Subject> subjects;
+
+    // Workers for the per-subject stages
+    unique_ptr<ThreadPool> pool;
+
     // Logfiles
     ofstream logfile;
     ofstream logfileDetailed;
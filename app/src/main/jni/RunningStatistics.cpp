@@ -0,0 +1,148 @@
+//
+//  RunningStatistics.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#include "RunningStatistics.hpp"
+
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+/* QUANTILE */
+
+StreamingQuantile::StreamingQuantile(double p) : p(p), count(0) {;}
+
+void StreamingQuantile::add(double value) {
+
+    // The first five values, kept sorted
+    if (count < 5) {
+        int i = count++;
+        for (; i > 0 && heights[i - 1] > value; i--) {
+            heights[i] = heights[i - 1];
+        }
+        heights[i] = value;
+        if (count == 5) {
+            for (int j = 0; j < 5; j++) {
+                positions[j] = j;
+            }
+            desired[0] = 0;
+            desired[1] = 2 * p;
+            desired[2] = 4 * p;
+            desired[3] = 2 + 2 * p;
+            desired[4] = 4;
+        }
+        return;
+    }
+    count++;
+
+    // Cell of the value, extending the extreme markers
+    int k;
+    if (value < heights[0]) {
+        heights[0] = value;
+        k = 0;
+    } else if (value >= heights[4]) {
+        heights[4] = value;
+        k = 3;
+    } else {
+        for (k = 0; value >= heights[k + 1]; k++);
+    }
+
+    for (int i = k + 1; i < 5; i++) {
+        positions[i]++;
+    }
+    desired[1] += p / 2;
+    desired[2] += p;
+    desired[3] += (1 + p) / 2;
+    desired[4] += 1;
+
+    // Move the inner markers by one position towards where they should be
+    for (int i = 1; i < 4; i++) {
+        const double offset = desired[i] - positions[i];
+        if ((offset >= 1 && positions[i + 1] - positions[i] > 1) ||
+            (offset <= -1 && positions[i - 1] - positions[i] < -1)) {
+            const int d = offset > 0 ? 1 : -1;
+            double height = parabolic(i, d);
+            if (height <= heights[i - 1] || height >= heights[i + 1]) {
+                height = linear(i, d);
+            }
+            heights[i] = height;
+            positions[i] += d;
+        }
+    }
+}
+
+double StreamingQuantile::parabolic(int i, int d) const {
+    return heights[i] + (double)d / (positions[i + 1] - positions[i - 1]) *
+           ((positions[i] - positions[i - 1] + d) * (heights[i + 1] - heights[i]) / (positions[i + 1] - positions[i]) +
+            (positions[i + 1] - positions[i] - d) * (heights[i] - heights[i - 1]) / (positions[i] - positions[i - 1]));
+}
+
+double StreamingQuantile::linear(int i, int d) const {
+    return heights[i] + d * (heights[i + d] - heights[i]) / (positions[i + d] - positions[i]);
+}
+
+double StreamingQuantile::get() const {
+
+    if (count == 0) {
+        return numeric_limits<double>::quiet_NaN();
+    }
+
+    // Along the markers at the rank of the quantile. This is the centre marker once it has
+    // settled, and exact for the first values.
+    const double rank = p * (count - 1);
+    const int markers = std::min(count, 5);
+    int i = 0;
+    while (i + 2 < markers && (count < 5 ? i + 1 : positions[i + 1]) <= rank) {
+        i++;
+    }
+    if (i + 1 >= markers) {
+        return heights[i];
+    }
+    const double left = count < 5 ? i : positions[i];
+    const double right = count < 5 ? i + 1 : positions[i + 1];
+    return heights[i] + (rank - left) / (right - left) * (heights[i + 1] - heights[i]);
+}
+
+/* STATISTICS */
+
+RunningStatistics::RunningStatistics(const vector<double> &quantiles) :
+    count(0), sum(0), minimum(0), maximum(0) {
+    estimators.push_back(StreamingQuantile(0.5));
+    for (size_t i = 0; i < quantiles.size(); i++) {
+        estimators.push_back(StreamingQuantile(quantiles[i]));
+    }
+}
+
+void RunningStatistics::add(double value) {
+    minimum = count == 0 ? value : std::min(minimum, value);
+    maximum = count == 0 ? value : std::max(maximum, value);
+    sum += value;
+    count++;
+    for (size_t i = 0; i < estimators.size(); i++) {
+        estimators[i].add(value);
+    }
+}
+
+void RunningStatistics::clear() {
+    count = 0;
+    sum = 0;
+    for (size_t i = 0; i < estimators.size(); i++) {
+        estimators[i].clear();
+    }
+}
+
+double RunningStatistics::mean() const {
+    return count > 0 ? sum / count : numeric_limits<double>::quiet_NaN();
+}
+
+double RunningStatistics::min() const {
+    return count > 0 ? minimum : numeric_limits<double>::quiet_NaN();
+}
+
+double RunningStatistics::max() const {
+    return count > 0 ? maximum : numeric_limits<double>::quiet_NaN();
+}
@@ -0,0 +1,75 @@
+//
+//  RunningStatistics.hpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#ifndef RunningStatistics_hpp
+#define RunningStatistics_hpp
+
+#include <vector>
+
+// Quantile of a stream by the P² algorithm (Jain and Chlamtac): five markers whose heights are
+// adjusted by piecewise parabolic interpolation as values arrive. Constant time and memory per
+// value; exact until five values have been seen.
+class StreamingQuantile {
+
+public:
+
+    explicit StreamingQuantile(double p = 0.5);
+
+    void add(double value);
+
+    // NaN before the first value
+    double get() const;
+
+    void clear() { count = 0; }
+
+private:
+
+    double parabolic(int i, int d) const;
+    double linear(int i, int d) const;
+
+    double p;
+    int count;
+    double heights[5];      // Marker heights, the first values sorted until there are five
+    int positions[5];
+    double desired[5];      // Desired marker positions
+};
+
+// Mean, minimum, maximum, median and further quantiles of a stream of values, without storing it
+class RunningStatistics {
+
+public:
+
+    // quantiles: probabilities in (0, 1) tracked besides the median
+    explicit RunningStatistics(const std::vector<double> &quantiles = std::vector<double>());
+
+    void add(double value);
+
+    void clear();
+
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // NaN while empty
+    double mean() const;
+    double min() const;
+    double max() const;
+    double median() const { return estimators[0].get(); }
+
+    // Quantile i of those given at construction
+    double quantile(int i) const { return estimators[i + 1].get(); }
+    int quantiles() const { return (int)estimators.size() - 1; }
+
+private:
+
+    int count;
+    double sum;
+    double minimum;
+    double maximum;
+    std::vector<StreamingQuantile> estimators;  // Median first
+};
+
+#endif /* RunningStatistics_hpp */
@@ -0,0 +1,96 @@
+//
+//  ThreadPool.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(int threads) : job(NULL), jobSize(0), next(0), done(0), generation(0), stop(false) {
+    if (threads <= 0) {
+        threads = std::max(1, (int)std::thread::hardware_concurrency());
+    }
+    for (int i = 1; i < threads; i++) {
+        workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    cond.notify_all();
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+}
+
+void ThreadPool::parallelFor(int n, const std::function<void(int)> &fn) {
+
+    // Nothing to share
+    if (workers.empty() || n < 2) {
+        for (int i = 0; i < n; i++) {
+            fn(i);
+        }
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    job = &fn;
+    jobSize = n;
+    next = 0;
+    done = 0;
+    error = std::exception_ptr();
+    generation++;
+    cond.notify_all();
+
+    runTasks(lock);
+    doneCond.wait(lock, [this]{ return done == jobSize; });
+
+    job = NULL;
+    std::exception_ptr e = error;
+    error = std::exception_ptr();
+    lock.unlock();
+
+    if (e) {
+        std::rethrow_exception(e);
+    }
+}
+
+void ThreadPool::runTasks(std::unique_lock<std::mutex> &lock) {
+    while (job && next < jobSize) {
+        const std::function<void(int)> *fn = job;
+        int i = next++;
+        lock.unlock();
+        std::exception_ptr e;
+        try {
+            (*fn)(i);
+        } catch (...) {
+            e = std::current_exception();
+        }
+        lock.lock();
+        if (e && !error) {
+            error = e;
+        }
+        if (++done == jobSize) {
+            doneCond.notify_all();
+        }
+    }
+}
+
+void ThreadPool::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    unsigned seen = generation;
+    while (true) {
+        cond.wait(lock, [&]{ return stop || generation != seen; });
+        if (stop) {
+            return;
+        }
+        seen = generation;
+        runTasks(lock);
+    }
+}
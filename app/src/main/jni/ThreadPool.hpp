@@ -0,0 +1,59 @@
+//
+//  ThreadPool.hpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#ifndef ThreadPool_hpp
+#define ThreadPool_hpp
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for fork-join work within one frame.
+// The calling thread takes part in the work, so a pool of size 1 runs everything inline.
+// parallelFor must not be called concurrently on the same pool.
+class ThreadPool {
+
+public:
+
+    // threads: total number of threads including the caller, 0 for one per core
+    explicit ThreadPool(int threads = 0);
+    ~ThreadPool();
+
+    // Number of threads including the caller
+    int size() const { return (int)workers.size() + 1; }
+
+    // Run fn(i) for i in [0, n) and block until all calls have returned.
+    // The first exception thrown by fn is rethrown on the calling thread.
+    void parallelFor(int n, const std::function<void(int)> &fn);
+
+private:
+
+    ThreadPool(const ThreadPool &);
+    ThreadPool &operator=(const ThreadPool &);
+
+    void workerLoop();
+    void runTasks(std::unique_lock<std::mutex> &lock);  // Claims indices until the job is exhausted
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable cond;       // Signals a new job or stop to the workers
+    std::condition_variable doneCond;   // Signals completion of the job to the caller
+
+    // Current job, guarded by mutex
+    const std::function<void(int)> *job;
+    int jobSize;
+    int next;
+    int done;
+    unsigned generation;
+    std::exception_ptr error;
+    bool stop;
+};
+
+#endif /* ThreadPool_hpp */
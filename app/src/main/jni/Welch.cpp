@@ -0,0 +1,63 @@
+//
+//  Welch.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#include "Welch.hpp"
+
+#include <math.h>
+#include <algorithm>
+
+#define SEC_PER_MIN 60
+
+bool Welch::advance(double fps, double seconds, double lowBpm, double highBpm, int64_t samples, int total) {
+
+    this->samples = samples;
+
+    // Fixed once the window first covers a segment
+    if (length == 0) {
+        const int n = std::max((int)lround(seconds * fps), 2);
+        if (total < n) {
+            return false;
+        }
+        length = n;
+        low = std::min((int)(length * lowBpm / SEC_PER_MIN / fps), length / 2);
+        high = std::max(low, std::min((int)(length * highBpm / SEC_PER_MIN / fps) + 1, length / 2));
+    }
+
+    // Drop segments that have left the window
+    while (!ends.empty() && ends.front() - length < samples - total) {
+        powers.pop_front();
+        ends.pop_front();
+    }
+
+    return total >= length && (ends.empty() || samples - ends.back() >= std::max(length / 2, 1));
+}
+
+void Welch::add(const std::vector<double> &power) {
+    powers.push_back(power);
+    ends.push_back(samples);
+}
+
+void Welch::mean(std::vector<double> &power) const {
+    power.assign(powers.empty() ? 0 : powers.front().size(), 0);
+    for (size_t i = 0; i < powers.size(); i++) {
+        for (size_t j = 0; j < power.size(); j++) {
+            power[j] += powers[i][j];
+        }
+    }
+    for (size_t j = 0; j < power.size(); j++) {
+        power[j] /= powers.size();
+    }
+}
+
+void Welch::clear() {
+    length = 0;
+    low = 0;
+    high = 0;
+    samples = 0;
+    powers.clear();
+    ends.clear();
+}
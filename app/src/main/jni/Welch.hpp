@@ -0,0 +1,55 @@
+//
+//  Welch.hpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#ifndef Welch_hpp
+#define Welch_hpp
+
+#include <stdint.h>
+#include <deque>
+#include <vector>
+
+// Segments of a sliding signal window for Welch's method: the band power spectra of half
+// overlapping segments, each transformed once when it is complete and averaged while it is in
+// the window. Segment length and band are fixed by the first window that covers a segment, so that
+// the cached spectra stay comparable while the measured frame rate jitters.
+class Welch {
+
+public:
+
+    Welch() : length(0), low(0), high(0), samples(0) {;}
+
+    // Move to the window of the last total samples of the signal, samples being its count so far.
+    // The first window that covers seconds at fps fixes the segment length and the band
+    // [lowBpm, highBpm] in DFT bins of that length, within the Nyquist limit.
+    // Returns whether a segment is due: the last segmentLength() samples of the window, half a
+    // segment past the previous one.
+    bool advance(double fps, double seconds, double lowBpm, double highBpm, int64_t samples, int total);
+
+    // Add the band power spectrum of the due segment
+    void add(const std::vector<double> &power);
+
+    // Mean band power spectrum of the segments in the window, empty if there are none
+    void mean(std::vector<double> &power) const;
+
+    void clear();
+
+    int segmentLength() const { return length; }    // 0 until fixed
+    int bandLow() const { return low; }
+    int bandHigh() const { return high; }
+    int segmentCount() const { return (int)ends.size(); }
+
+private:
+
+    int length;
+    int low;
+    int high;
+    int64_t samples;                            // Count at the last advance
+    std::deque<std::vector<double> > powers;    // Oldest first
+    std::deque<int64_t> ends;                   // Sample after each segment
+};
+
+#endif /* Welch_hpp */
@@ -0,0 +1,139 @@
+//
+//  WorkStealingPool.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#include "WorkStealingPool.hpp"
+
+#include <algorithm>
+
+// Pool and index of the worker running on this thread
+static thread_local const WorkStealingPool *currentPool = NULL;
+static thread_local int currentIndex = -1;
+
+WorkStealingPool::WorkStealingPool(int threads) : queued(0), pending(0), next(0), stop(false) {
+    if (threads <= 0) {
+        threads = std::max(1, (int)std::thread::hardware_concurrency());
+    }
+    for (int i = 0; i < threads; i++) {
+        workers.push_back(std::unique_ptr<Worker>(new Worker()));
+    }
+    for (int i = 0; i < threads; i++) {
+        workers[i]->thread = std::thread(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    cond.notify_all();
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i]->thread.join();
+    }
+}
+
+int WorkStealingPool::currentWorker() const {
+    return currentPool == this ? currentIndex : -1;
+}
+
+void WorkStealingPool::submit(const Task &task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        int index = currentWorker();
+        if (index < 0) {
+            index = next++ % workers.size();
+        }
+        Worker &worker = *workers[index];
+        {
+            std::lock_guard<std::mutex> workerLock(worker.mutex);
+            worker.tasks.push_back(task);
+        }
+        queued++;
+        pending++;
+    }
+    cond.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCond.wait(lock, [this]{ return pending == 0; });
+    std::exception_ptr e = error;
+    error = std::exception_ptr();
+    lock.unlock();
+    if (e) {
+        std::rethrow_exception(e);
+    }
+}
+
+bool WorkStealingPool::pop(int index, Task &task) {
+
+    // Newest own task, its data is most likely still in cache
+    {
+        Worker &worker = *workers[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.empty()) {
+            task = worker.tasks.back();
+            worker.tasks.pop_back();
+            return true;
+        }
+    }
+
+    // Oldest task of another worker, usually the largest chunk of remaining work
+    for (size_t k = 1; k < workers.size(); k++) {
+        Worker &victim = *workers[(index + k) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void WorkStealingPool::workerLoop(int index) {
+
+    currentPool = this;
+    currentIndex = index;
+
+    while (true) {
+
+        Task task;
+        if (pop(index, task)) {
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queued--;
+            }
+
+            std::exception_ptr e;
+            try {
+                task();
+            } catch (...) {
+                e = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (e && !error) {
+                error = e;
+            }
+            if (--pending == 0) {
+                doneCond.notify_all();
+            }
+
+        } else {
+
+            // Sleep until there is something to steal
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [this]{ return stop || queued > 0; });
+            if (stop) {
+                return;
+            }
+        }
+    }
+}
@@ -0,0 +1,71 @@
+//
+//  WorkStealingPool.hpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#ifndef WorkStealingPool_hpp
+#define WorkStealingPool_hpp
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Thread pool for many independent, long running tasks.
+// Each worker has its own queue and runs its newest task first; idle workers steal the
+// oldest task from another worker. Tasks submitted from a worker go to its own queue.
+class WorkStealingPool {
+
+public:
+
+    typedef std::function<void()> Task;
+
+    // threads: number of workers, 0 for one per core
+    explicit WorkStealingPool(int threads = 0);
+    ~WorkStealingPool();
+
+    int size() const { return (int)workers.size(); }
+
+    // Index of the calling worker in [0, size()), -1 if not called from a worker of this pool
+    int currentWorker() const;
+
+    void submit(const Task &task);
+
+    // Block until all submitted tasks, including those they submit, have run.
+    // The first exception thrown by a task is rethrown here.
+    void wait();
+
+private:
+
+    WorkStealingPool(const WorkStealingPool &);
+    WorkStealingPool &operator=(const WorkStealingPool &);
+
+    struct Worker {
+        std::deque<Task> tasks;
+        std::mutex mutex;
+        std::thread thread;
+    };
+
+    void workerLoop(int index);
+    bool pop(int index, Task &task);    // Own newest task, else steal
+
+    std::vector<std::unique_ptr<Worker> > workers;
+    std::mutex mutex;
+    std::condition_variable cond;       // Signals new tasks or stop to idle workers
+    std::condition_variable doneCond;   // Signals that no task is pending
+
+    // Guarded by mutex
+    int queued;                         // Submitted, not yet started
+    int pending;                        // Submitted, not yet finished
+    unsigned next;                      // Round robin for tasks from outside the pool
+    std::exception_ptr error;
+    bool stop;
+};
+
+#endif /* WorkStealingPool_hpp */
@@ -0,0 +1,113 @@
+//
+// Created by Philipp Rouast on 16/10/26.
+//
+
+#include "com_prouast_heartbeat_FFmpegDecoder.h"
+#include "FFmpegDecoder.hpp"
+#include <android/log.h>
+
+#define LOG_TAG "Heartbeat::FFmpegDecoder"
+#define LOGD(...) ((void)__android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__))
+
+/*
+ * Class:     com_prouast_heartbeat_FFmpegDecoder
+ * Method:    _initialise
+ * Signature: ()J
+ */
+JNIEXPORT jlong JNICALL Java_com_prouast_heartbeat_FFmpegDecoder__1initialise
+        (JNIEnv *jenv, jclass) {
+    LOGD("Java_com_prouast_heartbeat_FFmpegDecoder__1initialise enter");
+    jlong result = 0;
+    try {
+        result = (jlong)new FFmpegDecoder();
+    } catch (...) {
+        jclass je = jenv->FindClass("java/lang/Exception");
+        jenv->ThrowNew(je, "Unknown exception in JNI code.");
+    }
+    LOGD("Java_com_prouast_heartbeat_FFmpegDecoder__1initialise exit");
+    return result;
+}
+
+/*
+ * Class:     com_prouast_heartbeat_FFmpegDecoder
+ * Method:    _openFile
+ * Signature: (JLjava/lang/String;I)Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_prouast_heartbeat_FFmpegDecoder__1openFile
+        (JNIEnv *jenv, jclass, jlong self, jstring jfilename, jint jpoolSize) {
+    LOGD("Java_com_prouast_heartbeat_FFmpegDecoder__1openFile enter");
+    jboolean result = false;
+    const char *filename = (*jenv).GetStringUTFChars(jfilename, 0);
+    try {
+        if (self) {
+            result = ((FFmpegDecoder *)self)->OpenFile(filename, jpoolSize, 0);
+        }
+    } catch (...) {
+        jclass je = jenv->FindClass("java/lang/Exception");
+        jenv->ThrowNew(je, "Unknown exception in JNI code.");
+    }
+    jenv->ReleaseStringUTFChars(jfilename, filename);
+    LOGD("Java_com_prouast_heartbeat_FFmpegDecoder__1openFile exit");
+    return result;
+}
+
+/*
+ * Class:     com_prouast_heartbeat_FFmpegDecoder
+ * Method:    _getWidth
+ * Signature: (J)I
+ */
+JNIEXPORT jint JNICALL Java_com_prouast_heartbeat_FFmpegDecoder__1getWidth
+        (JNIEnv *jenv, jclass, jlong self) {
+    return self ? ((FFmpegDecoder *)self)->GetWidth() : 0;
+}
+
+/*
+ * Class:     com_prouast_heartbeat_FFmpegDecoder
+ * Method:    _getHeight
+ * Signature: (J)I
+ */
+JNIEXPORT jint JNICALL Java_com_prouast_heartbeat_FFmpegDecoder__1getHeight
+        (JNIEnv *jenv, jclass, jlong self) {
+    return self ? ((FFmpegDecoder *)self)->GetHeight() : 0;
+}
+
+/*
+ * Class:     com_prouast_heartbeat_FFmpegDecoder
+ * Method:    _readFrame
+ * Signature: (JJ)J
+ */
+JNIEXPORT jlong JNICALL Java_com_prouast_heartbeat_FFmpegDecoder__1readFrame
+        (JNIEnv *jenv, jclass, jlong self, jlong jDataAddr) {
+    jlong result = -1;
+    try {
+        if (self) {
+            int64_t time;
+            if (((FFmpegDecoder *)self)->ReadFrame((uint8_t *)jDataAddr, time)) {
+                result = time;
+            }
+        }
+    } catch (...) {
+        jclass je = jenv->FindClass("java/lang/Exception");
+        jenv->ThrowNew(je, "Unknown exception in JNI code.");
+    }
+    return result;
+}
+
+/*
+ * Class:     com_prouast_heartbeat_FFmpegDecoder
+ * Method:    _closeFile
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_com_prouast_heartbeat_FFmpegDecoder__1closeFile
+        (JNIEnv *jenv, jclass, jlong self) {
+    LOGD("Java_com_prouast_heartbeat_FFmpegDecoder__1closeFile enter");
+    try {
+        if (self) {
+            ((FFmpegDecoder *)self)->CloseFile();
+        }
+    } catch (...) {
+        jclass je = jenv->FindClass("java/lang/Exception");
+        jenv->ThrowNew(je, "Unknown exception in JNI code.");
+    }
+    LOGD("Java_com_prouast_heartbeat_FFmpegDecoder__1closeFile exit");
+}
@@ -0,0 +1,61 @@
+/* DO NOT EDIT THIS FILE - it is machine generated */
+#include <jni.h>
+/* Header for class com_prouast_heartbeat_FFmpegDecoder */
+
+#ifndef _Included_com_prouast_heartbeat_FFmpegDecoder
+#define _Included_com_prouast_heartbeat_FFmpegDecoder
+#ifdef __cplusplus
+extern "C" {
+#endif
+/*
+ * Class:     com_prouast_heartbeat_FFmpegDecoder
+ * Method:    _initialise
+ * Signature: ()J
+ */
+JNIEXPORT jlong JNICALL Java_com_prouast_heartbeat_FFmpegDecoder__1initialise
+  (JNIEnv *, jclass);
+
+/*
+ * Class:     com_prouast_heartbeat_FFmpegDecoder
+ * Method:    _openFile
+ * Signature: (JLjava/lang/String;I)Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_prouast_heartbeat_FFmpegDecoder__1openFile
+  (JNIEnv *, jclass, jlong, jstring, jint);
+
+/*
+ * Class:     com_prouast_heartbeat_FFmpegDecoder
+ * Method:    _getWidth
+ * Signature: (J)I
+ */
+JNIEXPORT jint JNICALL Java_com_prouast_heartbeat_FFmpegDecoder__1getWidth
+  (JNIEnv *, jclass, jlong);
+
+/*
+ * Class:     com_prouast_heartbeat_FFmpegDecoder
+ * Method:    _getHeight
+ * Signature: (J)I
+ */
+JNIEXPORT jint JNICALL Java_com_prouast_heartbeat_FFmpegDecoder__1getHeight
+  (JNIEnv *, jclass, jlong);
+
+/*
+ * Class:     com_prouast_heartbeat_FFmpegDecoder
+ * Method:    _readFrame
+ * Signature: (JJ)J
+ */
+JNIEXPORT jlong JNICALL Java_com_prouast_heartbeat_FFmpegDecoder__1readFrame
+  (JNIEnv *, jclass, jlong, jlong);
+
+/*
+ * Class:     com_prouast_heartbeat_FFmpegDecoder
+ * Method:    _closeFile
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_com_prouast_heartbeat_FFmpegDecoder__1closeFile
+  (JNIEnv *, jclass, jlong);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -31,21 +31,29 @@ JNIEXPORT jlong JNICALL Java_com_prouast_heartbeat_FFmpegEncoder__1initialise
 /*
  * Class:     com_prouast_heartbeat_FFmpegEncoder
  * Method:    _openFile
- * Signature: (JLjava/lang/String;IIII)Z
+ * Signature: (JLjava/lang/String;IIIIIIILjava/lang/String;IIZ)Z
  */
 JNIEXPORT jboolean JNICALL Java_com_prouast_heartbeat_FFmpegEncoder__1openFile
-        (JNIEnv *jenv, jclass, jlong self, jstring jfilename, jint jwidth, jint jheight, jint jbitrate, jint jframerate) {
+        (JNIEnv *jenv, jclass, jlong self, jstring jfilename, jint jwidth, jint jheight, jint jbitrate, jint jframerate,
+         jint jthreads, jint jthreadType, jint jgopSize, jstring jpreset,
+         jint jcropWidth, jint jcropHeight, jboolean jlossless) {
     LOGD("Java_com_prouast_heartbeat_FFmpegEncoder__1openFile enter");
     jboolean result = false;
     const char *filename = (*jenv).GetStringUTFChars(jfilename, 0); // TODO correct? see wikipedia
+    const char *preset = jpreset ? (*jenv).GetStringUTFChars(jpreset, 0) : NULL;
     try {
         if (self) {
-            result = ((FFmpegEncoder *)self)->OpenFile(filename, jwidth, jheight, jbitrate, jframerate);
+            result = ((FFmpegEncoder *)self)->OpenFile(filename, jwidth, jheight, jbitrate, jframerate,
+                                                       jthreads, jthreadType, jgopSize, preset,
+                                                       jcropWidth, jcropHeight, jlossless);
         }
     } catch (...) {
         jclass je = jenv->FindClass("java/lang/Exception");
         jenv->ThrowNew(je, "Unknown exception in JNI code.");
     }
+    if (preset) {
+        jenv->ReleaseStringUTFChars(jpreset, preset);
+    }
     jenv->ReleaseStringUTFChars(jfilename, filename);
     LOGD("Java_com_prouast_heartbeat_FFmpegEncoder__1openFile exit");
     return result;
@@ -72,6 +80,45 @@ JNIEXPORT void JNICALL Java_com_prouast_heartbeat_FFmpegEncoder__1writeFrame
     LOGD("Java_com_prouast_heartbeat_FFmpegEncoder__1writeFrame exit");
 }
 
+/*
+ * Class:     com_prouast_heartbeat_FFmpegEncoder
+ * Method:    _writeFrameNV21
+ * Signature: (JJJ)V
+ */
+JNIEXPORT void JNICALL Java_com_prouast_heartbeat_FFmpegEncoder__1writeFrameNV21
+        (JNIEnv *jenv, jclass, jlong self, jlong jDataAddr, jlong jTime) {
+    LOGD("Java_com_prouast_heartbeat_FFmpegEncoder__1writeFrameNV21 enter");
+    try {
+        if (self) {
+            uint8_t *dataAddr = (uint8_t *)jDataAddr;
+            ((FFmpegEncoder *)self)->WriteFrameNV21(dataAddr, jTime);
+        }
+    } catch (...) {
+        jclass je = jenv->FindClass("java/lang/Exception");
+        jenv->ThrowNew(je, "Unknown exception in JNI code.");
+    }
+    LOGD("Java_com_prouast_heartbeat_FFmpegEncoder__1writeFrameNV21 exit");
+}
+
+/*
+ * Class:     com_prouast_heartbeat_FFmpegEncoder
+ * Method:    _setCropBox
+ * Signature: (JIIII)V
+ */
+JNIEXPORT void JNICALL Java_com_prouast_heartbeat_FFmpegEncoder__1setCropBox
+        (JNIEnv *jenv, jclass, jlong self, jint jx, jint jy, jint jwidth, jint jheight) {
+    LOGD("Java_com_prouast_heartbeat_FFmpegEncoder__1setCropBox enter");
+    try {
+        if (self) {
+            ((FFmpegEncoder *)self)->SetCropBox(jx, jy, jwidth, jheight);
+        }
+    } catch (...) {
+        jclass je = jenv->FindClass("java/lang/Exception");
+        jenv->ThrowNew(je, "Unknown exception in JNI code.");
+    }
+    LOGD("Java_com_prouast_heartbeat_FFmpegEncoder__1setCropBox exit");
+}
+
 /*
  * Class:     com_prouast_heartbeat_FFmpegEncoder
  * Method:    _closeFile
@@ -18,10 +18,10 @@ JNIEXPORT jlong JNICALL Java_com_prouast_heartbeat_FFmpegEncoder__1initialise
 /*
  * Class:     com_prouast_heartbeat_FFmpegEncoder
  * Method:    _openFile
- * Signature: (JLjava/lang/String;IIII)Z
+ * Signature: (JLjava/lang/String;IIIIIIILjava/lang/String;IIZ)Z
  */
 JNIEXPORT jboolean JNICALL Java_com_prouast_heartbeat_FFmpegEncoder__1openFile
-  (JNIEnv *, jclass, jlong, jstring, jint, jint, jint, jint);
+  (JNIEnv *, jclass, jlong, jstring, jint, jint, jint, jint, jint, jint, jint, jstring, jint, jint, jboolean);
 
 /*
  * Class:     com_prouast_heartbeat_FFmpegEncoder
@@ -31,6 +31,22 @@ JNIEXPORT jboolean JNICALL Java_com_prouast_heartbeat_FFmpegEncoder__1openFile
 JNIEXPORT void JNICALL Java_com_prouast_heartbeat_FFmpegEncoder__1writeFrame
   (JNIEnv *, jclass, jlong, jlong, jlong);
 
+/*
+ * Class:     com_prouast_heartbeat_FFmpegEncoder
+ * Method:    _writeFrameNV21
+ * Signature: (JJJ)V
+ */
+JNIEXPORT void JNICALL Java_com_prouast_heartbeat_FFmpegEncoder__1writeFrameNV21
+  (JNIEnv *, jclass, jlong, jlong, jlong);
+
+/*
+ * Class:     com_prouast_heartbeat_FFmpegEncoder
+ * Method:    _setCropBox
+ * Signature: (JIIII)V
+ */
+JNIEXPORT void JNICALL Java_com_prouast_heartbeat_FFmpegEncoder__1setCropBox
+  (JNIEnv *, jclass, jlong, jint, jint, jint, jint);
+
 /*
  * Class:     com_prouast_heartbeat_FFmpegEncoder
  * Method:    _closeFile
@@ -4,6 +4,7 @@
 
 #include "com_prouast_heartbeat_RPPG.h"
 #include <android/log.h>
+#include <memory>
 #include "RPPG.hpp"
 
 #define LOG_TAG "Heartbeat::RPPG"
@@ -19,6 +20,97 @@ void GetJStringContent(JNIEnv *AEnv, jstring AStr, std::string &ARes) {
   AEnv->ReleaseStringUTFChars(AStr,s);
 }
 
+void GetJDoubleArrayContent(JNIEnv *jenv, jdoubleArray jarray, std::vector<double> &result) {
+    if (!jarray) {
+        result.clear();
+        return;
+    }
+    result.resize(jenv->GetArrayLength(jarray));
+    if (!result.empty()) {
+        jenv->GetDoubleArrayRegion(jarray, 0, (jsize)result.size(), result.data());
+    }
+}
+
+// Delivers RPPG results to the Java listener
+class JavaListener {
+
+public:
+
+    JavaListener(JNIEnv *jenv, jobject listener) {
+        // Save reference to Java VM
+        jenv->GetJavaVM(&jvm);
+        // Save global reference to listener object
+        this->listener = jenv->NewGlobalRef(listener);
+    }
+
+    ~JavaListener() {
+        JNIEnv *jenv;
+        if (jvm->GetEnv((void **)&jenv, JNI_VERSION_1_6) == JNI_OK) {
+            jenv->DeleteGlobalRef(listener);
+        }
+    }
+
+    void callback(int64_t time, int id, int algorithm, double meanBpm, double minBpm, double maxBpm, double medianBpm,
+                  const std::vector<double> &quantileBpms, double snr) {
+
+        JNIEnv *jenv;
+        int stat = jvm->GetEnv((void **)&jenv, JNI_VERSION_1_6);
+
+        if (stat == JNI_EDETACHED) {
+            LOGD("GetEnv: not attached");
+            if (jvm->AttachCurrentThread(&jenv, NULL) != 0) {
+                LOGD("GetEnv: Failed to attach");
+            } else {
+                LOGD("GetEnv: Attached to %d", jenv);
+            }
+        } else if (stat == JNI_OK) {
+            //
+        } else if (stat == JNI_EVERSION) {
+            LOGD("GetEnv: version not supported");
+        }
+
+        // Return object
+
+        // Get Return object class reference
+        jclass returnObjectClassRef = jenv->FindClass("com/prouast/heartbeat/RPPGResult");
+
+        // Get Return object constructor method
+        jmethodID constructorMethodID = jenv->GetMethodID(returnObjectClassRef, "<init>", "(JIIDDDD[DD)V");
+
+        // Quantiles in the order of the settings
+        jdoubleArray quantiles = jenv->NewDoubleArray((jsize)quantileBpms.size());
+        if (!quantileBpms.empty()) {
+            jenv->SetDoubleArrayRegion(quantiles, 0, (jsize)quantileBpms.size(), quantileBpms.data());
+        }
+
+        // Create Info class
+        jobject returnObject = jenv->NewObject(returnObjectClassRef, constructorMethodID, (jlong)time, (jint)id, (jint)algorithm, meanBpm, minBpm, maxBpm, medianBpm, quantiles, snr);
+
+        // Listener
+
+        // Get the Listener class reference
+        jclass listenerClassRef = jenv->GetObjectClass(listener);
+
+        // Use Listener class reference to load the eventOccurred method
+        jmethodID listenerEventOccuredMethodID = jenv->GetMethodID(listenerClassRef, "onRPPGResult", "(Lcom/prouast/heartbeat/RPPGResult;)V");
+
+        // Invoke listener eventOccurred
+        jenv->CallVoidMethod(listener, listenerEventOccuredMethodID, returnObject);
+
+        // Cleanup
+        jenv->DeleteLocalRef(returnObject);
+        jenv->DeleteLocalRef(quantiles);
+    }
+
+private:
+
+    // The JavaVM
+    JavaVM *jvm;
+
+    // The listener
+    jobject listener;
+};
+
 /*
  * Class:     com_prouast_heartbeat_RPPG
  * Method:    _initialise
@@ -41,23 +133,36 @@ JNIEXPORT jlong JNICALL Java_com_prouast_heartbeat_RPPG__1initialise
 /*
  * Class:     com_prouast_heartbeat_RPPG
  * Method:    _load
- * Signature: (JLcom/prouast/heartbeat/RPPG/RPPGListener;IIIDIDDIILjava/lang/String;Ljava/lang/String;ZZ)V
+ * Signature: (JLcom/prouast/heartbeat/RPPG/RPPGListener;IZIIDIDDDIIDIII[DZZIZIILjava/lang/String;Ljava/lang/String;Ljava/lang/String;ZZ)V
  */
 JNIEXPORT void JNICALL Java_com_prouast_heartbeat_RPPG__1load
-(JNIEnv *jenv, jclass, jlong self, jobject jlistener, jint jalgorithm, jint jwidth, jint jheight,
-jdouble jtimeBase, jint jdownsample, jdouble jsamplingFrequency, jdouble jrescanFrequency,
-jint jminSignalSize, jint jmaxSignalSize, jstring jlogPath, jstring jclassifierPath,
-jboolean jlog, jboolean jgui) {
+(JNIEnv *jenv, jclass, jlong self, jobject jlistener, jint jalgorithm, jboolean jcompareAlgorithms, jint jwidth, jint jheight,
+jdouble jtimeBase, jint jdownsample, jdouble jsamplingFrequency, jdouble jrescanFrequency, jdouble jminTrackingConfidence,
+jint jminSignalSize, jint jmaxSignalSize, jdouble jminSignalQuality, jint jspectrum, jint jspectralZoom, jint jwelchLength, jdoubleArray jquantiles,
+jboolean jsinglePrecision, jboolean jmotionCompensation, jint jgridSize, jboolean jskinDetection, jint jmaxFaces, jint jthreads,
+jstring jlogPath, jstring jclassifierPath, jstring jeyeClassifierPath, jboolean jlog, jboolean jgui) {
     LOGD("Java_com_prouast_heartbeat_RPPG__1load enter");
     bool log = jlog;
     bool gui = jgui;
-    std::string logPath, classifierPath;
+    std::string logPath, classifierPath, eyeClassifierPath;
+    std::vector<double> quantiles;
     try {
         GetJStringContent(jenv, jlogPath, logPath);
         GetJStringContent(jenv, jclassifierPath, classifierPath);
-        ((RPPG *)self)->load(jlistener, jenv, jalgorithm, jwidth, jheight, jtimeBase, jdownsample,
-                                   jsamplingFrequency, jrescanFrequency, jminSignalSize, jmaxSignalSize,
-                                   logPath, classifierPath, log, gui);
+        GetJStringContent(jenv, jeyeClassifierPath, eyeClassifierPath);
+        GetJDoubleArrayContent(jenv, jquantiles, quantiles);
+        // Released by RPPG::exit
+        std::shared_ptr<JavaListener> listener = std::make_shared<JavaListener>(jenv, jlistener);
+        RPPG::ResultCallback callback = [listener](int64_t time, int id, int algorithm, double meanBpm, double minBpm, double maxBpm,
+                                                   double medianBpm, const std::vector<double> &quantileBpms, double snr) {
+            listener->callback(time, id, algorithm, meanBpm, minBpm, maxBpm, medianBpm, quantileBpms, snr);
+        };
+        ((RPPG *)self)->load(callback, jalgorithm, jcompareAlgorithms, jwidth, jheight, jtimeBase, jdownsample,
+                                   jsamplingFrequency, jrescanFrequency, jminTrackingConfidence,
+                                   jminSignalSize, jmaxSignalSize, jminSignalQuality, jspectrum, jspectralZoom, jwelchLength, quantiles,
+                                   jsinglePrecision, jmotionCompensation, jgridSize, jskinDetection,
+                                   jmaxFaces, jthreads,
+                                   logPath, classifierPath, eyeClassifierPath, log, gui);
     } catch (...) {
       jclass je = jenv->FindClass("java/lang/Exception");
       jenv->ThrowNew(je, "Unknown exception in JNI code.");
@@ -83,6 +188,55 @@ JNIEXPORT void JNICALL Java_com_prouast_heartbeat_RPPG__1processFrame
     LOGD("Java_com_prouast_heartbeat_RPPG__1processFrame exit");
 }
 
+/*
+ * Class:     com_prouast_heartbeat_RPPG
+ * Method:    _processFrameNV21
+ * Signature: (JJJJ)V
+ */
+JNIEXPORT void JNICALL Java_com_prouast_heartbeat_RPPG__1processFrameNV21
+(JNIEnv *jenv, jclass, jlong self, jlong jframeRGB, jlong jframeGray, jlong jtime) {
+    LOGD("Java_com_prouast_heartbeat_RPPG__1processFrameNV21 enter");
+    try {
+        int64_t time = jtime;
+        cv::Mat &frameGray = *((cv::Mat*)jframeGray);
+        // The camera's gray frame is a view on the Y plane of its NV21 buffer: extend it over the chroma rows
+        cv::Mat frameNV21 = frameGray;
+        frameNV21.adjustROI(0, frameGray.rows / 2, 0, 0);
+        if (frameNV21.rows != frameGray.rows * 3 / 2) {
+            jclass je = jenv->FindClass("java/lang/IllegalArgumentException");
+            jenv->ThrowNew(je, "Gray frame is not backed by an NV21 buffer.");
+        } else {
+            ((RPPG *)self)->processFrameNV21(*((cv::Mat*)jframeRGB), frameNV21, time);
+        }
+    } catch (...) {
+        jclass je = jenv->FindClass("java/lang/Exception");
+        jenv->ThrowNew(je, "Unknown exception in JNI code.");
+    }
+    LOGD("Java_com_prouast_heartbeat_RPPG__1processFrameNV21 exit");
+}
+
+/*
+ * Class:     com_prouast_heartbeat_RPPG
+ * Method:    _getFaceBox
+ * Signature: (J[I)Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_prouast_heartbeat_RPPG__1getFaceBox
+(JNIEnv *jenv, jclass, jlong self, jintArray jbox) {
+    jboolean result = false;
+    try {
+        cv::Rect box;
+        if (((RPPG *)self)->getFaceBox(box)) {
+            jint values[] = {box.x, box.y, box.width, box.height};
+            jenv->SetIntArrayRegion(jbox, 0, 4, values);
+            result = true;
+        }
+    } catch (...) {
+        jclass je = jenv->FindClass("java/lang/Exception");
+        jenv->ThrowNew(je, "Unknown exception in JNI code.");
+    }
+    return result;
+}
+
 /*
  * Class:     com_prouast_heartbeat_RPPG
  * Method:    _exit
@@ -92,7 +246,7 @@ JNIEXPORT void JNICALL Java_com_prouast_heartbeat_RPPG__1exit
 (JNIEnv *jenv, jclass, jlong self) {
     LOGD("Java_com_prouast_heartbeat_RPPG__1exit enter");
     try {
-        ((RPPG *)self)->exit(jenv);
+        ((RPPG *)self)->exit();
     } catch (...) {
         jclass je = jenv->FindClass("java/lang/Exception");
         jenv->ThrowNew(je, "Unknown exception in JNI code.");
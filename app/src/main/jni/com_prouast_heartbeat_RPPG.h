@@ -18,10 +18,10 @@ JNIEXPORT jlong JNICALL Java_com_prouast_heartbeat_RPPG__1initialise
 /*
  * Class:     com_prouast_heartbeat_RPPG
  * Method:    _load
- * Signature: (JLcom/prouast/heartbeat/RPPG/RPPGListener;IIIDIDDIILjava/lang/String;Ljava/lang/String;ZZ)V
+ * Signature: (JLcom/prouast/heartbeat/RPPG/RPPGListener;IZIIDIDDDIIDIII[DZZIZIILjava/lang/String;Ljava/lang/String;Ljava/lang/String;ZZ)V
  */
 JNIEXPORT void JNICALL Java_com_prouast_heartbeat_RPPG__1load
-  (JNIEnv *, jclass, jlong, jobject, jint, jint, jint, jdouble, jint, jdouble, jdouble, jint, jint, jstring, jstring, jboolean, jboolean);
+  (JNIEnv *, jclass, jlong, jobject, jint, jboolean, jint, jint, jdouble, jint, jdouble, jdouble, jdouble, jint, jint, jdouble, jint, jint, jint, jdoubleArray, jboolean, jboolean, jint, jboolean, jint, jint, jstring, jstring, jstring, jboolean, jboolean);
 
 /*
  * Class:     com_prouast_heartbeat_RPPG
@@ -31,6 +31,22 @@ JNIEXPORT void JNICALL Java_com_prouast_heartbeat_RPPG__1load
 JNIEXPORT void JNICALL Java_com_prouast_heartbeat_RPPG__1processFrame
   (JNIEnv *, jclass, jlong, jlong, jlong, jlong);
 
+/*
+ * Class:     com_prouast_heartbeat_RPPG
+ * Method:    _processFrameNV21
+ * Signature: (JJJJ)V
+ */
+JNIEXPORT void JNICALL Java_com_prouast_heartbeat_RPPG__1processFrameNV21
+  (JNIEnv *, jclass, jlong, jlong, jlong, jlong);
+
+/*
+ * Class:     com_prouast_heartbeat_RPPG
+ * Method:    _getFaceBox
+ * Signature: (J[I)Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_prouast_heartbeat_RPPG__1getFaceBox
+  (JNIEnv *, jclass, jlong, jintArray);
+
 /*
  * Class:     com_prouast_heartbeat_RPPG
  * Method:    _exit
@@ -0,0 +1,13 @@
+/* DO NOT EDIT THIS FILE - it is machine generated */
+#include <jni.h>
+/* Header for class com_prouast_heartbeat_RPPG_RPPGSpectrum */
+
+#ifndef _Included_com_prouast_heartbeat_RPPG_RPPGSpectrum
+#define _Included_com_prouast_heartbeat_RPPG_RPPGSpectrum
+#ifdef __cplusplus
+extern "C" {
+#endif
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,54 @@
+//
+//  cpu.hpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#ifndef cpu_hpp
+#define cpu_hpp
+
+// Runtime checks for the optional vector units of the SIMD kernels, which select their
+// variant once on first use. NEON kernels are built when the build sets HAVE_NEON.
+// x86 builds also carry AVX and AVX2 kernels, each compiled for that target alone
+// (TARGET_AVX, TARGET_AVX2), so the rest of the binary still runs on any SSE2 CPU.
+
+#if defined(HAVE_NEON) && defined(__arm__) && defined(__ANDROID__)
+#include <cpu-features.h>
+#endif
+
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#define HAVE_AVX 1
+#define TARGET_AVX __attribute__((target("avx")))
+#define HAVE_AVX2 1
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#if defined(HAVE_NEON)
+static inline bool hasNeon() {
+#if defined(__arm__)
+    // NEON is optional on armeabi-v7a
+    return android_getCpuFamily() == ANDROID_CPU_FAMILY_ARM &&
+           (android_getCpuFeatures() & ANDROID_CPU_ARM_FEATURE_NEON);
+#else
+    // Always on aarch64; host tests build the NEON kernels on emulated intrinsics
+    return true;
+#endif
+}
+#endif
+
+#if defined(HAVE_AVX)
+static inline bool hasAvx() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx");
+}
+#endif
+
+#if defined(HAVE_AVX2)
+static inline bool hasAvx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+
+#endif /* cpu_hpp */
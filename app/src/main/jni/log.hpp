@@ -0,0 +1,43 @@
+//
+//  log.hpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#ifndef log_hpp
+#define log_hpp
+
+#if defined(__ANDROID__)
+
+#include <android/log.h>
+
+#else
+
+// Host builds (batch processing): same calls, info and above go to stderr
+#include <stdarg.h>
+#include <stdio.h>
+
+enum {
+    ANDROID_LOG_DEBUG = 3,
+    ANDROID_LOG_INFO,
+    ANDROID_LOG_WARN,
+    ANDROID_LOG_ERROR
+};
+
+static inline int __android_log_print(int prio, const char *tag, const char *fmt, ...) {
+    if (prio < ANDROID_LOG_INFO) {
+        return 0;
+    }
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "%s: ", tag);
+    int result = vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+    va_end(args);
+    return result;
+}
+
+#endif
+
+#endif /* log_hpp */
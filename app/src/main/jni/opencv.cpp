@@ -7,6 +7,8 @@
 //
 
 #include "opencv.hpp"
+#include "signal.hpp"
+#include "skin.hpp"
 
 #include <limits>
 #include <opencv2/highgui/highgui.hpp>
@@ -96,6 +98,165 @@ namespace cv {
         return result;
     }
 
+    // RGB of mean Y, V and U values, BT.601 as used by cvtColor for NV21
+    static Scalar rgbNV21(double y, double v, double u) {
+        y = 1.164 * (y - 16);
+        v -= 128;
+        u -= 128;
+        return Scalar(y + 1.596 * v, y - 0.813 * v - 0.391 * u, y + 2.018 * u, 255);
+    }
+
+    // Mean RGB color of a rectangle in an NV21 frame (Y plane followed by interleaved VU)
+    // The conversion is affine, so it is applied to the Y/U/V means instead of every pixel
+    Scalar meanNV21(const Mat &yuv, Rect roi) {
+
+        CV_Assert(yuv.type() == CV_8UC1 && yuv.rows % 3 == 0);
+
+        const int height = yuv.rows * 2 / 3;
+        roi &= Rect(0, 0, yuv.cols, height);
+        if (roi.area() == 0) {
+            return Scalar();
+        }
+
+        // Luma
+        double y = mean(yuv(roi))(0);
+
+        // Chroma covers 2x2 blocks
+        Mat vu = yuv.rowRange(height, yuv.rows);
+        Mat vu2 = Mat(vu.rows, vu.cols / 2, CV_8UC2, vu.data, vu.step);
+        Rect c = Rect(Point(roi.x / 2, roi.y / 2), Point((roi.br().x + 1) / 2, (roi.br().y + 1) / 2));
+        Scalar vuMean = mean(vu2(c & Rect(0, 0, vu2.cols, vu2.rows)));
+        return rgbNV21(y, vuMean(0), vuMean(1));
+    }
+
+    // Mean RGB color of the skin pixels of a rectangle in an RGBA frame,
+    // false if less than minFraction of its pixels are skin
+    bool meanSkin(const Mat &rgba, Rect roi, double minFraction, Scalar &means) {
+
+        CV_Assert(rgba.type() == CV_8UC4);
+
+        roi &= Rect(0, 0, rgba.cols, rgba.rows);
+        SkinSums sums = {};
+        skinSumsRGBA(rgba.data, (int)rgba.step, roi.x, roi.y, roi.width, roi.height, sums);
+        if (sums.count == 0 || sums.count < minFraction * roi.area()) {
+            return false;
+        }
+
+        means = Scalar((double)sums.sum[0] / sums.count, (double)sums.sum[1] / sums.count,
+                       (double)sums.sum[2] / sums.count, 255);
+        return true;
+    }
+
+    // As meanSkin for an NV21 frame, converting the Y/V/U means of the skin pixels as meanNV21 does
+    bool meanSkinNV21(const Mat &yuv, Rect roi, double minFraction, Scalar &means) {
+
+        CV_Assert(yuv.type() == CV_8UC1 && yuv.rows % 3 == 0);
+
+        const int height = yuv.rows * 2 / 3;
+        roi &= Rect(0, 0, yuv.cols, height);
+        SkinSums sums = {};
+        skinSumsNV21(yuv.data, (int)yuv.step, yuv.ptr(height), (int)yuv.step,
+                     roi.x, roi.y, roi.width, roi.height, sums);
+        if (sums.count == 0 || sums.count < minFraction * roi.area()) {
+            return false;
+        }
+
+        means = rgbNV21((double)sums.sum[0] / sums.count, (double)sums.sum[1] / sums.count,
+                        (double)sums.sum[2] / sums.count);
+        return true;
+    }
+
+    // Sum of a rectangle in an integral image
+    static int rectSum(const Mat &sum, const Rect &r, int channel, int channels) {
+        const int *top = sum.ptr<int>(r.y);
+        const int *bottom = sum.ptr<int>(r.y + r.height);
+        const int x0 = r.x * channels + channel;
+        const int x1 = (r.x + r.width) * channels + channel;
+        return bottom[x1] - bottom[x0] - top[x1] + top[x0];
+    }
+
+    // Left edge of block i of n along a length
+    static int blockEdge(int length, int i, int n) {
+        return length * i / n;
+    }
+
+    // Mean RGB colors of grid x grid blocks of a region, one integral image over the region only.
+    // Row vector of r, g, b per block, row by row. Empty blocks are zero.
+    void blockMeans(const Mat &image, Rect region, int grid, OutputArray _means) {
+
+        CV_Assert(image.depth() == CV_8U && image.channels() >= 3 && grid > 0);
+
+        _means.create(1, 3 * grid * grid, CV_64F);
+        Mat means = _means.getMat();
+        means.setTo(ZERO);
+
+        region &= Rect(0, 0, image.cols, image.rows);
+        if (region.area() == 0) {
+            return;
+        }
+
+        Mat sum;
+        integral(image(region), sum, CV_32S);
+
+        const int channels = image.channels();
+        double *m = means.ptr<double>(0);
+        for (int i = 0; i < grid; i++) {
+            for (int j = 0; j < grid; j++, m += 3) {
+                Rect block = Rect(Point(blockEdge(region.width, j, grid), blockEdge(region.height, i, grid)),
+                                  Point(blockEdge(region.width, j + 1, grid), blockEdge(region.height, i + 1, grid)));
+                if (block.area() > 0) {
+                    for (int c = 0; c < 3; c++) {
+                        m[c] = (double)rectSum(sum, block, c, channels) / block.area();
+                    }
+                }
+            }
+        }
+    }
+
+    // As blockMeans, for an NV21 frame. Chroma of each block covers its 2x2 blocks as in meanNV21.
+    void blockMeansNV21(const Mat &yuv, Rect region, int grid, OutputArray _means) {
+
+        CV_Assert(yuv.type() == CV_8UC1 && yuv.rows % 3 == 0 && grid > 0);
+
+        _means.create(1, 3 * grid * grid, CV_64F);
+        Mat means = _means.getMat();
+        means.setTo(ZERO);
+
+        const int height = yuv.rows * 2 / 3;
+        region &= Rect(0, 0, yuv.cols, height);
+        if (region.area() == 0) {
+            return;
+        }
+
+        Mat vu = yuv.rowRange(height, yuv.rows);
+        Mat vu2 = Mat(vu.rows, vu.cols / 2, CV_8UC2, vu.data, vu.step);
+        Rect chroma = Rect(Point(region.x / 2, region.y / 2),
+                           Point((region.br().x + 1) / 2, (region.br().y + 1) / 2)) & Rect(0, 0, vu2.cols, vu2.rows);
+
+        Mat sumY, sumVU;
+        integral(yuv(region), sumY, CV_32S);
+        integral(vu2(chroma), sumVU, CV_32S);
+
+        double *m = means.ptr<double>(0);
+        for (int i = 0; i < grid; i++) {
+            for (int j = 0; j < grid; j++, m += 3) {
+                Rect block = Rect(Point(blockEdge(region.width, j, grid), blockEdge(region.height, i, grid)),
+                                  Point(blockEdge(region.width, j + 1, grid), blockEdge(region.height, i + 1, grid)));
+                Rect c = Rect(Point((region.x + block.x) / 2, (region.y + block.y) / 2),
+                              Point((region.x + block.br().x + 1) / 2, (region.y + block.br().y + 1) / 2));
+                c = (c & chroma) - chroma.tl();
+                if (block.area() > 0 && c.area() > 0) {
+                    Scalar rgb = rgbNV21((double)rectSum(sumY, block, 0, 1) / block.area(),
+                                         (double)rectSum(sumVU, c, 0, 2) / c.area(),
+                                         (double)rectSum(sumVU, c, 1, 2) / c.area());
+                    m[0] = rgb(0);
+                    m[1] = rgb(1);
+                    m[2] = rgb(2);
+                }
+            }
+        }
+    }
+
     /* FILTERS */
 
     // Subtract mean and divide by standard deviation
@@ -137,6 +298,92 @@ namespace cv {
         a.copyTo(_b);
     }
 
+    // Remove the least squares fit of the head pose from each column of a.
+    // motion holds one row per sample with the change of pose since the previous sample,
+    // the pose over the window is its cumulative sum. The fit is in double, b has the depth of a.
+    void regressMotion(InputArray _a, InputArray _motion, OutputArray _b) {
+
+        Mat a;
+        const int depth = _a.depth();
+        _a.getMat().convertTo(a, CV_64F);
+        Mat motion = _motion.getMat();
+        CV_Assert(motion.type() == CV_64F && motion.rows == a.rows);
+
+        // Regressors: pose and intercept
+        Mat x = Mat::ones(a.rows, motion.cols + 1, CV_64F);
+        for (int i = 0; i < a.rows; i++) {
+            for (int j = 0; j < motion.cols; j++) {
+                x.at<double>(i, j) = motion.at<double>(i, j) + (i > 0 ? x.at<double>(i-1, j) : 0);
+            }
+        }
+
+        // Minimum norm solution, a still head leaves zero columns
+        Mat beta;
+        solve(x, a, beta, DECOMP_SVD);
+
+        Mat b = a - x * beta;
+        b.convertTo(_b, depth);
+    }
+
+    // Combine per-block traces (r, g, b per block and row) into one r, g, b trace.
+    // Blocks are weighted by the inverse variance of their relative frame-to-frame change of green,
+    // which the pulse barely contributes to at camera frame rates. Changes across jumps are ignored.
+    void combineBlocks(InputArray _blocks, InputArray _jumps, OutputArray _b) {
+
+        Mat blocks = _blocks.getMat();
+        Mat jumps = _jumps.getMat();
+        CV_Assert(blocks.type() == CV_64F && blocks.cols % 3 == 0 && jumps.type() == CV_8U && jumps.rows == blocks.rows);
+
+        const int n = blocks.cols / 3;
+        Mat weights = Mat::zeros(1, n, CV_64F);
+        Mat levels = Mat::zeros(3, n, CV_64F);
+        for (int k = 0; k < n; k++) {
+            for (int c = 0; c < 3; c++) {
+                levels.at<double>(c, k) = mean(blocks.col(3 * k + c))(0);
+            }
+            const double level = levels.at<double>(1, k);
+            if (level < 1) {
+                continue;   // Empty or black
+            }
+            double sum = 0, sumSq = 0;
+            int count = 0;
+            for (int i = 1; i < blocks.rows; i++) {
+                if (!jumps.at<uchar>(i, 0)) {
+                    const double d = (blocks.at<double>(i, 3 * k + 1) - blocks.at<double>(i - 1, 3 * k + 1)) / level;
+                    sum += d;
+                    sumSq += d * d;
+                    count++;
+                }
+            }
+            const double variance = count > 1 ? (sumSq - sum * sum / count) / (count - 1) : 0;
+            weights.at<double>(0, k) = 1 / max(variance, 1e-12);
+        }
+
+        const double total = cv::sum(weights)(0);
+        if (total <= 0) {
+            weights.setTo(Scalar(1.0 / n));
+        } else {
+            weights /= total;
+        }
+
+        // Weighted relative change of each block, at the weighted level of all blocks
+        _b.create(blocks.rows, 3, CV_64F);
+        Mat b = _b.getMat();
+        b.setTo(ZERO);
+        for (int c = 0; c < 3; c++) {
+            double level = 0;
+            for (int k = 0; k < n; k++) {
+                const double w = weights.at<double>(0, k);
+                const double l = levels.at<double>(c, k);
+                if (w > 0 && l > 0) {
+                    scaleAdd(blocks.col(3 * k + c), w / l, b.col(c), b.col(c));
+                    level += w * l;
+                }
+            }
+            b.col(c) *= level;
+        }
+    }
+
     // Advanced detrending filter based on smoothness priors approach (High pass equivalent)
     void detrend(InputArray _a, OutputArray _b, int lambda) {
 
@@ -173,6 +420,22 @@ namespace cv {
         }
     }
 
+    // Hann window applied to a column signal, against leakage of short segments
+    void hann(InputArray _a, OutputArray _b) {
+
+        Mat a;
+        _a.getMat().convertTo(a, CV_64F);
+        CV_Assert(a.cols == 1);
+
+        const int n = a.rows;
+        _b.create(n, 1, CV_64F);
+        Mat b = _b.getMat();
+        for (int i = 0; i < n; i++) {
+            const double w = n > 1 ? 0.5 - 0.5 * cos(2 * CV_PI * i / (n - 1)) : 1;
+            b.at<double>(i, 0) = a.at<double>(i, 0) * w;
+        }
+    }
+
     // Bandpass filter
     void bandpass(cv::InputArray _a, cv::OutputArray _b, double low, double high) {
 
@@ -247,6 +510,98 @@ namespace cv {
         }
     }
 
+    // Magnitude spectrum of a real signal from DFT bin low to bin high on a grid zoom times finer,
+    // as zero-padding to zoom times the length would give, without computing the bins outside.
+    // Float signals are transformed in float by the vector kernels.
+    void zoomSpectrum(InputArray _a, OutputArray _b, int low, int high, int zoom) {
+
+        const int n = _a.getMat().rows;
+        const int bins = (high - low) * zoom + 1;
+        CV_Assert(_a.getMat().cols == 1 && zoom > 0 && low <= high);
+
+        if (_a.depth() == CV_32F) {
+            Mat a = _a.getMat().clone();
+            Mat magnitude(bins, 1, CV_32F);
+            bandMagnitudes(a.ptr<float>(0), n, low, zoom, bins, magnitude.ptr<float>(0));
+            magnitude.convertTo(_b, CV_64F);
+            return;
+        }
+
+        Mat a;
+        _a.getMat().convertTo(a, CV_64F);
+        _b.create(bins, 1, CV_64F);
+        Mat b = _b.getMat();
+
+        const double *x = a.ptr<double>(0);
+        for (int j = 0; j < bins; j++) {
+            // Rotating phasor instead of a cos and sin per sample
+            const double w = -2 * CV_PI * (low + (double)j / zoom) / n;
+            const double cw = cos(w), sw = sin(w);
+            double re = 0, im = 0, pr = 1, pi = 0;
+            for (int i = 0; i < n; i++) {
+                re += x[i] * pr;
+                im += x[i] * pi;
+                const double t = pr * cw - pi * sw;
+                pi = pr * sw + pi * cw;
+                pr = t;
+            }
+            b.at<double>(j, 0) = sqrt(re * re + im * im);
+        }
+    }
+
+    // Fractional index of a peak in a magnitude spectrum: vertex of the parabola through the log
+    // magnitudes of the peak and its neighbours (exact for a Gaussian peak), or through the magnitudes
+    // themselves if a neighbour is zero. Peaks at the ends are not moved.
+    double interpolatePeak(InputArray _a, int peak) {
+
+        Mat a;
+        _a.getMat().convertTo(a, CV_64F);
+        CV_Assert(a.cols == 1);
+
+        if (peak <= 0 || peak >= a.rows - 1) {
+            return peak;
+        }
+
+        double l = a.at<double>(peak - 1, 0);
+        double c = a.at<double>(peak, 0);
+        double r = a.at<double>(peak + 1, 0);
+        if (l > 0 && c > 0 && r > 0) {
+            l = log(l);
+            c = log(c);
+            r = log(r);
+        }
+
+        const double curvature = l - 2 * c + r;
+        if (curvature >= 0) {
+            return peak;
+        }
+        return peak + max(-0.5, min(0.5, 0.5 * (l - r) / curvature));
+    }
+
+    // Signal to noise ratio of a band magnitude spectrum in dB: power within width bins of the peak
+    // and of its first harmonic against the remaining power of the band
+    double signalToNoise(InputArray _a, int peak, int harmonic, int width) {
+
+        Mat a;
+        _a.getMat().convertTo(a, CV_64F);
+        CV_Assert(a.cols == 1);
+
+        double signal = 0, noise = 0;
+        for (int i = 0; i < a.rows; i++) {
+            const double p = a.at<double>(i, 0) * a.at<double>(i, 0);
+            if (abs(i - peak) <= width || abs(i - harmonic) <= width) {
+                signal += p;
+            } else {
+                noise += p;
+            }
+        }
+
+        if (noise <= 0) {
+            return signal > 0 ? numeric_limits<double>::infinity() : 0;
+        }
+        return 10 * log10(signal / noise);
+    }
+
     void frequencyToTime(InputArray _a, OutputArray _b) {
 
         Mat a = _a.getMat();
@@ -265,7 +620,7 @@ namespace cv {
     void pcaComponent(cv::InputArray _a, cv::OutputArray _b, cv::OutputArray _pc, int low, int high) {
 
         Mat a = _a.getMat();
-        CV_Assert(a.type() == CV_64F);
+        CV_Assert(a.type() == CV_64F || a.type() == CV_32F);
 
         // Perform PCA
         cv::PCA pca(a, cv::Mat(), CV_PCA_DATA_AS_ROW);
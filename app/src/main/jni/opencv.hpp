@@ -31,18 +31,29 @@ namespace cv {
     void plot(cv::Mat &mat);
     double weightedMeanIndex(InputArray _a, int low, int high);
     double weightedSquaresMeanIndex(InputArray _a, int low, int high);
+    Scalar meanNV21(const Mat &yuv, Rect roi);
+    bool meanSkin(const Mat &rgba, Rect roi, double minFraction, Scalar &means);
+    bool meanSkinNV21(const Mat &yuv, Rect roi, double minFraction, Scalar &means);
+    void blockMeans(const Mat &image, Rect region, int grid, OutputArray _means);
+    void blockMeansNV21(const Mat &yuv, Rect region, int grid, OutputArray _means);
 
     /* FILTERS */
 
     void normalization(cv::InputArray _a, cv::OutputArray _b);
     void denoise(cv::InputArray _a, cv::InputArray _jumps, cv::OutputArray _b);
+    void regressMotion(cv::InputArray _a, cv::InputArray _motion, cv::OutputArray _b);
+    void combineBlocks(cv::InputArray _blocks, cv::InputArray _jumps, cv::OutputArray _b);
     void detrend(cv::InputArray _a, cv::OutputArray _b, int lambda);
     void movingAverage(cv::InputArray _a, cv::OutputArray _b, int n, int s);
+    void hann(cv::InputArray _a, cv::OutputArray _b);
     void bandpass(cv::InputArray _a, cv::OutputArray _b, double low, double high);
     void butterworth_bandpass_filter(cv::Mat &filter, double cutin, double cutoff, int n);
     void butterworth_lowpass_filter(cv::Mat &filter, double cutoff, int n);
     void frequencyToTime(cv::InputArray _a, cv::OutputArray _b);
     void timeToFrequency(cv::InputArray _a, cv::OutputArray _b, bool magnitude);
+    void zoomSpectrum(cv::InputArray _a, cv::OutputArray _b, int low, int high, int zoom);
+    double interpolatePeak(cv::InputArray _a, int peak);
+    double signalToNoise(cv::InputArray _a, int peak, int harmonic, int width);
     void pcaComponent(cv::InputArray _a, cv::OutputArray _b, cv::OutputArray _pc, int low, int high);
     
     /* LOGGING */
@@ -0,0 +1,275 @@
+//
+//  pipeline.hpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#ifndef pipeline_hpp
+#define pipeline_hpp
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "signal.hpp"
+
+// Filter stages of the signal extraction, specialized for the channel count and sample type at
+// compile time. All stages work in place on one row-major buffer of samples, so a chain of them
+// allocates nothing per stage and the trace stays in cache between stages. Each stage computes
+// the same as its Mat counterpart in opencv.cpp; single channel float traces use the vector
+// kernels of signal.hpp.
+namespace pipeline {
+
+    // Trace of C channels, one row of C values per sample
+    template <int C, typename T>
+    struct Trace {
+        T *data;
+        int rows;
+        Trace(T *data, int rows) : data(data), rows(rows) {;}
+        T *row(int i) const { return data + i * C; }
+    };
+
+    struct Context {
+        const uint8_t *jumps;       // One per sample, set where the face was detected again
+        int lambda;                 // Detrend smoothness
+        int window;                 // Moving average window
+        int passes;                 // Moving average passes
+        std::vector<double> *history;   // If set, each stage appends its output here
+        std::vector<double> work;   // Scratch, kept across stages
+        std::vector<double> buffer;
+        std::vector<float> bufferFloat;
+        Context() : jumps(NULL), lambda(0), window(1), passes(0), history(NULL) {;}
+
+        // Scratch of the sample type
+        template <typename T> std::vector<T> &scratch();
+    };
+
+    template <>
+    inline std::vector<double> &Context::scratch<double>() { return buffer; }
+
+    template <>
+    inline std::vector<float> &Context::scratch<float>() { return bufferFloat; }
+
+    // Copy rows of C doubles, stride apart, into a trace of the sample type. Float traces are
+    // taken relative to their first row: raw color means are far from zero and vary little, so
+    // rounding them would dominate the error of the float path. The stages up to normalization
+    // ignore a constant offset per channel.
+    template <int C, typename T>
+    inline void load(const double *src, int stride, int rows, T *dst) {
+        double origin[C] = {0};
+        if (sizeof(T) < sizeof(double) && rows > 0) {
+            for (int c = 0; c < C; c++) {
+                origin[c] = src[c];
+            }
+        }
+        for (int i = 0; i < rows; i++) {
+            for (int c = 0; c < C; c++) {
+                dst[i * C + c] = (T)(src[i * stride + c] - origin[c]);
+            }
+        }
+    }
+
+    // Remove the steps where the face was detected again, as denoise
+    template <int C, typename T>
+    struct Denoise {
+        static void apply(Trace<C, T> &t, Context &context) {
+            T offset[C] = {0}, previous[C];
+            for (int c = 0; c < C; c++) {
+                previous[c] = t.row(0)[c];
+            }
+            for (int i = 1; i < t.rows; i++) {
+                T *r = t.row(i);
+                for (int c = 0; c < C; c++) {
+                    if (context.jumps[i]) {
+                        offset[c] += r[c] - previous[c];
+                    }
+                    previous[c] = r[c];
+                    r[c] -= offset[c];
+                }
+            }
+        }
+    };
+
+    // Zero mean and unit variance per channel, as normalization
+    template <int C, typename T>
+    struct Normalize {
+        static void apply(Trace<C, T> &t, Context &context) {
+            T sum[C] = {0}, sumSq[C] = {0};
+            for (int i = 0; i < t.rows; i++) {
+                const T *r = t.row(i);
+                for (int c = 0; c < C; c++) {
+                    sum[c] += r[c];
+                }
+            }
+            T mean[C], scale[C];
+            for (int c = 0; c < C; c++) {
+                mean[c] = sum[c] / t.rows;
+            }
+            for (int i = 0; i < t.rows; i++) {
+                const T *r = t.row(i);
+                for (int c = 0; c < C; c++) {
+                    sumSq[c] += (r[c] - mean[c]) * (r[c] - mean[c]);
+                }
+            }
+            for (int c = 0; c < C; c++) {
+                scale[c] = 1 / sqrt(sumSq[c] / t.rows);
+            }
+            for (int i = 0; i < t.rows; i++) {
+                T *r = t.row(i);
+                for (int c = 0; c < C; c++) {
+                    r[c] = (r[c] - mean[c]) * scale[c];
+                }
+            }
+        }
+    };
+
+    // Smoothness priors detrending as detrend: a - (I + λ² D2ᵀ D2)⁻¹ a. The matrix is
+    // pentadiagonal, so it is factored as L D Lᵀ and solved in linear time for all channels
+    // instead of inverted. The factors are computed in double for either sample type.
+    template <int C, typename T>
+    struct Detrend {
+        static void apply(Trace<C, T> &t, Context &context) {
+
+            const int n = t.rows;
+            if (n < 3) {
+                return;
+            }
+
+            // Diagonals of the matrix, then of the factors in place
+            std::vector<double> &work = context.work;
+            work.assign(3 * n, 0);
+            double *d = &work[0], *l1 = &work[n], *l2 = &work[2 * n];
+            const double l = (double)context.lambda * context.lambda;
+            for (int i = 0; i < n; i++) {
+                d[i] = 1;
+            }
+            for (int k = 0; k + 2 < n; k++) {
+                // Row k of D2 is (1, -2, 1) at columns k .. k + 2
+                d[k] += l;
+                d[k + 1] += 4 * l;
+                d[k + 2] += l;
+                l1[k + 1] -= 2 * l;
+                l1[k + 2] -= 2 * l;
+                l2[k + 2] += l;
+            }
+            for (int i = 1; i < n; i++) {
+                if (i >= 2) {
+                    l2[i] /= d[i - 2];
+                    l1[i] -= l2[i] * l1[i - 1] * d[i - 2];
+                }
+                l1[i] /= d[i - 1];
+                d[i] -= l1[i] * l1[i] * d[i - 1] + (i >= 2 ? l2[i] * l2[i] * d[i - 2] : 0);
+            }
+
+            // Forward, diagonal and backward substitution into the trend
+            std::vector<T> &trend = context.scratch<T>();
+            trend.assign(t.data, t.data + n * C);
+            for (int i = 1; i < n; i++) {
+                for (int c = 0; c < C; c++) {
+                    trend[i * C + c] -= l1[i] * trend[(i - 1) * C + c] + (i >= 2 ? l2[i] * trend[(i - 2) * C + c] : 0);
+                }
+            }
+            for (int i = 0; i < n; i++) {
+                for (int c = 0; c < C; c++) {
+                    trend[i * C + c] /= d[i];
+                }
+            }
+            for (int i = n - 2; i >= 0; i--) {
+                for (int c = 0; c < C; c++) {
+                    trend[i * C + c] -= l1[i + 1] * trend[(i + 1) * C + c] + (i + 2 < n ? l2[i + 2] * trend[(i + 2) * C + c] : 0);
+                }
+            }
+
+            for (int i = 0; i < n * C; i++) {
+                t.data[i] -= trend[i];
+            }
+        }
+    };
+
+    // Repeated box filter along the samples as movingAverage, borders reflected as by cv::blur
+    template <int C, typename T>
+    struct MovingAverage {
+        static void apply(Trace<C, T> &t, Context &context) {
+
+            const int n = t.rows;
+            const int s = context.window;
+            const int anchor = s / 2;
+            if (n < 2) {
+                return;
+            }
+
+            std::vector<T> &source = context.scratch<T>();
+            for (int pass = 0; pass < context.passes; pass++) {
+                source.assign(t.data, t.data + n * C);
+                for (int i = 0; i < n; i++) {
+                    T sum[C] = {0};
+                    for (int k = i - anchor; k < i - anchor + s; k++) {
+                        int j = k < 0 ? -k : k;
+                        j = j >= n ? 2 * n - 2 - j : j;
+                        for (int c = 0; c < C; c++) {
+                            sum[c] += source[j * C + c];
+                        }
+                    }
+                    for (int c = 0; c < C; c++) {
+                        t.row(i)[c] = sum[c] / s;
+                    }
+                }
+            }
+        }
+    };
+
+    template <>
+    struct Normalize<1, float> {
+        static void apply(Trace<1, float> &t, Context &context) {
+            normalizeSamples(t.data, t.rows);
+        }
+    };
+
+    template <>
+    struct MovingAverage<1, float> {
+        static void apply(Trace<1, float> &t, Context &context) {
+
+            const int n = t.rows;
+            const int s = context.window;
+            const int anchor = s / 2;
+            if (n < 2) {
+                return;
+            }
+
+            std::vector<float> &padded = context.scratch<float>();
+            padded.resize(n + s - 1);
+            for (int pass = 0; pass < context.passes; pass++) {
+                for (int k = 0; k < n + s - 1; k++) {
+                    int j = k < anchor ? anchor - k : k - anchor;
+                    j = j >= n ? 2 * n - 2 - j : j;
+                    padded[k] = t.data[j];
+                }
+                boxFilterSamples(&padded[0], t.data, n, s);
+            }
+        }
+    };
+
+    // The stages in order
+    template <int C, typename T, template <int, typename> class... Stages>
+    struct Pipeline;
+
+    template <int C, typename T>
+    struct Pipeline<C, T> {
+        static void run(Trace<C, T> &, Context &) {;}
+    };
+
+    template <int C, typename T, template <int, typename> class Stage, template <int, typename> class... Stages>
+    struct Pipeline<C, T, Stage, Stages...> {
+        static void run(Trace<C, T> &t, Context &context) {
+            Stage<C, T>::apply(t, context);
+            if (context.history) {
+                context.history->insert(context.history->end(), t.data, t.data + t.rows * C);
+            }
+            Pipeline<C, T, Stages...>::run(t, context);
+        }
+    };
+}
+
+#endif /* pipeline_hpp */
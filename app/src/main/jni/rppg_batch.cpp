@@ -0,0 +1,101 @@
+//
+//  rppg_batch.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+//  Command line tool for re-analysing recordings on a server, not part of the app.
+//  Build on the host against OpenCV 3 and FFmpeg 2.x, e.g.
+//
+//    g++ -std=c++11 -O2 -pthread rppg_batch.cpp BatchEngine.cpp WorkStealingPool.cpp \
+//        RPPG.cpp ThreadPool.cpp FrameHistory.cpp CascadeRegistry.cpp HaarCascade.cpp opencv.cpp \
+//        similarity.cpp skin.cpp signal.cpp ChirpZ.cpp RunningStatistics.cpp Welch.cpp FFmpegDecoder.cpp yuv.cpp \
+//        -o rppg_batch \
+//        `pkg-config --cflags --libs opencv libavformat libavcodec libswscale libavutil`
+//
+//  Usage: rppg_batch [-a algorithm] [-c compare algorithms] [-s segment seconds] [-t threads] [-e eye cascade.xml] [-g grid size] [-f spectrum] [-w welch seconds] [-p single precision] cascade.xml file...
+//  Results of each file are written to <file>.bpm.csv
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "BatchEngine.hpp"
+
+#define SAMPLING_FREQUENCY 1
+#define RESCAN_FREQUENCY 0.2
+#define MIN_TRACKING_CONFIDENCE 0.5
+#define MIN_SIGNAL_SIZE 2
+#define MAX_SIGNAL_SIZE 6
+#define MIN_SIGNAL_QUALITY 0
+#define SPECTRUM 2           // chirpz
+#define SPECTRAL_ZOOM 4
+#define COMPARE_ALGORITHMS false
+#define SINGLE_PRECISION false
+#define MOTION_COMPENSATION true
+#define SKIN_DETECTION true
+#define SEGMENT_LENGTH 60
+#define POOL_SIZE 8
+
+static const double QUANTILES[] = {0.25, 0.75};
+
+int main(int argc, char **argv) {
+
+    int algorithm = 0;
+    bool compareAlgorithms = COMPARE_ALGORITHMS;
+    int segmentLength = SEGMENT_LENGTH;
+    int threads = 0;
+    const char *eyeClassifierPath = "";
+    int gridSize = 0;
+    int spectrum = SPECTRUM;
+    int welchLength = 0;
+    bool singlePrecision = SINGLE_PRECISION;
+
+    int i = 1;
+    for (; i + 1 < argc && argv[i][0] == '-'; i += 2) {
+        if (!strcmp(argv[i], "-a")) {
+            algorithm = atoi(argv[i + 1]);
+        } else if (!strcmp(argv[i], "-c")) {
+            compareAlgorithms = atoi(argv[i + 1]) != 0;
+        } else if (!strcmp(argv[i], "-s")) {
+            segmentLength = atoi(argv[i + 1]);
+        } else if (!strcmp(argv[i], "-t")) {
+            threads = atoi(argv[i + 1]);
+        } else if (!strcmp(argv[i], "-e")) {
+            eyeClassifierPath = argv[i + 1];
+        } else if (!strcmp(argv[i], "-g")) {
+            gridSize = atoi(argv[i + 1]);
+        } else if (!strcmp(argv[i], "-f")) {
+            spectrum = atoi(argv[i + 1]);
+        } else if (!strcmp(argv[i], "-w")) {
+            welchLength = atoi(argv[i + 1]);
+        } else if (!strcmp(argv[i], "-p")) {
+            singlePrecision = atoi(argv[i + 1]) != 0;
+        } else {
+            break;
+        }
+    }
+
+    if (argc - i < 2) {
+        fprintf(stderr, "Usage: %s [-a algorithm] [-c compare algorithms] [-s segment seconds] [-t threads] [-e eye cascade.xml] [-g grid size] [-f spectrum] [-w welch seconds] [-p single precision] cascade.xml file...\n", argv[0]);
+        return 2;
+    }
+
+    const std::vector<double> quantiles(QUANTILES, QUANTILES + sizeof(QUANTILES) / sizeof(QUANTILES[0]));
+    BatchEngine engine(algorithm, compareAlgorithms, SAMPLING_FREQUENCY, RESCAN_FREQUENCY, MIN_TRACKING_CONFIDENCE,
+                       MIN_SIGNAL_SIZE, MAX_SIGNAL_SIZE, MIN_SIGNAL_QUALITY, spectrum, SPECTRAL_ZOOM, welchLength, quantiles,
+                       singlePrecision, MOTION_COMPENSATION, gridSize, SKIN_DETECTION,
+                       argv[i], eyeClassifierPath, segmentLength, threads, POOL_SIZE);
+    for (int j = i + 1; j < argc; j++) {
+        engine.addFile(argv[j], std::string(argv[j]) + ".bpm.csv");
+    }
+
+    bool ok = engine.run();
+
+    double fps = engine.getElapsed() > 0 ? engine.getFrameCount() / engine.getElapsed() : 0;
+    printf("frames=%lld seconds=%.2f threads=%d fps=%.1f fps_per_core=%.1f\n",
+           (long long)engine.getFrameCount(), engine.getElapsed(), engine.getThreads(), fps, fps / engine.getThreads());
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,317 @@
+//
+//  signal.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#include "signal.hpp"
+
+#include <math.h>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(HAVE_AVX)
+#include <immintrin.h>
+#endif
+
+/* SCALAR */
+
+void normalizeSamples_c(float *x, int n) {
+
+    // Sum about the first sample, which keeps the precision of traces far from zero
+    const float origin = x[0];
+    float sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += x[i] - origin;
+    }
+    const float mean = origin + sum / n;
+
+    float sumSq = 0;
+    for (int i = 0; i < n; i++) {
+        sumSq += (x[i] - mean) * (x[i] - mean);
+    }
+    const float scale = 1 / sqrtf(sumSq / n);
+
+    for (int i = 0; i < n; i++) {
+        x[i] = (x[i] - mean) * scale;
+    }
+}
+
+void boxFilterSamples_c(const float *padded, float *dst, int x, int n, int window) {
+    const float scale = 1.0f / window;
+    for (; x < n; x++) {
+        float sum = 0;
+        for (int k = 0; k < window; k++) {
+            sum += padded[x + k];
+        }
+        dst[x] = sum * scale;
+    }
+}
+
+void bandMagnitudes_c(const float *x, int n, const float *cw, const float *sw,
+                      float *magnitude, int j, int bins) {
+    for (; j < bins; j++) {
+        float re = 0, im = 0, pr = 1, pi = 0;
+        for (int i = 0; i < n; i++) {
+            re += x[i] * pr;
+            im += x[i] * pi;
+            const float t = pr * cw[j] - pi * sw[j];
+            pi = pr * sw[j] + pi * cw[j];
+            pr = t;
+        }
+        magnitude[j] = sqrtf(re * re + im * im);
+    }
+}
+
+/* SSE2 */
+
+#if defined(__SSE2__)
+
+static inline float horizontalSum_sse2(__m128 a) {
+    __m128 b = _mm_add_ps(a, _mm_movehl_ps(a, a));
+    b = _mm_add_ss(b, _mm_shuffle_ps(b, b, 1));
+    return _mm_cvtss_f32(b);
+}
+
+void normalizeSamples_sse2(float *x, int n) {
+
+    int i;
+    const float origin = x[0];
+    const __m128 o = _mm_set1_ps(origin);
+    __m128 acc = _mm_setzero_ps();
+    for (i = 0; i + 4 <= n; i += 4) {
+        acc = _mm_add_ps(acc, _mm_sub_ps(_mm_loadu_ps(x + i), o));
+    }
+    float sum = horizontalSum_sse2(acc);
+    for (; i < n; i++) {
+        sum += x[i] - origin;
+    }
+    const float mean = origin + sum / n;
+    const __m128 m = _mm_set1_ps(mean);
+
+    acc = _mm_setzero_ps();
+    for (i = 0; i + 4 <= n; i += 4) {
+        __m128 d = _mm_sub_ps(_mm_loadu_ps(x + i), m);
+        acc = _mm_add_ps(acc, _mm_mul_ps(d, d));
+    }
+    float sumSq = horizontalSum_sse2(acc);
+    for (; i < n; i++) {
+        sumSq += (x[i] - mean) * (x[i] - mean);
+    }
+    const float scale = 1 / sqrtf(sumSq / n);
+    const __m128 s = _mm_set1_ps(scale);
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(x + i, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(x + i), m), s));
+    }
+    for (; i < n; i++) {
+        x[i] = (x[i] - mean) * scale;
+    }
+}
+
+void boxFilterSamples_sse2(const float *padded, float *dst, int x, int n, int window) {
+
+    const __m128 scale = _mm_set1_ps(1.0f / window);
+
+    // Four outputs per iteration
+    for (; x + 4 <= n; x += 4) {
+        __m128 sum = _mm_setzero_ps();
+        for (int k = 0; k < window; k++) {
+            sum = _mm_add_ps(sum, _mm_loadu_ps(padded + x + k));
+        }
+        _mm_storeu_ps(dst + x, _mm_mul_ps(sum, scale));
+    }
+
+    boxFilterSamples_c(padded, dst, x, n, window);
+}
+
+void bandMagnitudes_sse2(const float *x, int n, const float *cw, const float *sw,
+                         float *magnitude, int j, int bins) {
+
+    // Four frequencies per iteration
+    for (; j + 4 <= bins; j += 4) {
+        const __m128 c = _mm_loadu_ps(cw + j);
+        const __m128 s = _mm_loadu_ps(sw + j);
+        __m128 re = _mm_setzero_ps(), im = _mm_setzero_ps();
+        __m128 pr = _mm_set1_ps(1), pi = _mm_setzero_ps();
+        for (int i = 0; i < n; i++) {
+            const __m128 v = _mm_set1_ps(x[i]);
+            re = _mm_add_ps(re, _mm_mul_ps(v, pr));
+            im = _mm_add_ps(im, _mm_mul_ps(v, pi));
+            const __m128 t = _mm_sub_ps(_mm_mul_ps(pr, c), _mm_mul_ps(pi, s));
+            pi = _mm_add_ps(_mm_mul_ps(pr, s), _mm_mul_ps(pi, c));
+            pr = t;
+        }
+        _mm_storeu_ps(magnitude + j, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im))));
+    }
+
+    bandMagnitudes_c(x, n, cw, sw, magnitude, j, bins);
+}
+
+#endif
+
+/* AVX */
+
+#if defined(HAVE_AVX)
+
+static inline TARGET_AVX float horizontalSum_avx(__m256 a) {
+    return horizontalSum_sse2(_mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1)));
+}
+
+TARGET_AVX void normalizeSamples_avx(float *x, int n) {
+
+    int i;
+    const float origin = x[0];
+    const __m256 o = _mm256_set1_ps(origin);
+    __m256 acc = _mm256_setzero_ps();
+    for (i = 0; i + 8 <= n; i += 8) {
+        acc = _mm256_add_ps(acc, _mm256_sub_ps(_mm256_loadu_ps(x + i), o));
+    }
+    float sum = horizontalSum_avx(acc);
+    for (; i < n; i++) {
+        sum += x[i] - origin;
+    }
+    const float mean = origin + sum / n;
+    const __m256 m = _mm256_set1_ps(mean);
+
+    acc = _mm256_setzero_ps();
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m256 d = _mm256_sub_ps(_mm256_loadu_ps(x + i), m);
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(d, d));
+    }
+    float sumSq = horizontalSum_avx(acc);
+    for (; i < n; i++) {
+        sumSq += (x[i] - mean) * (x[i] - mean);
+    }
+    const float scale = 1 / sqrtf(sumSq / n);
+    const __m256 s = _mm256_set1_ps(scale);
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(x + i, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(x + i), m), s));
+    }
+    for (; i < n; i++) {
+        x[i] = (x[i] - mean) * scale;
+    }
+}
+
+TARGET_AVX void boxFilterSamples_avx(const float *padded, float *dst, int x, int n, int window) {
+
+    const __m256 scale = _mm256_set1_ps(1.0f / window);
+
+    // Eight outputs per iteration
+    for (; x + 8 <= n; x += 8) {
+        __m256 sum = _mm256_setzero_ps();
+        for (int k = 0; k < window; k++) {
+            sum = _mm256_add_ps(sum, _mm256_loadu_ps(padded + x + k));
+        }
+        _mm256_storeu_ps(dst + x, _mm256_mul_ps(sum, scale));
+    }
+
+    boxFilterSamples_sse2(padded, dst, x, n, window);
+}
+
+TARGET_AVX void bandMagnitudes_avx(const float *x, int n, const float *cw, const float *sw,
+                                   float *magnitude, int j, int bins) {
+
+    // Eight frequencies per iteration
+    for (; j + 8 <= bins; j += 8) {
+        const __m256 c = _mm256_loadu_ps(cw + j);
+        const __m256 s = _mm256_loadu_ps(sw + j);
+        __m256 re = _mm256_setzero_ps(), im = _mm256_setzero_ps();
+        __m256 pr = _mm256_set1_ps(1), pi = _mm256_setzero_ps();
+        for (int i = 0; i < n; i++) {
+            const __m256 v = _mm256_set1_ps(x[i]);
+            re = _mm256_add_ps(re, _mm256_mul_ps(v, pr));
+            im = _mm256_add_ps(im, _mm256_mul_ps(v, pi));
+            const __m256 t = _mm256_sub_ps(_mm256_mul_ps(pr, c), _mm256_mul_ps(pi, s));
+            pi = _mm256_add_ps(_mm256_mul_ps(pr, s), _mm256_mul_ps(pi, c));
+            pr = t;
+        }
+        _mm256_storeu_ps(magnitude + j, _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(re, re), _mm256_mul_ps(im, im))));
+    }
+
+    bandMagnitudes_sse2(x, n, cw, sw, magnitude, j, bins);
+}
+
+#endif
+
+/* DISPATCH */
+
+static NormalizeSamples selectNormalizeSamples() {
+#if defined(HAVE_NEON)
+    if (hasNeon()) {
+        return normalizeSamples_neon;
+    }
+#elif defined(__SSE2__)
+#if defined(HAVE_AVX)
+    if (hasAvx()) {
+        return normalizeSamples_avx;
+    }
+#endif
+    return normalizeSamples_sse2;
+#endif
+    return normalizeSamples_c;
+}
+
+static BoxFilterSamples selectBoxFilterSamples() {
+#if defined(HAVE_NEON)
+    if (hasNeon()) {
+        return boxFilterSamples_neon;
+    }
+#elif defined(__SSE2__)
+#if defined(HAVE_AVX)
+    if (hasAvx()) {
+        return boxFilterSamples_avx;
+    }
+#endif
+    return boxFilterSamples_sse2;
+#endif
+    return boxFilterSamples_c;
+}
+
+static BandMagnitudes selectBandMagnitudes() {
+#if defined(HAVE_NEON)
+    if (hasNeon()) {
+        return bandMagnitudes_neon;
+    }
+#elif defined(__SSE2__)
+#if defined(HAVE_AVX)
+    if (hasAvx()) {
+        return bandMagnitudes_avx;
+    }
+#endif
+    return bandMagnitudes_sse2;
+#endif
+    return bandMagnitudes_c;
+}
+
+void normalizeSamples(float *x, int n) {
+    static const NormalizeSamples kernel = selectNormalizeSamples();
+    if (n > 0) {
+        kernel(x, n);
+    }
+}
+
+void boxFilterSamples(const float *padded, float *dst, int n, int window) {
+    static const BoxFilterSamples kernel = selectBoxFilterSamples();
+    kernel(padded, dst, 0, n, window);
+}
+
+void bandMagnitudes(const float *x, int n, int low, int zoom, int bins, float *magnitude) {
+
+    static const BandMagnitudes kernel = selectBandMagnitudes();
+
+    // Phasor steps from the exact angles, so only the rotation itself is rounded to float
+    std::vector<float> cw(bins), sw(bins);
+    for (int j = 0; j < bins; j++) {
+        const double w = -2 * M_PI * (low + (double)j / zoom) / n;
+        cw[j] = (float)cos(w);
+        sw[j] = (float)sin(w);
+    }
+
+    kernel(x, n, &cw[0], &sw[0], magnitude, 0, bins);
+}
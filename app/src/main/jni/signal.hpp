@@ -0,0 +1,71 @@
+//
+//  signal.hpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#ifndef signal_hpp
+#define signal_hpp
+
+#include "cpu.hpp"
+
+/* SINGLE PRECISION SIGNAL */
+
+// Zero mean and unit variance of n samples in place, as normalization
+void normalizeSamples(float *x, int n);
+
+// Box filter of n samples over window. padded holds the samples with window / 2 before and
+// window - 1 - window / 2 after them, reflected as by cv::blur.
+void boxFilterSamples(const float *padded, float *dst, int n, int window);
+
+// Magnitudes of the DFT of n samples at bins frequencies low + j / zoom in DFT bins, as zoomSpectrum
+void bandMagnitudes(const float *x, int n, int low, int zoom, int bins, float *magnitude);
+
+/* KERNELS */
+
+// Variants differ from the scalar reference only in the order of float additions.
+typedef void (*NormalizeSamples)(float *x, int n);
+
+void normalizeSamples_c(float *x, int n);
+
+// Box filter from output x to n
+typedef void (*BoxFilterSamples)(const float *padded, float *dst, int x, int n, int window);
+
+void boxFilterSamples_c(const float *padded, float *dst, int x, int n, int window);
+
+// Magnitudes from frequency j to bins, each advancing its phasor by (cw[j], sw[j]) per sample
+typedef void (*BandMagnitudes)(const float *x, int n, const float *cw, const float *sw,
+                               float *magnitude, int j, int bins);
+
+void bandMagnitudes_c(const float *x, int n, const float *cw, const float *sw,
+                      float *magnitude, int j, int bins);
+
+#if defined(__SSE2__)
+void normalizeSamples_sse2(float *x, int n);
+
+void boxFilterSamples_sse2(const float *padded, float *dst, int x, int n, int window);
+
+void bandMagnitudes_sse2(const float *x, int n, const float *cw, const float *sw,
+                         float *magnitude, int j, int bins);
+#endif
+
+#if defined(HAVE_AVX)
+void normalizeSamples_avx(float *x, int n);
+
+void boxFilterSamples_avx(const float *padded, float *dst, int x, int n, int window);
+
+void bandMagnitudes_avx(const float *x, int n, const float *cw, const float *sw,
+                        float *magnitude, int j, int bins);
+#endif
+
+#if defined(HAVE_NEON)
+void normalizeSamples_neon(float *x, int n);
+
+void boxFilterSamples_neon(const float *padded, float *dst, int x, int n, int window);
+
+void bandMagnitudes_neon(const float *x, int n, const float *cw, const float *sw,
+                         float *magnitude, int j, int bins);
+#endif
+
+#endif /* signal_hpp */
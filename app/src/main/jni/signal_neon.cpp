@@ -0,0 +1,97 @@
+//
+//  signal_neon.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+//  Compiled with NEON enabled; only called after a runtime feature check.
+//
+
+#include "signal.hpp"
+
+#include <arm_neon.h>
+#include <math.h>
+
+static inline float horizontalSum_neon(float32x4_t a) {
+    float32x2_t b = vadd_f32(vget_low_f32(a), vget_high_f32(a));
+    return vget_lane_f32(vpadd_f32(b, b), 0);
+}
+
+void normalizeSamples_neon(float *x, int n) {
+
+    int i;
+    const float origin = x[0];
+    const float32x4_t o = vdupq_n_f32(origin);
+    float32x4_t acc = vdupq_n_f32(0);
+    for (i = 0; i + 4 <= n; i += 4) {
+        acc = vaddq_f32(acc, vsubq_f32(vld1q_f32(x + i), o));
+    }
+    float sum = horizontalSum_neon(acc);
+    for (; i < n; i++) {
+        sum += x[i] - origin;
+    }
+    const float mean = origin + sum / n;
+    const float32x4_t m = vdupq_n_f32(mean);
+
+    acc = vdupq_n_f32(0);
+    for (i = 0; i + 4 <= n; i += 4) {
+        float32x4_t d = vsubq_f32(vld1q_f32(x + i), m);
+        acc = vmlaq_f32(acc, d, d);
+    }
+    float sumSq = horizontalSum_neon(acc);
+    for (; i < n; i++) {
+        sumSq += (x[i] - mean) * (x[i] - mean);
+    }
+    const float scale = 1 / sqrtf(sumSq / n);
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        vst1q_f32(x + i, vmulq_n_f32(vsubq_f32(vld1q_f32(x + i), m), scale));
+    }
+    for (; i < n; i++) {
+        x[i] = (x[i] - mean) * scale;
+    }
+}
+
+void boxFilterSamples_neon(const float *padded, float *dst, int x, int n, int window) {
+
+    const float scale = 1.0f / window;
+
+    // Four outputs per iteration
+    for (; x + 4 <= n; x += 4) {
+        float32x4_t sum = vdupq_n_f32(0);
+        for (int k = 0; k < window; k++) {
+            sum = vaddq_f32(sum, vld1q_f32(padded + x + k));
+        }
+        vst1q_f32(dst + x, vmulq_n_f32(sum, scale));
+    }
+
+    boxFilterSamples_c(padded, dst, x, n, window);
+}
+
+void bandMagnitudes_neon(const float *x, int n, const float *cw, const float *sw,
+                         float *magnitude, int j, int bins) {
+
+    // Four frequencies per iteration
+    for (; j + 4 <= bins; j += 4) {
+        const float32x4_t c = vld1q_f32(cw + j);
+        const float32x4_t s = vld1q_f32(sw + j);
+        float32x4_t re = vdupq_n_f32(0), im = vdupq_n_f32(0);
+        float32x4_t pr = vdupq_n_f32(1), pi = vdupq_n_f32(0);
+        for (int i = 0; i < n; i++) {
+            re = vmlaq_n_f32(re, pr, x[i]);
+            im = vmlaq_n_f32(im, pi, x[i]);
+            const float32x4_t t = vmlsq_f32(vmulq_f32(pr, c), pi, s);
+            pi = vmlaq_f32(vmulq_f32(pr, s), pi, c);
+            pr = t;
+        }
+
+        // No vector square root on armeabi-v7a
+        float power[4];
+        vst1q_f32(power, vmlaq_f32(vmulq_f32(re, re), im, im));
+        for (int k = 0; k < 4; k++) {
+            magnitude[j + k] = sqrtf(power[k]);
+        }
+    }
+
+    bandMagnitudes_c(x, n, cw, sw, magnitude, j, bins);
+}
@@ -0,0 +1,107 @@
+//
+//  similarity.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#include "similarity.hpp"
+
+#include <algorithm>
+
+#define MIN_SPREAD 1e-6         /* weighted squared distance of src from its centroid */
+#define TUKEY_C 4.685           /* biweight cutoff in robust standard deviations */
+#define MAD_SIGMA 1.4826        /* median absolute residual to standard deviation */
+#define MIN_SIGMA 0.1           /* px, residuals below this are never outliers */
+#define ROBUST_ITERATIONS 3
+
+using namespace cv;
+using namespace std;
+
+// Weighted least squares solution, false if degenerate
+static bool fit(const vector<Point2f> &src, const vector<Point2f> &dst, const vector<double> &w,
+                Similarity &result) {
+
+    // Centroids
+    double sw = 0, px = 0, py = 0, qx = 0, qy = 0;
+    for (size_t i = 0; i < src.size(); i++) {
+        sw += w[i];
+        px += w[i] * src[i].x;
+        py += w[i] * src[i].y;
+        qx += w[i] * dst[i].x;
+        qy += w[i] * dst[i].y;
+    }
+    if (sw <= 0) {
+        return false;
+    }
+    px /= sw; py /= sw; qx /= sw; qy /= sw;
+
+    // a and b from the centred points
+    double d = 0, sa = 0, sb = 0;
+    for (size_t i = 0; i < src.size(); i++) {
+        const double ux = src[i].x - px, uy = src[i].y - py;
+        const double vx = dst[i].x - qx, vy = dst[i].y - qy;
+        d += w[i] * (ux * ux + uy * uy);
+        sa += w[i] * (ux * vx + uy * vy);
+        sb += w[i] * (ux * vy - uy * vx);
+    }
+    if (d < MIN_SPREAD) {
+        return false;
+    }
+
+    result.a = sa / d;
+    result.b = sb / d;
+    result.tx = qx - (result.a * px - result.b * py);
+    result.ty = qy - (result.b * px + result.a * py);
+    return true;
+}
+
+bool estimateSimilarity(const vector<Point2f> &src, const vector<Point2f> &dst, Similarity &result) {
+
+    CV_Assert(src.size() == dst.size());
+    const size_t n = src.size();
+
+    // Plain least squares, which also tells whether the points determine a transform
+    vector<double> w(n, 1.0);
+    Similarity t;
+    if (n < 2 || !fit(src, dst, w, t)) {
+        return false;
+    }
+    result = t;
+
+    // Reweighting starts from the median displacement, which unlike the least squares
+    // solution is not pulled by outliers. Between frames, motion is mostly translation.
+    vector<double> residuals(n), sorted(n);
+    for (size_t i = 0; i < n; i++) {
+        sorted[i] = dst[i].x - src[i].x;
+    }
+    nth_element(sorted.begin(), sorted.begin() + n / 2, sorted.end());
+    t = Similarity();
+    t.tx = sorted[n / 2];
+    for (size_t i = 0; i < n; i++) {
+        sorted[i] = dst[i].y - src[i].y;
+    }
+    nth_element(sorted.begin(), sorted.begin() + n / 2, sorted.end());
+    t.ty = sorted[n / 2];
+
+    // Iteratively reweighted with the robust scale of the current residuals
+    for (int iteration = 0; iteration < ROBUST_ITERATIONS; iteration++) {
+        for (size_t i = 0; i < n; i++) {
+            const Point2f r = dst[i] - t.apply(src[i]);
+            residuals[i] = sqrt((double)r.x * r.x + (double)r.y * r.y);
+        }
+        sorted = residuals;
+        nth_element(sorted.begin(), sorted.begin() + n / 2, sorted.end());
+        const double c = TUKEY_C * max(MAD_SIGMA * sorted[n / 2], MIN_SIGMA);
+        for (size_t i = 0; i < n; i++) {
+            const double u = residuals[i] / c;
+            w[i] = u < 1 ? (1 - u * u) * (1 - u * u) : 0;
+        }
+        // Too little support left: keep the last solution
+        if (!fit(src, dst, w, t)) {
+            break;
+        }
+        result = t;
+    }
+    return true;
+}
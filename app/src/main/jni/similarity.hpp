@@ -0,0 +1,43 @@
+//
+//  similarity.hpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#ifndef similarity_hpp
+#define similarity_hpp
+
+#include <math.h>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+// 2D similarity transform x' = a·x - b·y + tx, y' = b·x + a·y + ty,
+// i.e. a rotation and uniform scale followed by a translation.
+struct Similarity {
+
+    double a, b, tx, ty;
+
+    // Identity
+    Similarity() : a(1), b(0), tx(0), ty(0) {;}
+
+    double scale() const { return sqrt(a * a + b * b); }
+    double rotation() const { return atan2(b, a); }    // Radians
+
+    cv::Point2f apply(const cv::Point2f &p) const {
+        return cv::Point2f((float)(a * p.x - b * p.y + tx), (float)(b * p.x + a * p.y + ty));
+    }
+
+    // Rectangle spanned by the transformed corners tl and br
+    cv::Rect apply(const cv::Rect &r) const {
+        return cv::Rect(apply(cv::Point2f(r.tl())), apply(cv::Point2f(r.br())));
+    }
+};
+
+// Least-squares similarity mapping src onto dst in closed form, followed by a few passes
+// reweighted with Tukey's biweight on the residuals to suppress outliers.
+// Returns false if the points do not determine a transform (fewer than two distinct points).
+bool estimateSimilarity(const std::vector<cv::Point2f> &src, const std::vector<cv::Point2f> &dst,
+                        Similarity &result);
+
+#endif /* similarity_hpp */
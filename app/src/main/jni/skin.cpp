@@ -0,0 +1,272 @@
+//
+//  skin.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#include "skin.hpp"
+
+#include <math.h>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "cpu.hpp"
+
+// Skin cluster in full range Cb/Cr as an ellipse: centre, half axes and rotation
+#define SKIN_CB 113.0
+#define SKIN_CR 155.6
+#define SKIN_AXIS_1 23.4
+#define SKIN_AXIS_2 15.2
+#define SKIN_ANGLE 43.0         // Degrees
+
+/* CLASSIFIER */
+
+struct SkinChromaTable {
+
+    uint8_t table[256 * 256];
+
+    SkinChromaTable() {
+        const double angle = SKIN_ANGLE * M_PI / 180;
+        for (int v = 0; v < 256; v++) {
+            for (int u = 0; u < 256; u++) {
+                // Camera frames are limited range, the cluster is given in full range
+                const double cb = 128 + (u - 128) * 255.0 / 224 - SKIN_CB;
+                const double cr = 128 + (v - 128) * 255.0 / 224 - SKIN_CR;
+                const double a = (cb * cos(angle) + cr * sin(angle)) / SKIN_AXIS_1;
+                const double b = (-cb * sin(angle) + cr * cos(angle)) / SKIN_AXIS_2;
+                table[v * 256 + u] = a * a + b * b <= 1 ? 0xFF : 0;
+            }
+        }
+    }
+};
+
+const uint8_t *skinChromaTable() {
+    static const SkinChromaTable skin;
+    return skin.table;
+}
+
+/* SCALAR REFERENCE */
+
+// 8-bit fixed point BT.601 as in yuv.cpp, so that both frame formats are classified alike
+static inline int rgbToY(int r, int g, int b) {
+    return ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+}
+
+static inline int rgbToU(int r, int g, int b) {
+    return ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+}
+
+static inline int rgbToV(int r, int g, int b) {
+    return ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+}
+
+static inline bool skinLuma(int y) {
+    return y >= SKIN_MIN_LUMA && y <= SKIN_MAX_LUMA;
+}
+
+void skinSumsRowNV21_c(const uint8_t *luma, const uint8_t *vu, const uint8_t *skin,
+                       int x, int width, SkinSums &sums) {
+    for (; x < width; x++) {
+        const int c = x >> 1;
+        if (skin[c] && skinLuma(luma[x])) {
+            sums.sum[0] += luma[x];
+            sums.sum[1] += vu[2 * c];
+            sums.sum[2] += vu[2 * c + 1];
+            sums.count++;
+        }
+    }
+}
+
+void skinSumsRowRGBA_c(const uint8_t *rgba, const uint8_t *table, int x, int width, SkinSums &sums) {
+    for (const uint8_t *p = rgba + 4 * x; x < width; x++, p += 4) {
+        if (skinLuma(rgbToY(p[0], p[1], p[2])) &&
+            table[rgbToV(p[0], p[1], p[2]) * 256 + rgbToU(p[0], p[1], p[2])]) {
+            sums.sum[0] += p[0];
+            sums.sum[1] += p[1];
+            sums.sum[2] += p[2];
+            sums.count++;
+        }
+    }
+}
+
+/* SSE2 */
+
+#if defined(__SSE2__)
+
+static inline uint64_t sum64_sse2(__m128i a) {
+    uint64_t s[2];
+    _mm_storeu_si128((__m128i *)s, a);
+    return s[0] + s[1];
+}
+
+void skinSumsRowNV21_sse2(const uint8_t *luma, const uint8_t *vu, const uint8_t *skin,
+                          int x, int width, SkinSums &sums) {
+
+    // Vectors start on a VU pair
+    if ((x & 1) && x < width) {
+        skinSumsRowNV21_c(luma, vu, skin, x, x + 1, sums);
+        x++;
+    }
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i low = _mm_set1_epi16(0x00FF);
+    const __m128i minLuma = _mm_set1_epi8((char)SKIN_MIN_LUMA);
+    const __m128i maxLuma = _mm_set1_epi8((char)SKIN_MAX_LUMA);
+    __m128i y = zero, v = zero, u = zero, count = zero;
+
+    // 16 pixels and their 8 VU pairs per iteration
+    for (; x + 16 <= width; x += 16) {
+
+        __m128i l = _mm_loadu_si128((const __m128i *)(luma + x));
+        __m128i s = _mm_loadl_epi64((const __m128i *)(skin + (x >> 1)));
+        __m128i c = _mm_loadu_si128((const __m128i *)(vu + x));
+
+        // Skin pixels: chroma class of the pair, luma within range
+        __m128i m = _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8(l, minLuma), l),
+                                  _mm_cmpeq_epi8(_mm_min_epu8(l, maxLuma), l));
+        m = _mm_and_si128(m, _mm_unpacklo_epi8(s, s));
+
+        y = _mm_add_epi64(y, _mm_sad_epu8(_mm_and_si128(l, m), zero));
+        count = _mm_add_epi64(count, _mm_sad_epu8(_mm_and_si128(m, one), zero));
+
+        // Each pair counts once for each of its two pixels that is skin
+        __m128i c0 = _mm_and_si128(c, m);
+        __m128i c1 = _mm_and_si128(c, _mm_or_si128(_mm_slli_epi16(m, 8), _mm_srli_epi16(m, 8)));
+        v = _mm_add_epi64(v, _mm_add_epi64(_mm_sad_epu8(_mm_and_si128(c0, low), zero),
+                                           _mm_sad_epu8(_mm_and_si128(c1, low), zero)));
+        u = _mm_add_epi64(u, _mm_add_epi64(_mm_sad_epu8(_mm_srli_epi16(c0, 8), zero),
+                                           _mm_sad_epu8(_mm_srli_epi16(c1, 8), zero)));
+    }
+
+    sums.sum[0] += sum64_sse2(y);
+    sums.sum[1] += sum64_sse2(v);
+    sums.sum[2] += sum64_sse2(u);
+    sums.count += sum64_sse2(count);
+
+    skinSumsRowNV21_c(luma, vu, skin, x, width, sums);
+}
+
+static inline uint64_t sum32_sse2(__m128i a) {
+    uint32_t s[4];
+    _mm_storeu_si128((__m128i *)s, a);
+    return (uint64_t)s[0] + s[1] + s[2] + s[3];
+}
+
+// Weighted sum of r, g and b in 16-bit lanes as in rgbToY/U/V before the shift
+static inline __m128i dot3_sse2(__m128i r, __m128i g, __m128i b, short kr, short kg, short kb) {
+    return _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(kr)), _mm_mullo_epi16(g, _mm_set1_epi16(kg))),
+                         _mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(kb)), _mm_set1_epi16(128)));
+}
+
+void skinSumsRowRGBA_sse2(const uint8_t *rgba, const uint8_t *table, int x, int width, SkinSums &sums) {
+
+    const __m128i byte = _mm_set1_epi32(0xFF);
+    const __m128i ones = _mm_set1_epi16(1);
+    const __m128i offset = _mm_set1_epi16(128);
+    const __m128i minLuma = _mm_set1_epi16(SKIN_MIN_LUMA - 1);
+    const __m128i maxLuma = _mm_set1_epi16(SKIN_MAX_LUMA + 1);
+    __m128i rs = _mm_setzero_si128(), gs = rs, bs = rs, count = rs;
+    uint16_t index[8], skin[8];
+
+    // 8 pixels per iteration, 32-bit sums take two pixels per lane and iteration
+    for (; x + 8 <= width; x += 8) {
+
+        const __m128i p0 = _mm_loadu_si128((const __m128i *)(rgba + 4 * x));
+        const __m128i p1 = _mm_loadu_si128((const __m128i *)(rgba + 4 * x + 16));
+        const __m128i r = _mm_packs_epi32(_mm_and_si128(p0, byte), _mm_and_si128(p1, byte));
+        const __m128i g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 8), byte),
+                                          _mm_and_si128(_mm_srli_epi32(p1, 8), byte));
+        const __m128i b = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 16), byte),
+                                          _mm_and_si128(_mm_srli_epi32(p1, 16), byte));
+
+        // Luma fits 16 bits unsigned, chroma signed
+        const __m128i y = _mm_add_epi16(_mm_srli_epi16(dot3_sse2(r, g, b, 66, 129, 25), 8), _mm_set1_epi16(16));
+        const __m128i u = _mm_add_epi16(_mm_srai_epi16(dot3_sse2(r, g, b, -38, -74, 112), 8), offset);
+        const __m128i v = _mm_add_epi16(_mm_srai_epi16(dot3_sse2(r, g, b, 112, -94, -18), 8), offset);
+
+        // No gather in SSE2, the table is looked up per pixel
+        _mm_storeu_si128((__m128i *)index, _mm_or_si128(_mm_slli_epi16(v, 8), u));
+        for (int k = 0; k < 8; k++) {
+            skin[k] = table[index[k]] * 0x0101;
+        }
+        __m128i m = _mm_and_si128(_mm_cmpgt_epi16(y, minLuma), _mm_cmplt_epi16(y, maxLuma));
+        m = _mm_and_si128(m, _mm_loadu_si128((const __m128i *)skin));
+
+        rs = _mm_add_epi32(rs, _mm_madd_epi16(_mm_and_si128(r, m), ones));
+        gs = _mm_add_epi32(gs, _mm_madd_epi16(_mm_and_si128(g, m), ones));
+        bs = _mm_add_epi32(bs, _mm_madd_epi16(_mm_and_si128(b, m), ones));
+        count = _mm_add_epi32(count, _mm_madd_epi16(_mm_srli_epi16(m, 15), ones));
+    }
+
+    sums.sum[0] += sum32_sse2(rs);
+    sums.sum[1] += sum32_sse2(gs);
+    sums.sum[2] += sum32_sse2(bs);
+    sums.count += sum32_sse2(count);
+
+    skinSumsRowRGBA_c(rgba, table, x, width, sums);
+}
+
+#endif
+
+/* DISPATCH */
+
+static SkinSumsRowNV21 selectSkinSumsRowNV21() {
+#if defined(HAVE_NEON)
+    if (hasNeon()) {
+        return skinSumsRowNV21_neon;
+    }
+#elif defined(__SSE2__)
+    return skinSumsRowNV21_sse2;
+#endif
+    return skinSumsRowNV21_c;
+}
+
+static SkinSumsRowRGBA selectSkinSumsRowRGBA() {
+#if defined(HAVE_NEON)
+    if (hasNeon()) {
+        return skinSumsRowRGBA_neon;
+    }
+#elif defined(__SSE2__)
+    return skinSumsRowRGBA_sse2;
+#endif
+    return skinSumsRowRGBA_c;
+}
+
+void skinSumsNV21(const uint8_t *luma, int lumaStride, const uint8_t *vu, int vuStride,
+                  int x, int y, int width, int height, SkinSums &sums) {
+
+    static const SkinSumsRowNV21 row = selectSkinSumsRowNV21();
+    const uint8_t *table = skinChromaTable();
+
+    // Chroma classes of the pairs covering the rectangle, indexed by column / 2
+    const int first = x >> 1;
+    const int last = (x + width + 1) >> 1;
+    std::vector<uint8_t> skin(last + 8);
+
+    for (int j = y; j < y + height; j++) {
+        const uint8_t *pairs = vu + (j >> 1) * vuStride;
+        // Two luma rows share each chroma row
+        if (j == y || !(j & 1)) {
+            for (int c = first; c < last; c++) {
+                skin[c] = table[pairs[2 * c] * 256 + pairs[2 * c + 1]];
+            }
+        }
+        row(luma + j * lumaStride, pairs, skin.data(), x, x + width, sums);
+    }
+}
+
+void skinSumsRGBA(const uint8_t *rgba, int stride,
+                  int x, int y, int width, int height, SkinSums &sums) {
+
+    static const SkinSumsRowRGBA row = selectSkinSumsRowRGBA();
+    const uint8_t *table = skinChromaTable();
+
+    for (int j = y; j < y + height; j++) {
+        row(rgba + j * stride + 4 * x, table, 0, width, sums);
+    }
+}
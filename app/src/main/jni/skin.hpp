@@ -0,0 +1,76 @@
+//
+//  skin.hpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#ifndef skin_hpp
+#define skin_hpp
+
+#include <stdint.h>
+
+// Pixels outside this luma range are never skin: hair, eyebrows, glasses frames and shadows
+// are too dark, specular highlights too bright to carry the pulse.
+#define SKIN_MIN_LUMA 40
+#define SKIN_MAX_LUMA 230
+
+// Color sums over the skin pixels of a rectangle, in the color space of the frame.
+// For NV21 these are Y, V and U, each pixel counting the chroma of its 2x2 block.
+struct SkinSums {
+    uint64_t sum[3];
+    uint64_t count;
+};
+
+/* CLASSIFIER */
+
+// Skin chroma lookup table, 256 x 256 indexed by [V * 256 + U] in limited range BT.601.
+// 0xFF inside the elliptical skin cluster, built on first use.
+const uint8_t *skinChromaTable();
+
+// Accumulate the skin pixels of a width x height rectangle at (x, y) of an NV21 frame
+// given by its Y plane and interleaved VU plane.
+void skinSumsNV21(const uint8_t *luma, int lumaStride, const uint8_t *vu, int vuStride,
+                  int x, int y, int width, int height, SkinSums &sums);
+
+// As skinSumsNV21 for packed RGBA, accumulating r, g and b.
+void skinSumsRGBA(const uint8_t *rgba, int stride,
+                  int x, int y, int width, int height, SkinSums &sums);
+
+/* KERNELS */
+
+// Accumulate one Y row from column x to width. skin holds the chroma class of each VU pair
+// of the row, vu the pairs themselves, both indexed by column / 2.
+// All variants produce identical sums; the scalar one is the reference.
+typedef void (*SkinSumsRowNV21)(const uint8_t *luma, const uint8_t *vu, const uint8_t *skin,
+                                int x, int width, SkinSums &sums);
+
+void skinSumsRowNV21_c(const uint8_t *luma, const uint8_t *vu, const uint8_t *skin,
+                       int x, int width, SkinSums &sums);
+
+#if defined(__SSE2__)
+void skinSumsRowNV21_sse2(const uint8_t *luma, const uint8_t *vu, const uint8_t *skin,
+                          int x, int width, SkinSums &sums);
+#endif
+
+#if defined(HAVE_NEON)
+void skinSumsRowNV21_neon(const uint8_t *luma, const uint8_t *vu, const uint8_t *skin,
+                          int x, int width, SkinSums &sums);
+#endif
+
+// Accumulate one packed RGBA row from column x to width, classifying each pixel by its
+// BT.601 luma and its chroma in table (skinChromaTable).
+// All variants produce identical sums; the scalar one is the reference.
+typedef void (*SkinSumsRowRGBA)(const uint8_t *rgba, const uint8_t *table, int x, int width, SkinSums &sums);
+
+void skinSumsRowRGBA_c(const uint8_t *rgba, const uint8_t *table, int x, int width, SkinSums &sums);
+
+#if defined(__SSE2__)
+void skinSumsRowRGBA_sse2(const uint8_t *rgba, const uint8_t *table, int x, int width, SkinSums &sums);
+#endif
+
+#if defined(HAVE_NEON)
+void skinSumsRowRGBA_neon(const uint8_t *rgba, const uint8_t *table, int x, int width, SkinSums &sums);
+#endif
+
+#endif /* skin_hpp */
@@ -0,0 +1,115 @@
+//
+//  skin_neon.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+//  Compiled with NEON enabled; only called after a runtime feature check.
+//
+
+#include "skin.hpp"
+
+#include <arm_neon.h>
+
+// Widen 16 bytes into a running 64-bit sum
+static inline uint64x2_t accumulate_neon(uint64x2_t sum, uint8x16_t a) {
+    return vpadalq_u32(sum, vpaddlq_u16(vpaddlq_u8(a)));
+}
+
+void skinSumsRowNV21_neon(const uint8_t *luma, const uint8_t *vu, const uint8_t *skin,
+                          int x, int width, SkinSums &sums) {
+
+    // Vectors start on a VU pair
+    if ((x & 1) && x < width) {
+        skinSumsRowNV21_c(luma, vu, skin, x, x + 1, sums);
+        x++;
+    }
+
+    const uint8x16_t minLuma = vdupq_n_u8(SKIN_MIN_LUMA);
+    const uint8x16_t maxLuma = vdupq_n_u8(SKIN_MAX_LUMA);
+    const uint16x8_t low = vdupq_n_u16(0x00FF);
+    uint64x2_t y = vdupq_n_u64(0), v = vdupq_n_u64(0), u = vdupq_n_u64(0), count = vdupq_n_u64(0);
+
+    // 16 pixels and their 8 VU pairs per iteration
+    for (; x + 16 <= width; x += 16) {
+
+        uint8x16_t l = vld1q_u8(luma + x);
+        uint8x8_t pairs = vld1_u8(skin + (x >> 1));
+        uint8x8x2_t s = vzip_u8(pairs, pairs);
+        uint8x16_t c = vld1q_u8(vu + x);
+
+        // Skin pixels: chroma class of the pair, luma within range
+        uint8x16_t m = vandq_u8(vcgeq_u8(l, minLuma), vcleq_u8(l, maxLuma));
+        m = vandq_u8(m, vcombine_u8(s.val[0], s.val[1]));
+
+        y = accumulate_neon(y, vandq_u8(l, m));
+        count = accumulate_neon(count, vshrq_n_u8(m, 7));
+
+        // Each pair counts once for each of its two pixels that is skin
+        uint16x8_t c0 = vreinterpretq_u16_u8(vandq_u8(c, m));
+        uint16x8_t c1 = vreinterpretq_u16_u8(vandq_u8(c, vrev16q_u8(m)));
+        v = vpadalq_u32(v, vpaddlq_u16(vaddq_u16(vandq_u16(c0, low), vandq_u16(c1, low))));
+        u = vpadalq_u32(u, vpaddlq_u16(vaddq_u16(vshrq_n_u16(c0, 8), vshrq_n_u16(c1, 8))));
+    }
+
+    sums.sum[0] += vgetq_lane_u64(y, 0) + vgetq_lane_u64(y, 1);
+    sums.sum[1] += vgetq_lane_u64(v, 0) + vgetq_lane_u64(v, 1);
+    sums.sum[2] += vgetq_lane_u64(u, 0) + vgetq_lane_u64(u, 1);
+    sums.count += vgetq_lane_u64(count, 0) + vgetq_lane_u64(count, 1);
+
+    skinSumsRowNV21_c(luma, vu, skin, x, width, sums);
+}
+
+static inline uint64_t sum32_neon(uint32x4_t a) {
+    return (uint64_t)vgetq_lane_u32(a, 0) + vgetq_lane_u32(a, 1) + vgetq_lane_u32(a, 2) + vgetq_lane_u32(a, 3);
+}
+
+// Weighted sum of r, g and b as in rgbToU/V before the shift
+static inline int16x8_t dot3_neon(int16x8_t r, int16x8_t g, int16x8_t b, int16_t kr, int16_t kg, int16_t kb) {
+    int16x8_t t = vmlaq_n_s16(vdupq_n_s16(128), r, kr);
+    t = vmlaq_n_s16(t, g, kg);
+    return vmlaq_n_s16(t, b, kb);
+}
+
+void skinSumsRowRGBA_neon(const uint8_t *rgba, const uint8_t *table, int x, int width, SkinSums &sums) {
+
+    const uint16x8_t minLuma = vdupq_n_u16(SKIN_MIN_LUMA);
+    const uint16x8_t maxLuma = vdupq_n_u16(SKIN_MAX_LUMA);
+    const int16x8_t offset = vdupq_n_s16(128);
+    uint32x4_t rs = vdupq_n_u32(0), gs = vdupq_n_u32(0), bs = vdupq_n_u32(0), count = vdupq_n_u32(0);
+    uint16_t index[8], skin[8];
+
+    // 8 pixels per iteration, 32-bit sums take two pixels per lane and iteration
+    for (; x + 8 <= width; x += 8) {
+
+        uint8x8x4_t p = vld4_u8(rgba + 4 * x);
+        uint16x8_t r = vmovl_u8(p.val[0]), g = vmovl_u8(p.val[1]), b = vmovl_u8(p.val[2]);
+
+        // Luma fits 16 bits unsigned, chroma signed
+        uint16x8_t y = vmlal_u8(vmlal_u8(vmull_u8(p.val[0], vdup_n_u8(66)), p.val[1], vdup_n_u8(129)), p.val[2], vdup_n_u8(25));
+        y = vaddq_u16(vshrq_n_u16(vaddq_u16(y, vdupq_n_u16(128)), 8), vdupq_n_u16(16));
+        int16x8_t rs16 = vreinterpretq_s16_u16(r), gs16 = vreinterpretq_s16_u16(g), bs16 = vreinterpretq_s16_u16(b);
+        uint16x8_t u = vreinterpretq_u16_s16(vaddq_s16(vshrq_n_s16(dot3_neon(rs16, gs16, bs16, -38, -74, 112), 8), offset));
+        uint16x8_t v = vreinterpretq_u16_s16(vaddq_s16(vshrq_n_s16(dot3_neon(rs16, gs16, bs16, 112, -94, -18), 8), offset));
+
+        // No gather in NEON, the table is looked up per pixel
+        vst1q_u16(index, vorrq_u16(vshlq_n_u16(v, 8), u));
+        for (int k = 0; k < 8; k++) {
+            skin[k] = table[index[k]] * 0x0101;
+        }
+        uint16x8_t m = vandq_u16(vcgeq_u16(y, minLuma), vcleq_u16(y, maxLuma));
+        m = vandq_u16(m, vld1q_u16(skin));
+
+        rs = vpadalq_u16(rs, vandq_u16(r, m));
+        gs = vpadalq_u16(gs, vandq_u16(g, m));
+        bs = vpadalq_u16(bs, vandq_u16(b, m));
+        count = vpadalq_u16(count, vshrq_n_u16(m, 15));
+    }
+
+    sums.sum[0] += sum32_neon(rs);
+    sums.sum[1] += sum32_neon(gs);
+    sums.sum[2] += sum32_neon(bs);
+    sums.count += sum32_neon(count);
+
+    skinSumsRowRGBA_c(rgba, table, x, width, sums);
+}
@@ -0,0 +1,369 @@
+//
+//  yuv.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#include "yuv.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(HAVE_AVX2)
+#include <immintrin.h>
+#endif
+
+/* SCALAR REFERENCE */
+
+// 8-bit fixed point BT.601 coefficients, results are in [16, 235] and [16, 240]
+static inline uint8_t rgbToY(int r, int g, int b) {
+    return (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+static inline uint8_t rgbToU(int r, int g, int b) {
+    return (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+
+static inline uint8_t rgbToV(int r, int g, int b) {
+    return (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+void rgbaToYuv420pRows_c(const uint8_t *src0, const uint8_t *src1,
+                         uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v,
+                         int x, int width) {
+    for (; x < width; x += 2) {
+        // Replicate the last column for odd widths
+        const int x1 = x + 1 < width ? x + 1 : x;
+        const uint8_t *p00 = src0 + 4 * x, *p01 = src0 + 4 * x1;
+        const uint8_t *p10 = src1 + 4 * x, *p11 = src1 + 4 * x1;
+        y0[x] = rgbToY(p00[0], p00[1], p00[2]);
+        y0[x1] = rgbToY(p01[0], p01[1], p01[2]);
+        y1[x] = rgbToY(p10[0], p10[1], p10[2]);
+        y1[x1] = rgbToY(p11[0], p11[1], p11[2]);
+        const int r = (p00[0] + p01[0] + p10[0] + p11[0] + 2) >> 2;
+        const int g = (p00[1] + p01[1] + p10[1] + p11[1] + 2) >> 2;
+        const int b = (p00[2] + p01[2] + p10[2] + p11[2] + 2) >> 2;
+        u[x >> 1] = rgbToU(r, g, b);
+        v[x >> 1] = rgbToV(r, g, b);
+    }
+}
+
+void splitVURow_c(const uint8_t *vu, uint8_t *u, uint8_t *v, int x, int width) {
+    for (; x < width; x++) {
+        v[x] = vu[2 * x];
+        u[x] = vu[2 * x + 1];
+    }
+}
+
+void mergeVURow_c(const uint8_t *u, const uint8_t *v, uint8_t *vu, int x, int width) {
+    for (; x < width; x++) {
+        vu[2 * x] = v[x];
+        vu[2 * x + 1] = u[x];
+    }
+}
+
+/* SSE2 */
+
+#if defined(__SSE2__)
+
+// Dot product of two 16-bit RGBA quadruples per register with k,
+// rounded and offset: ((k·p + 128) >> 8) + bias for four pixels
+static inline __m128i dot4_sse2(__m128i lo, __m128i hi, __m128i k, __m128i bias) {
+    __m128i mlo = _mm_madd_epi16(lo, k);   // [rg0, ba0, rg1, ba1]
+    __m128i mhi = _mm_madd_epi16(hi, k);   // [rg2, ba2, rg3, ba3]
+    __m128i a = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(mlo), _mm_castsi128_ps(mhi), _MM_SHUFFLE(2, 0, 2, 0)));
+    __m128i b = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(mlo), _mm_castsi128_ps(mhi), _MM_SHUFFLE(3, 1, 3, 1)));
+    __m128i s = _mm_add_epi32(_mm_add_epi32(a, b), _mm_set1_epi32(128));
+    return _mm_add_epi32(_mm_srai_epi32(s, 8), bias);
+}
+
+// Luma of 4 RGBA pixels
+static inline __m128i y4_sse2(__m128i px, __m128i kY) {
+    const __m128i zero = _mm_setzero_si128();
+    return dot4_sse2(_mm_unpacklo_epi8(px, zero), _mm_unpackhi_epi8(px, zero), kY, _mm_set1_epi32(16));
+}
+
+// Rounded 2x2 average of 4 RGBA pixels from two rows, as two 16-bit RGBA quadruples
+static inline __m128i avg2x2_sse2(__m128i row0, __m128i row1) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(row0, zero), _mm_unpacklo_epi8(row1, zero));
+    __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(row0, zero), _mm_unpackhi_epi8(row1, zero));
+    lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+    hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+    __m128i s = _mm_unpacklo_epi64(lo, hi);
+    return _mm_srli_epi16(_mm_add_epi16(s, _mm_set1_epi16(2)), 2);
+}
+
+void rgbaToYuv420pRows_sse2(const uint8_t *src0, const uint8_t *src1,
+                            uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v,
+                            int x, int width) {
+
+    const __m128i kY = _mm_setr_epi16(66, 129, 25, 0, 66, 129, 25, 0);
+    const __m128i kU = _mm_setr_epi16(-38, -74, 112, 0, -38, -74, 112, 0);
+    const __m128i kV = _mm_setr_epi16(112, -94, -18, 0, 112, -94, -18, 0);
+    const __m128i bias = _mm_set1_epi32(128);
+
+    // 16 pixels per iteration
+    for (; x + 16 <= width; x += 16) {
+
+        __m128i a[4], b[4];
+        for (int i = 0; i < 4; i++) {
+            a[i] = _mm_loadu_si128((const __m128i *)(src0 + 4 * (x + 4 * i)));
+            b[i] = _mm_loadu_si128((const __m128i *)(src1 + 4 * (x + 4 * i)));
+        }
+
+        // Luma
+        __m128i ya = _mm_packus_epi16(_mm_packs_epi32(y4_sse2(a[0], kY), y4_sse2(a[1], kY)),
+                                      _mm_packs_epi32(y4_sse2(a[2], kY), y4_sse2(a[3], kY)));
+        __m128i yb = _mm_packus_epi16(_mm_packs_epi32(y4_sse2(b[0], kY), y4_sse2(b[1], kY)),
+                                      _mm_packs_epi32(y4_sse2(b[2], kY), y4_sse2(b[3], kY)));
+        _mm_storeu_si128((__m128i *)(y0 + x), ya);
+        _mm_storeu_si128((__m128i *)(y1 + x), yb);
+
+        // Chroma of 8 blocks
+        __m128i m[4];
+        for (int i = 0; i < 4; i++) {
+            m[i] = avg2x2_sse2(a[i], b[i]);
+        }
+        __m128i u16 = _mm_packs_epi32(dot4_sse2(m[0], m[1], kU, bias), dot4_sse2(m[2], m[3], kU, bias));
+        __m128i v16 = _mm_packs_epi32(dot4_sse2(m[0], m[1], kV, bias), dot4_sse2(m[2], m[3], kV, bias));
+        _mm_storel_epi64((__m128i *)(u + (x >> 1)), _mm_packus_epi16(u16, u16));
+        _mm_storel_epi64((__m128i *)(v + (x >> 1)), _mm_packus_epi16(v16, v16));
+    }
+
+    rgbaToYuv420pRows_c(src0, src1, y0, y1, u, v, x, width);
+}
+
+void splitVURow_sse2(const uint8_t *vu, uint8_t *u, uint8_t *v, int x, int width) {
+
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+
+    // 16 pairs per iteration
+    for (; x + 16 <= width; x += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(vu + 2 * x));
+        __m128i b = _mm_loadu_si128((const __m128i *)(vu + 2 * x + 16));
+        _mm_storeu_si128((__m128i *)(v + x), _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask)));
+        _mm_storeu_si128((__m128i *)(u + x), _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+    }
+
+    splitVURow_c(vu, u, v, x, width);
+}
+
+void mergeVURow_sse2(const uint8_t *u, const uint8_t *v, uint8_t *vu, int x, int width) {
+
+    // 16 pairs per iteration
+    for (; x + 16 <= width; x += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(v + x));
+        __m128i b = _mm_loadu_si128((const __m128i *)(u + x));
+        _mm_storeu_si128((__m128i *)(vu + 2 * x), _mm_unpacklo_epi8(a, b));
+        _mm_storeu_si128((__m128i *)(vu + 2 * x + 16), _mm_unpackhi_epi8(a, b));
+    }
+
+    mergeVURow_c(u, v, vu, x, width);
+}
+
+#endif
+
+/* AVX2 */
+
+#if defined(HAVE_AVX2)
+
+// The SSE2 steps on both 128-bit lanes at once. Lane-wise packing leaves groups of four
+// values in lane order, which PACK_ORDER puts back in column order.
+#define PACK_ORDER _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7)
+
+static inline TARGET_AVX2 __m256i dot4_avx2(__m256i lo, __m256i hi, __m256i k, __m256i bias) {
+    __m256i mlo = _mm256_madd_epi16(lo, k);
+    __m256i mhi = _mm256_madd_epi16(hi, k);
+    __m256i a = _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(mlo), _mm256_castsi256_ps(mhi), _MM_SHUFFLE(2, 0, 2, 0)));
+    __m256i b = _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(mlo), _mm256_castsi256_ps(mhi), _MM_SHUFFLE(3, 1, 3, 1)));
+    __m256i s = _mm256_add_epi32(_mm256_add_epi32(a, b), _mm256_set1_epi32(128));
+    return _mm256_add_epi32(_mm256_srai_epi32(s, 8), bias);
+}
+
+static inline TARGET_AVX2 __m256i y8_avx2(__m256i px, __m256i kY) {
+    const __m256i zero = _mm256_setzero_si256();
+    return dot4_avx2(_mm256_unpacklo_epi8(px, zero), _mm256_unpackhi_epi8(px, zero), kY, _mm256_set1_epi32(16));
+}
+
+static inline TARGET_AVX2 __m256i avg2x2_avx2(__m256i row0, __m256i row1) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i lo = _mm256_add_epi16(_mm256_unpacklo_epi8(row0, zero), _mm256_unpacklo_epi8(row1, zero));
+    __m256i hi = _mm256_add_epi16(_mm256_unpackhi_epi8(row0, zero), _mm256_unpackhi_epi8(row1, zero));
+    lo = _mm256_add_epi16(lo, _mm256_srli_si256(lo, 8));
+    hi = _mm256_add_epi16(hi, _mm256_srli_si256(hi, 8));
+    __m256i s = _mm256_unpacklo_epi64(lo, hi);
+    return _mm256_srli_epi16(_mm256_add_epi16(s, _mm256_set1_epi16(2)), 2);
+}
+
+TARGET_AVX2 void rgbaToYuv420pRows_avx2(const uint8_t *src0, const uint8_t *src1,
+                                        uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v,
+                                        int x, int width) {
+
+    const __m256i kY = _mm256_setr_epi16(66, 129, 25, 0, 66, 129, 25, 0, 66, 129, 25, 0, 66, 129, 25, 0);
+    const __m256i kU = _mm256_setr_epi16(-38, -74, 112, 0, -38, -74, 112, 0, -38, -74, 112, 0, -38, -74, 112, 0);
+    const __m256i kV = _mm256_setr_epi16(112, -94, -18, 0, 112, -94, -18, 0, 112, -94, -18, 0, 112, -94, -18, 0);
+    const __m256i bias = _mm256_set1_epi32(128);
+    const __m256i order = PACK_ORDER;
+
+    // 32 pixels per iteration
+    for (; x + 32 <= width; x += 32) {
+
+        __m256i a[4], b[4];
+        for (int i = 0; i < 4; i++) {
+            a[i] = _mm256_loadu_si256((const __m256i *)(src0 + 4 * (x + 8 * i)));
+            b[i] = _mm256_loadu_si256((const __m256i *)(src1 + 4 * (x + 8 * i)));
+        }
+
+        // Luma
+        __m256i ya = _mm256_packus_epi16(_mm256_packs_epi32(y8_avx2(a[0], kY), y8_avx2(a[1], kY)),
+                                         _mm256_packs_epi32(y8_avx2(a[2], kY), y8_avx2(a[3], kY)));
+        __m256i yb = _mm256_packus_epi16(_mm256_packs_epi32(y8_avx2(b[0], kY), y8_avx2(b[1], kY)),
+                                         _mm256_packs_epi32(y8_avx2(b[2], kY), y8_avx2(b[3], kY)));
+        _mm256_storeu_si256((__m256i *)(y0 + x), _mm256_permutevar8x32_epi32(ya, order));
+        _mm256_storeu_si256((__m256i *)(y1 + x), _mm256_permutevar8x32_epi32(yb, order));
+
+        // Chroma of 16 blocks
+        __m256i m[4];
+        for (int i = 0; i < 4; i++) {
+            m[i] = avg2x2_avx2(a[i], b[i]);
+        }
+        __m256i u16 = _mm256_packs_epi32(dot4_avx2(m[0], m[1], kU, bias), dot4_avx2(m[2], m[3], kU, bias));
+        __m256i v16 = _mm256_packs_epi32(dot4_avx2(m[0], m[1], kV, bias), dot4_avx2(m[2], m[3], kV, bias));
+        u16 = _mm256_permutevar8x32_epi32(u16, order);
+        v16 = _mm256_permutevar8x32_epi32(v16, order);
+        __m256i u8 = _mm256_permute4x64_epi64(_mm256_packus_epi16(u16, u16), _MM_SHUFFLE(3, 1, 2, 0));
+        __m256i v8 = _mm256_permute4x64_epi64(_mm256_packus_epi16(v16, v16), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm_storeu_si128((__m128i *)(u + (x >> 1)), _mm256_castsi256_si128(u8));
+        _mm_storeu_si128((__m128i *)(v + (x >> 1)), _mm256_castsi256_si128(v8));
+    }
+
+    rgbaToYuv420pRows_sse2(src0, src1, y0, y1, u, v, x, width);
+}
+
+TARGET_AVX2 void splitVURow_avx2(const uint8_t *vu, uint8_t *u, uint8_t *v, int x, int width) {
+
+    const __m256i mask = _mm256_set1_epi16(0x00FF);
+
+    // 32 pairs per iteration
+    for (; x + 32 <= width; x += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(vu + 2 * x));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(vu + 2 * x + 32));
+        __m256i vs = _mm256_packus_epi16(_mm256_and_si256(a, mask), _mm256_and_si256(b, mask));
+        __m256i us = _mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8));
+        _mm256_storeu_si256((__m256i *)(v + x), _mm256_permute4x64_epi64(vs, _MM_SHUFFLE(3, 1, 2, 0)));
+        _mm256_storeu_si256((__m256i *)(u + x), _mm256_permute4x64_epi64(us, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+
+    splitVURow_sse2(vu, u, v, x, width);
+}
+
+TARGET_AVX2 void mergeVURow_avx2(const uint8_t *u, const uint8_t *v, uint8_t *vu, int x, int width) {
+
+    // 32 pairs per iteration
+    for (; x + 32 <= width; x += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(v + x));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(u + x));
+        __m256i lo = _mm256_unpacklo_epi8(a, b);
+        __m256i hi = _mm256_unpackhi_epi8(a, b);
+        _mm256_storeu_si256((__m256i *)(vu + 2 * x), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i *)(vu + 2 * x + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+
+    mergeVURow_sse2(u, v, vu, x, width);
+}
+
+#endif
+
+/* DISPATCH */
+
+static RgbaToYuv420pRows selectRgbaToYuv420pRows() {
+#if defined(HAVE_NEON)
+    if (hasNeon()) {
+        return rgbaToYuv420pRows_neon;
+    }
+#elif defined(__SSE2__)
+#if defined(HAVE_AVX2)
+    if (hasAvx2()) {
+        return rgbaToYuv420pRows_avx2;
+    }
+#endif
+    return rgbaToYuv420pRows_sse2;
+#endif
+    return rgbaToYuv420pRows_c;
+}
+
+static SplitVURow selectSplitVURow() {
+#if defined(HAVE_NEON)
+    if (hasNeon()) {
+        return splitVURow_neon;
+    }
+#elif defined(__SSE2__)
+#if defined(HAVE_AVX2)
+    if (hasAvx2()) {
+        return splitVURow_avx2;
+    }
+#endif
+    return splitVURow_sse2;
+#endif
+    return splitVURow_c;
+}
+
+static MergeVURow selectMergeVURow() {
+#if defined(HAVE_NEON)
+    if (hasNeon()) {
+        return mergeVURow_neon;
+    }
+#elif defined(__SSE2__)
+#if defined(HAVE_AVX2)
+    if (hasAvx2()) {
+        return mergeVURow_avx2;
+    }
+#endif
+    return mergeVURow_sse2;
+#endif
+    return mergeVURow_c;
+}
+
+void rgbaToYuv420p(const uint8_t *src, int srcStride,
+                   uint8_t *const dst[3], const int dstStride[3],
+                   int width, int height) {
+
+    static const RgbaToYuv420pRows rows = selectRgbaToYuv420pRows();
+
+    for (int j = 0; j < height; j += 2) {
+        // Replicate the last row for odd heights
+        const bool pair = j + 1 < height;
+        const uint8_t *src0 = src + j * srcStride;
+        const uint8_t *src1 = pair ? src0 + srcStride : src0;
+        uint8_t *y0 = dst[0] + j * dstStride[0];
+        uint8_t *y1 = pair ? y0 + dstStride[0] : y0;
+        uint8_t *u = dst[1] + (j >> 1) * dstStride[1];
+        uint8_t *v = dst[2] + (j >> 1) * dstStride[2];
+        rows(src0, src1, y0, y1, u, v, 0, width);
+    }
+}
+
+void nv21ChromaToYuv420p(const uint8_t *vu, int vuStride,
+                         uint8_t *u, int uStride, uint8_t *v, int vStride,
+                         int width, int height) {
+
+    static const SplitVURow row = selectSplitVURow();
+
+    for (int j = 0; j < height; j++) {
+        row(vu + j * vuStride, u + j * uStride, v + j * vStride, 0, width);
+    }
+}
+
+void yuv420pChromaToNV21(const uint8_t *u, int uStride, const uint8_t *v, int vStride,
+                         uint8_t *vu, int vuStride,
+                         int width, int height) {
+
+    static const MergeVURow row = selectMergeVURow();
+
+    for (int j = 0; j < height; j++) {
+        row(u + j * uStride, v + j * vStride, vu + j * vuStride, 0, width);
+    }
+}
@@ -0,0 +1,90 @@
+//
+//  yuv.hpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+
+#ifndef yuv_hpp
+#define yuv_hpp
+
+#include <stdint.h>
+
+#include "cpu.hpp"
+
+/* COLOR CONVERSION */
+
+// Same-size conversion of packed RGBA to planar YUV 4:2:0 (BT.601, limited range).
+// Chroma is the rounded average of each 2x2 block. Odd sizes replicate the last column/row.
+// Luma is within one code value of swscale; chroma is too on camera content, but not on
+// per-pixel detail, where swscale's bilinear chroma filter has a wider support.
+// The fastest kernel available on the running CPU is selected on first use.
+void rgbaToYuv420p(const uint8_t *src, int srcStride,
+                   uint8_t *const dst[3], const int dstStride[3],
+                   int width, int height);
+
+// Split the interleaved VU plane of an NV21 frame into separate U and V planes.
+// width and height are the chroma plane dimensions.
+void nv21ChromaToYuv420p(const uint8_t *vu, int vuStride,
+                         uint8_t *u, int uStride, uint8_t *v, int vStride,
+                         int width, int height);
+
+// Interleave the U and V planes of YUV 4:2:0 into the VU plane of an NV21 frame.
+// width and height are the chroma plane dimensions.
+void yuv420pChromaToNV21(const uint8_t *u, int uStride, const uint8_t *v, int vStride,
+                         uint8_t *vu, int vuStride,
+                         int width, int height);
+
+/* KERNELS */
+
+// Convert a pair of RGBA rows into two Y rows and one U and V row, starting at (even) column x.
+// All variants produce bit-identical output; the scalar one is the reference.
+typedef void (*RgbaToYuv420pRows)(const uint8_t *src0, const uint8_t *src1,
+                                  uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v,
+                                  int x, int width);
+
+void rgbaToYuv420pRows_c(const uint8_t *src0, const uint8_t *src1,
+                         uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v,
+                         int x, int width);
+
+// Split one row of interleaved VU pairs into U and V, starting at pair x.
+typedef void (*SplitVURow)(const uint8_t *vu, uint8_t *u, uint8_t *v, int x, int width);
+
+void splitVURow_c(const uint8_t *vu, uint8_t *u, uint8_t *v, int x, int width);
+
+// Interleave one row of U and V into VU pairs, starting at pair x.
+typedef void (*MergeVURow)(const uint8_t *u, const uint8_t *v, uint8_t *vu, int x, int width);
+
+void mergeVURow_c(const uint8_t *u, const uint8_t *v, uint8_t *vu, int x, int width);
+
+#if defined(__SSE2__)
+void splitVURow_sse2(const uint8_t *vu, uint8_t *u, uint8_t *v, int x, int width);
+
+void mergeVURow_sse2(const uint8_t *u, const uint8_t *v, uint8_t *vu, int x, int width);
+
+void rgbaToYuv420pRows_sse2(const uint8_t *src0, const uint8_t *src1,
+                            uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v,
+                            int x, int width);
+#endif
+
+#if defined(HAVE_AVX2)
+void splitVURow_avx2(const uint8_t *vu, uint8_t *u, uint8_t *v, int x, int width);
+
+void mergeVURow_avx2(const uint8_t *u, const uint8_t *v, uint8_t *vu, int x, int width);
+
+void rgbaToYuv420pRows_avx2(const uint8_t *src0, const uint8_t *src1,
+                            uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v,
+                            int x, int width);
+#endif
+
+#if defined(HAVE_NEON)
+void splitVURow_neon(const uint8_t *vu, uint8_t *u, uint8_t *v, int x, int width);
+
+void mergeVURow_neon(const uint8_t *u, const uint8_t *v, uint8_t *vu, int x, int width);
+
+void rgbaToYuv420pRows_neon(const uint8_t *src0, const uint8_t *src1,
+                            uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v,
+                            int x, int width);
+#endif
+
+#endif /* yuv_hpp */
@@ -0,0 +1,86 @@
+//
+//  yuv_neon.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+//  Compiled with NEON enabled; only called after a runtime feature check.
+//
+
+#include "yuv.hpp"
+
+#include <arm_neon.h>
+
+// Luma of 8 pixels: ((66r + 129g + 25b + 128) >> 8) + 16
+static inline uint8x8_t y8_neon(uint8x8_t r, uint8x8_t g, uint8x8_t b) {
+    uint16x8_t t = vmull_u8(r, vdup_n_u8(66));
+    t = vmlal_u8(t, g, vdup_n_u8(129));
+    t = vmlal_u8(t, b, vdup_n_u8(25));
+    return vadd_u8(vrshrn_n_u16(t, 8), vdup_n_u8(16));
+}
+
+// Chroma of 8 averaged blocks: ((kr*r + kg*g + kb*b + 128) >> 8) + 128
+static inline uint8x8_t c8_neon(int16x8_t r, int16x8_t g, int16x8_t b, int16_t kr, int16_t kg, int16_t kb) {
+    int16x8_t t = vmulq_n_s16(r, kr);
+    t = vmlaq_n_s16(t, g, kg);
+    t = vmlaq_n_s16(t, b, kb);
+    return vqmovun_s16(vaddq_s16(vrshrq_n_s16(t, 8), vdupq_n_s16(128)));
+}
+
+// Rounded 2x2 average of 16 pixels from two rows into 8 blocks
+static inline int16x8_t avg2x2_neon(uint8x16_t row0, uint8x16_t row1) {
+    uint16x8_t s = vpadalq_u8(vpaddlq_u8(row0), row1);
+    return vreinterpretq_s16_u16(vrshrq_n_u16(s, 2));
+}
+
+void rgbaToYuv420pRows_neon(const uint8_t *src0, const uint8_t *src1,
+                            uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v,
+                            int x, int width) {
+
+    // 16 pixels per iteration
+    for (; x + 16 <= width; x += 16) {
+
+        uint8x16x4_t a = vld4q_u8(src0 + 4 * x);
+        uint8x16x4_t b = vld4q_u8(src1 + 4 * x);
+
+        // Luma
+        vst1q_u8(y0 + x, vcombine_u8(y8_neon(vget_low_u8(a.val[0]), vget_low_u8(a.val[1]), vget_low_u8(a.val[2])),
+                                     y8_neon(vget_high_u8(a.val[0]), vget_high_u8(a.val[1]), vget_high_u8(a.val[2]))));
+        vst1q_u8(y1 + x, vcombine_u8(y8_neon(vget_low_u8(b.val[0]), vget_low_u8(b.val[1]), vget_low_u8(b.val[2])),
+                                     y8_neon(vget_high_u8(b.val[0]), vget_high_u8(b.val[1]), vget_high_u8(b.val[2]))));
+
+        // Chroma of 8 blocks
+        int16x8_t r = avg2x2_neon(a.val[0], b.val[0]);
+        int16x8_t g = avg2x2_neon(a.val[1], b.val[1]);
+        int16x8_t bl = avg2x2_neon(a.val[2], b.val[2]);
+        vst1_u8(u + (x >> 1), c8_neon(r, g, bl, -38, -74, 112));
+        vst1_u8(v + (x >> 1), c8_neon(r, g, bl, 112, -94, -18));
+    }
+
+    rgbaToYuv420pRows_c(src0, src1, y0, y1, u, v, x, width);
+}
+
+void splitVURow_neon(const uint8_t *vu, uint8_t *u, uint8_t *v, int x, int width) {
+
+    // 16 pairs per iteration
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x2_t p = vld2q_u8(vu + 2 * x);
+        vst1q_u8(v + x, p.val[0]);
+        vst1q_u8(u + x, p.val[1]);
+    }
+
+    splitVURow_c(vu, u, v, x, width);
+}
+
+void mergeVURow_neon(const uint8_t *u, const uint8_t *v, uint8_t *vu, int x, int width) {
+
+    // 16 pairs per iteration
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x2_t p;
+        p.val[0] = vld1q_u8(v + x);
+        p.val[1] = vld1q_u8(u + x);
+        vst2q_u8(vu + 2 * x, p);
+    }
+
+    mergeVURow_c(u, v, vu, x, width);
+}
@@ -0,0 +1,60 @@
+//
+//  blocks_bench.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+//  Cost of sampling the face box as a grid of blocks against one full-frame mean call,
+//  on a 720p camera frame in RGBA and NV21.
+//
+//    g++ -std=c++11 -O2 -msse2 -I../../main/jni blocks_bench.cpp ../../main/jni/opencv.cpp
+//        ../../main/jni/signal.cpp ../../main/jni/skin.cpp -o blocks_bench `pkg-config --cflags --libs opencv`
+//
+//  Usage: blocks_bench [face size]
+//
+
+#include <stdlib.h>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "harness.hpp"
+#include "opencv.hpp"
+
+#define WIDTH 1280
+#define HEIGHT 720
+#define CALLS 200
+
+using namespace cv;
+
+int main(int argc, char *argv[]) {
+
+    const int face = argc > 1 ? atoi(argv[1]) : 320;
+    const Rect box((WIDTH - face) / 2, (HEIGHT - face) / 2, face, face);
+
+    Mat rgba(HEIGHT, WIDTH, CV_8UC4);
+    randu(rgba, Scalar::all(0), Scalar::all(255));
+    Mat nv21(HEIGHT * 3 / 2, WIDTH, CV_8U);
+    randu(nv21, Scalar(0), Scalar(255));
+
+    Scalar means;
+    Mat blocks;
+
+    printf("%dx%d frame, %dx%d face box, mean time per call\n", WIDTH, HEIGHT, face, face);
+
+    const double frameMean = timeMs([&]() { means = mean(rgba); }, CALLS);
+    const double boxMean = timeMs([&]() { means = mean(rgba(box)); }, CALLS);
+    const double boxMeanNV21 = timeMs([&]() { means = meanNV21(nv21, box); }, CALLS);
+    printf("  full-frame mean           %8.3f ms\n", frameMean);
+    printf("  box mean                  %8.3f ms\n", boxMean);
+    printf("  box meanNV21              %8.3f ms\n", boxMeanNV21);
+
+    for (int grid = 2; grid <= 8; grid *= 2) {
+        const double rgbaGrid = timeMs([&]() { blockMeans(rgba, box, grid, blocks); }, CALLS);
+        const double nv21Grid = timeMs([&]() { blockMeansNV21(nv21, box, grid, blocks); }, CALLS);
+        printf("  %dx%d blocks  rgba %8.3f ms (%.2fx full frame)   nv21 %8.3f ms (%.2fx)\n",
+               grid, grid, rgbaGrid, rgbaGrid / frameMean, nv21Grid, nv21Grid / frameMean);
+    }
+
+    return 0;
+}
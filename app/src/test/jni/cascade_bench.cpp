@@ -0,0 +1,97 @@
+//
+//  cascade_bench.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+//  Startup cost of a face cascade: parsing the XML into a CascadeClassifier, as before,
+//  against mapping the binary HaarCascade that CascadeRegistry converts it to.
+//  Each load starts from a fresh object; both include the first detection, which pages in the
+//  mapped model. For disk-cold numbers drop the page cache before each run.
+//
+//    g++ -std=c++11 -O2 -I../../main/jni cascade_bench.cpp ../../main/jni/HaarCascade.cpp -o cascade_bench
+//        `pkg-config --cflags --libs opencv`
+//
+//  Usage: cascade_bench cascade.xml [loads]
+//
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/objdetect/objdetect.hpp>
+
+#include "harness.hpp"
+#include "HaarCascade.hpp"
+
+#define SCALE_FACTOR 1.1
+#define MIN_NEIGHBORS 3
+
+using namespace cv;
+
+int main(int argc, char *argv[]) {
+
+    if (argc < 2) {
+        fprintf(stderr, "Usage: cascade_bench cascade.xml [loads]\n");
+        return 1;
+    }
+    const std::string path = argv[1];
+    const std::string binPath = path + ".bin";
+    const int loads = argc > 2 ? atoi(argv[2]) : 10;
+
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        fprintf(stderr, "Could not open %s\n", path.c_str());
+        return 1;
+    }
+    const HaarCascade::Source source = {(int64_t)st.st_size, (int64_t)st.st_mtime};
+
+    // Camera-sized gray frame to detect on
+    Mat image(480, 640, CV_8U);
+    randu(image, Scalar(0), Scalar(255));
+    std::vector<Rect> objects;
+
+    {
+        FileStorage fs(path, FileStorage::READ);
+        if (!fs.isOpened() || !HaarCascade::convert(fs.getFirstTopLevelNode(), binPath, source)) {
+            fprintf(stderr, "Could not convert %s\n", path.c_str());
+            return 1;
+        }
+    }
+
+    const double parse = timeMs([&]() {
+        FileStorage fs(path, FileStorage::READ);
+        CascadeClassifier classifier;
+        classifier.read(fs.getFirstTopLevelNode());
+    }, loads, 1);
+
+    const double parseDetect = timeMs([&]() {
+        FileStorage fs(path, FileStorage::READ);
+        CascadeClassifier classifier;
+        classifier.read(fs.getFirstTopLevelNode());
+        classifier.detectMultiScale(image, objects, SCALE_FACTOR, MIN_NEIGHBORS, CV_HAAR_SCALE_IMAGE,
+                                    classifier.getOriginalWindowSize());
+    }, loads, 1);
+
+    const double map = timeMs([&]() {
+        HaarCascade cascade;
+        cascade.load(binPath, source);
+    }, loads, 1);
+
+    const double mapDetect = timeMs([&]() {
+        HaarCascade cascade;
+        HaarCascade::Buffers buffers;
+        cascade.load(binPath, source);
+        cascade.detectMultiScale(image, objects, SCALE_FACTOR, MIN_NEIGHBORS, cascade.getOriginalWindowSize(), buffers);
+    }, loads, 1);
+
+    printf("%s, mean of %d loads\n", path.c_str(), loads);
+    printf("  xml parse          %8.3f ms\n", parse);
+    printf("  xml parse + detect %8.3f ms\n", parseDetect);
+    printf("  bin map            %8.3f ms\n", map);
+    printf("  bin map + detect   %8.3f ms\n", mapDetect);
+    printf("  startup saved      %8.3f ms\n", parseDetect - mapDetect);
+
+    return 0;
+}
@@ -0,0 +1,188 @@
+//
+//  cascade_test.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+//  Host test of HaarCascade: each bundled cascade is converted and must find the same rectangles
+//  as cv::CascadeClassifier on synthetic faces, both the raw candidates and the grouped ones.
+//  Binary files that are corrupt, truncated, of another format version or converted from another
+//  source must not load.
+//
+//    g++ -std=c++11 -O2 -I../../main/jni cascade_test.cpp ../../main/jni/HaarCascade.cpp -o cascade_test
+//        `pkg-config --cflags --libs opencv`
+//
+//  Usage: cascade_test [res/raw directory, default ../../main/res/raw] [gray images...]
+//
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/objdetect/objdetect.hpp>
+
+#include "harness.hpp"
+#include "HaarCascade.hpp"
+
+#define SCALE_FACTOR 1.1
+#define MIN_NEIGHBORS 3
+#define VERSION_OFFSET 8        // After the magic
+
+using namespace cv;
+
+static const char *CASCADES[] = {
+    "haarcascade_frontalface_alt.xml",
+    "haarcascade_eye.xml",
+    "haarcascade_lefteye_2splits.xml",
+    "haarcascade_righteye_2splits.xml",
+};
+
+static bool lessRect(const Rect &a, const Rect &b) {
+    if (a.x != b.x) return a.x < b.x;
+    if (a.y != b.y) return a.y < b.y;
+    if (a.width != b.width) return a.width < b.width;
+    return a.height < b.height;
+}
+
+// Cartoon face on noise: skin ellipse, eyes, brows, nose and mouth
+static Mat syntheticFace(Size size, Point centre, double scale, int seed) {
+    Mat noise(size, CV_8U), image(size, CV_8U, Scalar(90));
+    RNG rng(seed);
+    rng.fill(noise, RNG::UNIFORM, 0, 20);
+    image += noise;
+    ellipse(image, centre, Size(cvRound(40 * scale), cvRound(52 * scale)), 0, 0, 360, Scalar(180), -1);
+    for (int side = -1; side <= 1; side += 2) {
+        ellipse(image, centre + Point(cvRound(side * 16 * scale), cvRound(-12 * scale)),
+                Size(cvRound(8 * scale), cvRound(4 * scale)), 0, 0, 360, Scalar(40), -1);
+        line(image, centre + Point(cvRound(side * 8 * scale), cvRound(-22 * scale)),
+             centre + Point(cvRound(side * 26 * scale), cvRound(-24 * scale)), Scalar(60), std::max(1, cvRound(3 * scale)));
+    }
+    line(image, centre + Point(0, cvRound(-6 * scale)), centre + Point(0, cvRound(10 * scale)),
+         Scalar(140), std::max(1, cvRound(4 * scale)));
+    ellipse(image, centre + Point(0, cvRound(26 * scale)), Size(cvRound(14 * scale), cvRound(4 * scale)),
+            0, 0, 360, Scalar(70), -1);
+    GaussianBlur(image, image, Size(), 1.5);
+    return image;
+}
+
+static HaarCascade::Source sourceOf(const std::string &path) {
+    struct stat st;
+    HaarCascade::Source source = {-1, -1};
+    if (stat(path.c_str(), &st) == 0) {
+        source.size = st.st_size;
+        source.time = st.st_mtime;
+    }
+    return source;
+}
+
+static std::vector<char> readFile(const std::string &path) {
+    std::vector<char> bytes;
+    FILE *f = fopen(path.c_str(), "rb");
+    if (f) {
+        char buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+            bytes.insert(bytes.end(), buffer, buffer + n);
+        }
+        fclose(f);
+    }
+    return bytes;
+}
+
+static bool writeFile(const std::string &path, const std::vector<char> &bytes, size_t length) {
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f) {
+        return false;
+    }
+    const bool ok = fwrite(&bytes[0], 1, length, f) == length;
+    return fclose(f) == 0 && ok;
+}
+
+// Damaged copies of a converted file must be rejected
+static void checkRejected(const std::string &binPath, const HaarCascade::Source &source) {
+
+    const std::vector<char> bytes = readFile(binPath);
+    CHECK(bytes.size() > 64);
+    if (bytes.size() <= 64) {
+        return;
+    }
+    const std::string copyPath = binPath + ".copy";
+    HaarCascade cascade;
+
+    CHECK(!cascade.load(binPath, HaarCascade::Source{source.size + 1, source.time}));
+    CHECK(!cascade.load(binPath, HaarCascade::Source{source.size, source.time + 1}));
+
+    std::vector<char> flipped = bytes;
+    flipped[bytes.size() / 2] ^= 0x10;
+    CHECK(writeFile(copyPath, flipped, flipped.size()) && !cascade.load(copyPath, source));
+
+    CHECK(writeFile(copyPath, bytes, bytes.size() - 4) && !cascade.load(copyPath, source));
+
+    std::vector<char> version = bytes;
+    version[VERSION_OFFSET] ^= 0x01;
+    CHECK(writeFile(copyPath, version, version.size()) && !cascade.load(copyPath, source));
+
+    CHECK(writeFile(copyPath, bytes, bytes.size()) && cascade.load(copyPath, source));
+    remove(copyPath.c_str());
+}
+
+int main(int argc, char *argv[]) {
+
+    const std::string dir = argc > 1 ? argv[1] : "../../main/res/raw";
+
+    std::vector<Mat> images;
+    images.push_back(syntheticFace(Size(320, 240), Point(160, 120), 1.5, 1));
+    images.push_back(syntheticFace(Size(640, 480), Point(250, 200), 2.5, 2));
+    images.push_back(syntheticFace(Size(97, 131), Point(48, 64), 0.8, 3));
+    for (int i = 2; i < argc; i++) {
+        Mat image = imread(argv[i], IMREAD_GRAYSCALE);
+        CHECK(!image.empty());
+        if (!image.empty()) {
+            images.push_back(image);
+        }
+    }
+
+    for (size_t c = 0; c < sizeof(CASCADES) / sizeof(CASCADES[0]); c++) {
+
+        const std::string path = dir + "/" + CASCADES[c];
+        const std::string binPath = path + ".test.bin";
+        const HaarCascade::Source source = sourceOf(path);
+
+        FileStorage fs(path, FileStorage::READ);
+        CascadeClassifier reference;
+        CHECK(fs.isOpened() && reference.read(fs.getFirstTopLevelNode()));
+        CHECK(HaarCascade::convert(fs.getFirstTopLevelNode(), binPath, source));
+        HaarCascade cascade;
+        CHECK(cascade.load(binPath, source));
+        if (cascade.empty() || reference.empty()) {
+            continue;
+        }
+        CHECK(cascade.getOriginalWindowSize() == reference.getOriginalWindowSize());
+
+        HaarCascade::Buffers buffers;
+        size_t candidates = 0, objects = 0;
+        for (size_t i = 0; i < images.size(); i++) {
+            for (int minNeighbors = 0; minNeighbors <= MIN_NEIGHBORS; minNeighbors += MIN_NEIGHBORS) {
+                std::vector<Rect> found, expected;
+                cascade.detectMultiScale(images[i], found, SCALE_FACTOR, minNeighbors, Size(), buffers);
+                reference.detectMultiScale(images[i], expected, SCALE_FACTOR, minNeighbors, CV_HAAR_SCALE_IMAGE, Size());
+                std::sort(found.begin(), found.end(), lessRect);
+                std::sort(expected.begin(), expected.end(), lessRect);
+                CHECK(found == expected);
+                (minNeighbors == 0 ? candidates : objects) += expected.size();
+            }
+        }
+        printf("%s: %zu candidates, %zu objects\n", CASCADES[c], candidates, objects);
+        CHECK(candidates > 0);
+
+        checkRejected(binPath, source);
+        remove(binPath.c_str());
+    }
+
+    return report("cascade_test");
+}
@@ -0,0 +1,114 @@
+//
+//  chirpz_test.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+//  Host test of ChirpZ: the float and double transforms against the exact DFT of the same
+//  samples at the zoomed band frequencies, on normalized pulse traces of the app's window
+//  lengths. Also checks that the plan cache returns the same spectrum when lengths alternate.
+//
+//    g++ -std=c++11 -O2 -I../../main/jni chirpz_test.cpp ../../main/jni/ChirpZ.cpp -o chirpz_test
+//        `pkg-config --cflags --libs opencv`
+//
+
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#include <opencv2/core/core.hpp>
+
+#include "harness.hpp"
+#include "ChirpZ.hpp"
+
+#define WINDOWS 200
+#define MIN_SAMPLES 60
+#define MAX_SAMPLES 300
+#define FPS 30
+#define LOW_BPM 40
+#define HIGH_BPM 240
+#define SEC_PER_MIN 60
+
+// Largest deviation from the exact DFT, relative to its peak
+#define MAX_FLOAT_DEVIATION 2.4e-7
+#define MAX_DOUBLE_DEVIATION 1e-12
+
+using namespace cv;
+
+// Normalized pulse in noise
+static Mat1d pulseTrace(int n, RNG &rng) {
+    Mat1d x(n, 1);
+    const double bpm = rng.uniform(50.0, 180.0), phase = rng.uniform(0.0, 2 * CV_PI);
+    for (int i = 0; i < n; i++) {
+        x(i, 0) = sin(2 * CV_PI * bpm / SEC_PER_MIN * i / FPS + phase) + rng.gaussian(0.3);
+    }
+    Scalar mean, stddev;
+    meanStdDev(x, mean, stddev);
+    x = (x - mean[0]) / stddev[0];
+    return x;
+}
+
+// Magnitudes at low + k / zoom bins by the definition, in double
+static Mat1d exactSpectrum(const Mat1d &x, int low, int high, int zoom) {
+    const int n = x.rows;
+    const int bins = (high - low) * zoom + 1;
+    Mat1d spectrum(bins, 1);
+    for (int k = 0; k < bins; k++) {
+        const double f = low + (double)k / zoom;
+        double re = 0, im = 0;
+        for (int j = 0; j < n; j++) {
+            const double angle = -2 * CV_PI * f * j / n;
+            re += x(j, 0) * cos(angle);
+            im += x(j, 0) * sin(angle);
+        }
+        spectrum(k, 0) = sqrt(re * re + im * im);
+    }
+    return spectrum;
+}
+
+static double peakDeviation(const Mat &spectrum, const Mat1d &exact) {
+    double peak;
+    minMaxLoc(exact, NULL, &peak);
+    return norm(spectrum, exact, NORM_INF) / peak;
+}
+
+int main() {
+
+    RNG rng(1);
+    ChirpZ czt;
+    double worstFloat = 0, worstDouble = 0;
+
+    for (int w = 0; w < WINDOWS; w++) {
+
+        const int n = rng.uniform(MIN_SAMPLES, MAX_SAMPLES + 1);
+        const int zoom = 2 << rng.uniform(0, 3);
+        const int low = std::min(n * LOW_BPM / SEC_PER_MIN / FPS, n / 2);
+        const int high = std::max(low, std::min(n * HIGH_BPM / SEC_PER_MIN / FPS + 1, n / 2));
+
+        const Mat1d x = pulseTrace(n, rng);
+        Mat1f xFloat;
+        x.convertTo(xFloat, CV_32F);
+        Mat1d xRounded;
+        xFloat.convertTo(xRounded, CV_64F);
+
+        // Each against the exact transform of its own samples
+        Mat spectrum;
+        czt.magnitude(xFloat, spectrum, low, high, zoom);
+        worstFloat = std::max(worstFloat, peakDeviation(spectrum, exactSpectrum(xRounded, low, high, zoom)));
+        czt.magnitude(x, spectrum, low, high, zoom);
+        const Mat1d exact = exactSpectrum(x, low, high, zoom);
+        worstDouble = std::max(worstDouble, peakDeviation(spectrum, exact));
+
+        // A cached plan after others were used
+        Mat other;
+        czt.magnitude(x.rowRange(0, n - 1), other, low, high, zoom);
+        czt.magnitude(x, other, low, high, zoom);
+        CHECK(norm(other, spectrum, NORM_INF) == 0);
+    }
+
+    printf("chirp-z over %d windows: float %.2g, double %.2g relative to the peak\n", WINDOWS, worstFloat, worstDouble);
+    CHECK_LE(worstFloat, MAX_FLOAT_DEVIATION);
+    CHECK_LE(worstDouble, MAX_DOUBLE_DEVIATION);
+
+    return report("chirpz_test");
+}
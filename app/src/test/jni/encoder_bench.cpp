@@ -0,0 +1,116 @@
+//
+//  encoder_bench.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+//  Recording throughput of FFmpegEncoder against its threading options, at 720p and 1080p:
+//  thread_count with frame threading at the app's preset, then thread_type against preset with
+//  one thread per core. Frames are synthetic RGBA camera frames written through WriteFrame as the
+//  app does; the time includes the conversion and flushing the buffered frames.
+//
+//    g++ -std=c++11 -O2 -msse2 -I../../main/jni encoder_bench.cpp ../../main/jni/FFmpegEncoder.cpp
+//        ../../main/jni/yuv.cpp -o encoder_bench
+//        `pkg-config --cflags --libs libavformat libavcodec libswscale libavutil`
+//
+//  Usage: encoder_bench output.mp4 [frames] 2>/dev/null (the encoder logs every frame)
+//
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <chrono>
+
+#include "FFmpegEncoder.hpp"
+
+#define FRAMERATE 30
+#define BITRATE 100000          // As in Main
+#define GOP_SIZE 30
+#define PRESET "ultrafast"
+#define PATTERNS 30             // Distinct frames, cycled
+
+struct Size {
+    int width;
+    int height;
+};
+
+// Moving gradient with noise, so that consecutive frames differ as camera frames do
+static std::vector<std::vector<uint8_t> > cameraFrames(int width, int height) {
+    std::vector<std::vector<uint8_t> > frames(PATTERNS, std::vector<uint8_t>(width * height * 4));
+    srand(1);
+    for (int f = 0; f < PATTERNS; f++) {
+        uint8_t *p = &frames[f][0];
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++, p += 4) {
+                const int noise = rand() % 16;
+                p[0] = (uint8_t)((x + 4 * f) * 255 / width + noise);
+                p[1] = (uint8_t)((y + 2 * f) * 255 / height + noise);
+                p[2] = (uint8_t)(((x + y) / 4 + 8 * f) + noise);
+                p[3] = 255;
+            }
+        }
+    }
+    return frames;
+}
+
+// Frames per second, negative if the encoder could not be opened
+static double encode(const char *filename, const std::vector<std::vector<uint8_t> > &frames, const Size &size,
+                     int count, int threads, int threadType, const char *preset) {
+
+    FFmpegEncoder encoder;
+    if (!encoder.OpenFile(filename, size.width, size.height, BITRATE, FRAMERATE,
+                          threads, threadType, GOP_SIZE, preset, 0, 0, false)) {
+        return -1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++) {
+        encoder.WriteFrame(const_cast<uint8_t *>(&frames[i % PATTERNS][0]), i * 1000 / FRAMERATE);
+    }
+    encoder.WriteBufferedFrames();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    encoder.CloseFile();
+    return count / elapsed.count();
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc < 2) {
+        fprintf(stderr, "Usage: encoder_bench output.mp4 [frames]\n");
+        return 1;
+    }
+    const char *filename = argv[1];
+    const int count = argc > 2 ? atoi(argv[2]) : 150;
+
+    const Size sizes[] = {{1280, 720}, {1920, 1080}};
+    const int threadCounts[] = {1, 2, 4, 8, 0};
+    const int threadTypes[] = {FF_THREAD_FRAME, FF_THREAD_SLICE, FF_THREAD_FRAME | FF_THREAD_SLICE};
+    const char *threadTypeNames[] = {"frame", "slice", "frame+slice"};
+    const char *presets[] = {"ultrafast", "superfast", "veryfast"};
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+
+        const std::vector<std::vector<uint8_t> > frames = cameraFrames(sizes[s].width, sizes[s].height);
+        printf("%dx%d, %d frames\n", sizes[s].width, sizes[s].height, count);
+
+        printf("  %-10s %-12s %-10s %8s\n", "threads", "type", "preset", "fps");
+        for (size_t t = 0; t < sizeof(threadCounts) / sizeof(threadCounts[0]); t++) {
+            const double fps = encode(filename, frames, sizes[s], count, threadCounts[t], FF_THREAD_FRAME, PRESET);
+            if (fps < 0) {
+                fprintf(stderr, "Could not open %s\n", filename);
+                return 1;
+            }
+            printf("  %-10d %-12s %-10s %8.1f\n", threadCounts[t], "frame", PRESET, fps);
+        }
+
+        for (size_t t = 0; t < sizeof(threadTypes) / sizeof(threadTypes[0]); t++) {
+            for (size_t p = 0; p < sizeof(presets) / sizeof(presets[0]); p++) {
+                const double fps = encode(filename, frames, sizes[s], count, 0, threadTypes[t], presets[p]);
+                printf("  %-10s %-12s %-10s %8.1f\n", "auto", threadTypeNames[t], presets[p], fps);
+            }
+        }
+    }
+
+    return 0;
+}
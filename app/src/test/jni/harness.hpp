@@ -0,0 +1,64 @@
+//
+//  harness.hpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+//  Checks and timing for the host tests and benchmarks in this directory.
+//  Each is a standalone program; tests exit with the number of failed checks.
+//
+
+#ifndef harness_hpp
+#define harness_hpp
+
+#include <stdio.h>
+#include <chrono>
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+#define CHECK_LE(value, bound) \
+    do { \
+        const double v_ = (value), b_ = (bound); \
+        if (!(v_ <= b_)) { \
+            fprintf(stderr, "%s:%d: %s = %g exceeds %g\n", __FILE__, __LINE__, #value, v_, b_); \
+            failures++; \
+        } \
+    } while (0)
+
+// Print the summary line and return the exit status
+static inline int report(const char *name) {
+    if (failures == 0) {
+        printf("%s: all checks passed\n", name);
+    } else {
+        printf("%s: %d checks failed\n", name, failures);
+    }
+    return failures;
+}
+
+// Best of repeats of the mean time per call, in milliseconds
+template <typename F>
+static double timeMs(F f, int calls, int repeats = 5) {
+    double best = 0;
+    for (int r = 0; r < repeats; r++) {
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < calls; i++) {
+            f();
+        }
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        const double ms = elapsed.count() / calls;
+        if (r == 0 || ms < best) {
+            best = ms;
+        }
+    }
+    return best;
+}
+
+#endif /* harness_hpp */
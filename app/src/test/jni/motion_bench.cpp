@@ -0,0 +1,72 @@
+//
+//  motion_bench.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+//  Cost of regressMotion per face and estimate over the window lengths of the app at 30 fps,
+//  on color traces with a pulse and a leak of the tracked head pose. Also shows how much of
+//  the leak is left, as the standard deviation of the trace before and after.
+//
+//    g++ -std=c++11 -O2 -msse2 -I../../main/jni motion_bench.cpp ../../main/jni/opencv.cpp
+//        ../../main/jni/signal.cpp ../../main/jni/skin.cpp -o motion_bench `pkg-config --cflags --libs opencv`
+//
+
+#include <math.h>
+
+#include <opencv2/core/core.hpp>
+
+#include "harness.hpp"
+#include "opencv.hpp"
+
+#define FPS 30
+#define CALLS 200
+#define MOTION_COLS 4       // Centre shift x and y, log scale, rotation, as in RPPG
+
+using namespace cv;
+
+// Green trace of a moving head: pulse, noise and the pose it drifted to
+static void movingTrace(int rows, Mat1d &s, Mat1d &motion) {
+    RNG rng(rows);
+    s = Mat1d(rows, 3);
+    motion = Mat1d(rows, MOTION_COLS);
+    double pose[MOTION_COLS] = {0};
+    for (int i = 0; i < rows; i++) {
+        const double t = (double)i / FPS;
+        double leak = 0;
+        for (int j = 0; j < MOTION_COLS; j++) {
+            motion(i, j) = rng.gaussian(0.01);
+            pose[j] += motion(i, j);
+            leak += 20 * pose[j];
+        }
+        for (int c = 0; c < 3; c++) {
+            s(i, c) = 0.5 * sin(2 * M_PI * 1.2 * t) + (c + 1) * leak + rng.gaussian(0.3);
+        }
+    }
+}
+
+static double deviation(const Mat &s) {
+    Scalar mean, stddev;
+    meanStdDev(s.col(1), mean, stddev);
+    return stddev[0];
+}
+
+int main() {
+
+    printf("Mean time per call, standard deviation of the green trace\n");
+    printf("%-8s %12s %10s %10s\n", "samples", "regress", "before", "after");
+
+    for (int seconds = 2; seconds <= 10; seconds += 2) {
+
+        const int rows = seconds * FPS;
+        Mat1d s, motion;
+        movingTrace(rows, s, motion);
+
+        Mat out;
+        const double ms = timeMs([&]() { regressMotion(s, motion, out); }, CALLS);
+
+        printf("%-8d %9.1f us %10.3f %10.3f\n", rows, ms * 1000, deviation(s), deviation(out));
+    }
+
+    return 0;
+}
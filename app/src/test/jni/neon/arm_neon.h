@@ -0,0 +1,225 @@
+//
+//  arm_neon.h
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+//  Scalar stand-in for the NEON intrinsics used by the *_neon.cpp kernels, so that the host
+//  tests can build them with -DHAVE_NEON -Ineon on a machine without NEON and check them against
+//  the scalar references. Each intrinsic follows the ARM definition lane by lane, including
+//  rounding, narrowing and saturation; float multiply-accumulate is not fused, as on
+//  armeabi-v7a. It covers only what the kernels use and checks nothing about timing.
+//
+
+#ifndef arm_neon_emulation_h
+#define arm_neon_emulation_h
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#error "Use the compiler's arm_neon.h on ARM"
+#endif
+
+#include <stdint.h>
+
+/* TYPES */
+
+#define NEON_VECTOR(type, lanes, name) \
+    typedef struct { type lane[lanes]; } name
+
+NEON_VECTOR(uint8_t, 8, uint8x8_t);
+NEON_VECTOR(uint8_t, 16, uint8x16_t);
+NEON_VECTOR(uint16_t, 8, uint16x8_t);
+NEON_VECTOR(int16_t, 8, int16x8_t);
+NEON_VECTOR(uint32_t, 4, uint32x4_t);
+NEON_VECTOR(uint64_t, 2, uint64x2_t);
+NEON_VECTOR(float, 2, float32x2_t);
+NEON_VECTOR(float, 4, float32x4_t);
+
+typedef struct { uint8x8_t val[2]; } uint8x8x2_t;
+typedef struct { uint8x8_t val[4]; } uint8x8x4_t;
+typedef struct { uint8x16_t val[2]; } uint8x16x2_t;
+typedef struct { uint8x16_t val[4]; } uint8x16x4_t;
+
+// Lane-wise operation into a new vector
+#define NEON_MAP(vec, lanes, expr) \
+    vec r; \
+    for (int i = 0; i < lanes; i++) { \
+        r.lane[i] = expr; \
+    } \
+    return r
+
+/* LOAD, STORE, DUPLICATE */
+
+#define NEON_MEMORY(suffix, type, lanes, vec) \
+    static inline vec vld1##suffix(const type *p) { NEON_MAP(vec, lanes, p[i]); } \
+    static inline void vst1##suffix(type *p, vec a) { \
+        for (int i = 0; i < lanes; i++) { \
+            p[i] = a.lane[i]; \
+        } \
+    }
+
+NEON_MEMORY(_u8, uint8_t, 8, uint8x8_t)
+NEON_MEMORY(q_u8, uint8_t, 16, uint8x16_t)
+NEON_MEMORY(q_u16, uint16_t, 8, uint16x8_t)
+NEON_MEMORY(q_f32, float, 4, float32x4_t)
+
+static inline uint8x8_t vdup_n_u8(uint8_t x) { NEON_MAP(uint8x8_t, 8, x); }
+static inline uint8x16_t vdupq_n_u8(uint8_t x) { NEON_MAP(uint8x16_t, 16, x); }
+static inline uint16x8_t vdupq_n_u16(uint16_t x) { NEON_MAP(uint16x8_t, 8, x); }
+static inline int16x8_t vdupq_n_s16(int16_t x) { NEON_MAP(int16x8_t, 8, x); }
+static inline uint32x4_t vdupq_n_u32(uint32_t x) { NEON_MAP(uint32x4_t, 4, x); }
+static inline uint64x2_t vdupq_n_u64(uint64_t x) { NEON_MAP(uint64x2_t, 2, x); }
+static inline float32x4_t vdupq_n_f32(float x) { NEON_MAP(float32x4_t, 4, x); }
+
+// Structure loads and stores de-interleave and interleave elements
+static inline uint8x8x4_t vld4_u8(const uint8_t *p) {
+    uint8x8x4_t r;
+    for (int i = 0; i < 8; i++) {
+        for (int k = 0; k < 4; k++) {
+            r.val[k].lane[i] = p[4 * i + k];
+        }
+    }
+    return r;
+}
+
+static inline uint8x16x4_t vld4q_u8(const uint8_t *p) {
+    uint8x16x4_t r;
+    for (int i = 0; i < 16; i++) {
+        for (int k = 0; k < 4; k++) {
+            r.val[k].lane[i] = p[4 * i + k];
+        }
+    }
+    return r;
+}
+
+static inline uint8x16x2_t vld2q_u8(const uint8_t *p) {
+    uint8x16x2_t r;
+    for (int i = 0; i < 16; i++) {
+        for (int k = 0; k < 2; k++) {
+            r.val[k].lane[i] = p[2 * i + k];
+        }
+    }
+    return r;
+}
+
+static inline void vst2q_u8(uint8_t *p, uint8x16x2_t a) {
+    for (int i = 0; i < 16; i++) {
+        for (int k = 0; k < 2; k++) {
+            p[2 * i + k] = a.val[k].lane[i];
+        }
+    }
+}
+
+/* LANES, HALVES, REINTERPRETATION */
+
+static inline uint8x8_t vget_low_u8(uint8x16_t a) { NEON_MAP(uint8x8_t, 8, a.lane[i]); }
+static inline uint8x8_t vget_high_u8(uint8x16_t a) { NEON_MAP(uint8x8_t, 8, a.lane[i + 8]); }
+static inline float32x2_t vget_low_f32(float32x4_t a) { NEON_MAP(float32x2_t, 2, a.lane[i]); }
+static inline float32x2_t vget_high_f32(float32x4_t a) { NEON_MAP(float32x2_t, 2, a.lane[i + 2]); }
+static inline uint8x16_t vcombine_u8(uint8x8_t a, uint8x8_t b) { NEON_MAP(uint8x16_t, 16, i < 8 ? a.lane[i] : b.lane[i - 8]); }
+
+#define vget_lane_f32(a, n) ((a).lane[n])
+#define vgetq_lane_u32(a, n) ((a).lane[n])
+#define vgetq_lane_u64(a, n) ((a).lane[n])
+
+static inline uint16x8_t vreinterpretq_u16_u8(uint8x16_t a) {
+    NEON_MAP(uint16x8_t, 8, (uint16_t)(a.lane[2 * i] | a.lane[2 * i + 1] << 8));     // Little endian
+}
+static inline int16x8_t vreinterpretq_s16_u16(uint16x8_t a) { NEON_MAP(int16x8_t, 8, (int16_t)a.lane[i]); }
+static inline uint16x8_t vreinterpretq_u16_s16(int16x8_t a) { NEON_MAP(uint16x8_t, 8, (uint16_t)a.lane[i]); }
+
+static inline uint8x8x2_t vzip_u8(uint8x8_t a, uint8x8_t b) {
+    uint8x8x2_t r;
+    for (int i = 0; i < 16; i++) {
+        r.val[i / 8].lane[i % 8] = (i & 1) ? b.lane[i / 2] : a.lane[i / 2];
+    }
+    return r;
+}
+
+static inline uint8x16_t vrev16q_u8(uint8x16_t a) { NEON_MAP(uint8x16_t, 16, a.lane[i ^ 1]); }
+
+/* INTEGER ARITHMETIC */
+
+static inline uint8x8_t vadd_u8(uint8x8_t a, uint8x8_t b) { NEON_MAP(uint8x8_t, 8, (uint8_t)(a.lane[i] + b.lane[i])); }
+static inline uint16x8_t vaddq_u16(uint16x8_t a, uint16x8_t b) { NEON_MAP(uint16x8_t, 8, (uint16_t)(a.lane[i] + b.lane[i])); }
+static inline int16x8_t vaddq_s16(int16x8_t a, int16x8_t b) { NEON_MAP(int16x8_t, 8, (int16_t)(a.lane[i] + b.lane[i])); }
+
+static inline uint16x8_t vmovl_u8(uint8x8_t a) { NEON_MAP(uint16x8_t, 8, a.lane[i]); }
+static inline uint16x8_t vmull_u8(uint8x8_t a, uint8x8_t b) { NEON_MAP(uint16x8_t, 8, (uint16_t)(a.lane[i] * b.lane[i])); }
+static inline uint16x8_t vmlal_u8(uint16x8_t acc, uint8x8_t a, uint8x8_t b) {
+    NEON_MAP(uint16x8_t, 8, (uint16_t)(acc.lane[i] + a.lane[i] * b.lane[i]));
+}
+static inline int16x8_t vmulq_n_s16(int16x8_t a, int16_t b) { NEON_MAP(int16x8_t, 8, (int16_t)(a.lane[i] * b)); }
+static inline int16x8_t vmlaq_n_s16(int16x8_t acc, int16x8_t a, int16_t b) {
+    NEON_MAP(int16x8_t, 8, (int16_t)(acc.lane[i] + a.lane[i] * b));
+}
+
+// Pairwise widening add, and accumulate
+static inline uint16x8_t vpaddlq_u8(uint8x16_t a) { NEON_MAP(uint16x8_t, 8, (uint16_t)(a.lane[2 * i] + a.lane[2 * i + 1])); }
+static inline uint32x4_t vpaddlq_u16(uint16x8_t a) { NEON_MAP(uint32x4_t, 4, (uint32_t)a.lane[2 * i] + a.lane[2 * i + 1]); }
+static inline uint16x8_t vpadalq_u8(uint16x8_t acc, uint8x16_t a) {
+    NEON_MAP(uint16x8_t, 8, (uint16_t)(acc.lane[i] + a.lane[2 * i] + a.lane[2 * i + 1]));
+}
+static inline uint32x4_t vpadalq_u16(uint32x4_t acc, uint16x8_t a) {
+    NEON_MAP(uint32x4_t, 4, acc.lane[i] + a.lane[2 * i] + a.lane[2 * i + 1]);
+}
+static inline uint64x2_t vpadalq_u32(uint64x2_t acc, uint32x4_t a) {
+    NEON_MAP(uint64x2_t, 2, acc.lane[i] + a.lane[2 * i] + a.lane[2 * i + 1]);
+}
+
+/* SHIFTS AND NARROWING */
+
+static inline uint8x16_t vshrq_n_u8(uint8x16_t a, int n) { NEON_MAP(uint8x16_t, 16, (uint8_t)(a.lane[i] >> n)); }
+static inline uint16x8_t vshrq_n_u16(uint16x8_t a, int n) { NEON_MAP(uint16x8_t, 8, (uint16_t)(a.lane[i] >> n)); }
+static inline int16x8_t vshrq_n_s16(int16x8_t a, int n) { NEON_MAP(int16x8_t, 8, (int16_t)(a.lane[i] >> n)); }
+static inline uint16x8_t vshlq_n_u16(uint16x8_t a, int n) { NEON_MAP(uint16x8_t, 8, (uint16_t)(a.lane[i] << n)); }
+
+// Rounding shifts add half the divisor first, without overflow
+static inline uint16x8_t vrshrq_n_u16(uint16x8_t a, int n) {
+    NEON_MAP(uint16x8_t, 8, (uint16_t)(((uint32_t)a.lane[i] + (1u << (n - 1))) >> n));
+}
+static inline int16x8_t vrshrq_n_s16(int16x8_t a, int n) {
+    NEON_MAP(int16x8_t, 8, (int16_t)(((int32_t)a.lane[i] + (1 << (n - 1))) >> n));
+}
+static inline uint8x8_t vrshrn_n_u16(uint16x8_t a, int n) {
+    NEON_MAP(uint8x8_t, 8, (uint8_t)(((uint32_t)a.lane[i] + (1u << (n - 1))) >> n));
+}
+static inline uint8x8_t vqmovun_s16(int16x8_t a) {
+    NEON_MAP(uint8x8_t, 8, (uint8_t)(a.lane[i] < 0 ? 0 : a.lane[i] > 255 ? 255 : a.lane[i]));
+}
+
+/* LOGIC AND COMPARISONS */
+
+static inline uint8x16_t vandq_u8(uint8x16_t a, uint8x16_t b) { NEON_MAP(uint8x16_t, 16, a.lane[i] & b.lane[i]); }
+static inline uint16x8_t vandq_u16(uint16x8_t a, uint16x8_t b) { NEON_MAP(uint16x8_t, 8, a.lane[i] & b.lane[i]); }
+static inline uint16x8_t vorrq_u16(uint16x8_t a, uint16x8_t b) { NEON_MAP(uint16x8_t, 8, a.lane[i] | b.lane[i]); }
+
+static inline uint8x16_t vcgeq_u8(uint8x16_t a, uint8x16_t b) { NEON_MAP(uint8x16_t, 16, a.lane[i] >= b.lane[i] ? 0xFF : 0); }
+static inline uint8x16_t vcleq_u8(uint8x16_t a, uint8x16_t b) { NEON_MAP(uint8x16_t, 16, a.lane[i] <= b.lane[i] ? 0xFF : 0); }
+static inline uint16x8_t vcgeq_u16(uint16x8_t a, uint16x8_t b) { NEON_MAP(uint16x8_t, 8, a.lane[i] >= b.lane[i] ? 0xFFFF : 0); }
+static inline uint16x8_t vcleq_u16(uint16x8_t a, uint16x8_t b) { NEON_MAP(uint16x8_t, 8, a.lane[i] <= b.lane[i] ? 0xFFFF : 0); }
+
+/* FLOAT ARITHMETIC */
+
+// Products are rounded before they are added, volatile keeps the compiler from fusing them
+static inline float neon_mul(float a, float b) {
+    volatile float p = a * b;
+    return p;
+}
+
+static inline float32x2_t vadd_f32(float32x2_t a, float32x2_t b) { NEON_MAP(float32x2_t, 2, a.lane[i] + b.lane[i]); }
+static inline float32x2_t vpadd_f32(float32x2_t a, float32x2_t b) { NEON_MAP(float32x2_t, 2, i ? b.lane[0] + b.lane[1] : a.lane[0] + a.lane[1]); }
+static inline float32x4_t vaddq_f32(float32x4_t a, float32x4_t b) { NEON_MAP(float32x4_t, 4, a.lane[i] + b.lane[i]); }
+static inline float32x4_t vsubq_f32(float32x4_t a, float32x4_t b) { NEON_MAP(float32x4_t, 4, a.lane[i] - b.lane[i]); }
+static inline float32x4_t vmulq_f32(float32x4_t a, float32x4_t b) { NEON_MAP(float32x4_t, 4, neon_mul(a.lane[i], b.lane[i])); }
+static inline float32x4_t vmulq_n_f32(float32x4_t a, float b) { NEON_MAP(float32x4_t, 4, neon_mul(a.lane[i], b)); }
+static inline float32x4_t vmlaq_f32(float32x4_t acc, float32x4_t a, float32x4_t b) {
+    NEON_MAP(float32x4_t, 4, acc.lane[i] + neon_mul(a.lane[i], b.lane[i]));
+}
+static inline float32x4_t vmlaq_n_f32(float32x4_t acc, float32x4_t a, float b) {
+    NEON_MAP(float32x4_t, 4, acc.lane[i] + neon_mul(a.lane[i], b));
+}
+static inline float32x4_t vmlsq_f32(float32x4_t acc, float32x4_t a, float32x4_t b) {
+    NEON_MAP(float32x4_t, 4, acc.lane[i] - neon_mul(a.lane[i], b.lane[i]));
+}
+
+#endif /* arm_neon_emulation_h */
@@ -0,0 +1,124 @@
+//
+//  pipeline_bench.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+//  The compile-time filter pipeline against the Mat-based chain of opencv.cpp it replaced
+//  (denoise, normalization, detrend, movingAverage), over the window lengths of the app at 30 fps.
+//  Both start from the raw trace on every call; the largest difference of their outputs is shown.
+//
+//    g++ -std=c++11 -O2 -msse2 -I../../main/jni pipeline_bench.cpp ../../main/jni/opencv.cpp
+//        ../../main/jni/signal.cpp ../../main/jni/skin.cpp -o pipeline_bench `pkg-config --cflags --libs opencv`
+//
+
+#include <math.h>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "harness.hpp"
+#include "opencv.hpp"
+#include "pipeline.hpp"
+
+#define FPS 30
+#define CALLS 200
+#define PASSES 3        // Moving average passes, as in RPPG
+
+using namespace cv;
+
+// Raw color means of a face: pulse, drift, noise and a rescan step
+static Mat1d rawTrace(int rows, Mat1b &jumps) {
+    Mat1d s(rows, 3);
+    RNG rng(rows);
+    jumps = Mat1b(rows, 1, (uchar)0);
+    for (int i = 0; i < rows; i++) {
+        const double t = (double)i / FPS;
+        const double step = i >= rows / 2 ? 4 : 0;
+        for (int c = 0; c < 3; c++) {
+            s(i, c) = 120 + 10 * c + 0.5 * sin(2 * M_PI * 1.2 * t) + 3 * t + step + rng.gaussian(0.3);
+        }
+    }
+    jumps(rows / 2, 0) = 1;
+    return s;
+}
+
+static double maxDiff(const Mat &a, const Mat &b) {
+    Mat a64, b64;
+    a.convertTo(a64, CV_64F);
+    b.convertTo(b64, CV_64F);
+    return norm(a64.reshape(1), b64.reshape(1), NORM_INF);
+}
+
+static pipeline::Context context(const Mat1b &jumps) {
+    pipeline::Context context;
+    context.jumps = jumps.ptr<uint8_t>(0);
+    context.lambda = FPS;
+    context.window = (int)fmax(floor(FPS / 6), 2);
+    context.passes = PASSES;
+    return context;
+}
+
+template <int C, typename T, template <int, typename> class... Stages>
+static double runPipeline(const Mat1d &raw, const Mat1b &jumps, Mat &out) {
+    pipeline::Context ctx = context(jumps);
+    Mat_<T> s(raw.rows, C);
+    const double ms = timeMs([&]() {
+        pipeline::load<C, T>(raw[0] + (C == 1 ? 1 : 0), (int)raw.step1(), raw.rows, s[0]);
+        pipeline::Trace<C, T> trace(s[0], s.rows);
+        pipeline::Pipeline<C, T, Stages...>::run(trace, ctx);
+    }, CALLS);
+    out = s;
+    return ms;
+}
+
+int main() {
+
+    const int window = (int)fmax(floor(FPS / 6), 2);
+
+    printf("Mean time per call in microseconds, max difference to the Mat chain\n");
+    printf("%-8s %12s %12s %12s %10s %12s %12s %10s\n", "samples",
+           "1ch mat", "1ch double", "1ch float", "diff", "3ch mat", "3ch double", "diff");
+
+    for (int seconds = 2; seconds <= 10; seconds += 2) {
+
+        const int rows = seconds * FPS;
+        Mat1b jumps;
+        const Mat1d raw = rawTrace(rows, jumps);
+
+        // Green alone: denoise, normalize, detrend, moving average
+        Mat green;
+        const double greenMat = timeMs([&]() {
+            Mat s_den(rows, 1, CV_64F), s_det(rows, 1, CV_64F), s_mav(rows, 1, CV_64F);
+            denoise(raw.col(1), jumps, s_den);
+            normalization(s_den, s_den);
+            detrend(s_den, s_det, FPS);
+            movingAverage(s_det, s_mav, PASSES, window);
+            green = s_mav;
+        }, CALLS);
+        Mat greenDouble, greenFloat;
+        const double pipeDouble = runPipeline<1, double, pipeline::Denoise, pipeline::Normalize,
+                                              pipeline::Detrend, pipeline::MovingAverage>(raw, jumps, greenDouble);
+        const double pipeFloat = runPipeline<1, float, pipeline::Denoise, pipeline::Normalize,
+                                             pipeline::Detrend, pipeline::MovingAverage>(raw, jumps, greenFloat);
+
+        // All channels: denoise, normalize, detrend
+        Mat rgb;
+        const double rgbMat = timeMs([&]() {
+            Mat s_den(rows, 3, CV_64F), s_det(rows, 3, CV_64F);
+            denoise(raw, jumps, s_den);
+            normalization(s_den, s_den);
+            detrend(s_den, s_det, FPS);
+            rgb = s_det;
+        }, CALLS);
+        Mat rgbDouble;
+        const double pipeRgb = runPipeline<3, double, pipeline::Denoise, pipeline::Normalize,
+                                           pipeline::Detrend>(raw, jumps, rgbDouble);
+
+        printf("%-8d %12.1f %12.1f %12.1f %10.2g %12.1f %12.1f %10.2g\n", rows,
+               greenMat * 1000, pipeDouble * 1000, pipeFloat * 1000, maxDiff(green, greenDouble),
+               rgbMat * 1000, pipeRgb * 1000, maxDiff(rgb, rgbDouble));
+    }
+
+    return 0;
+}
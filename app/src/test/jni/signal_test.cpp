@@ -0,0 +1,275 @@
+//
+//  signal_test.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+//  Host test of the single-precision signal path: the pipeline stages, normalizeSamples and
+//  bandMagnitudes in float against the same computation in double, on randomized windows
+//  like those of the app, and the SSE2/AVX/NEON kernels of signal.cpp against the scalar ones.
+//
+//    g++ -std=c++11 -O2 -msse2 -I../../main/jni signal_test.cpp ../../main/jni/signal.cpp -o signal_test
+//
+//  The NEON kernels build on hosts without NEON against the scalar intrinsics in neon/:
+//
+//    g++ -std=c++11 -O2 -DHAVE_NEON -Ineon -I../../main/jni signal_test.cpp ../../main/jni/signal.cpp
+//        ../../main/jni/signal_neon.cpp -o signal_test_neon
+//
+
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#include "harness.hpp"
+#include "pipeline.hpp"
+#include "signal.hpp"
+
+#define WINDOWS 200
+#define MIN_SAMPLES 60
+#define MAX_SAMPLES 300
+#define FPS 30
+#define LOW_BPM 40
+#define HIGH_BPM 240
+#define SEC_PER_MIN 60
+#define ZOOM 8
+
+// Largest deviation of the float path from the double path
+#define MAX_TRACE_DEVIATION 1.2e-5          // Green trace after all stages
+#define MAX_RGB_DEVIATION 3.5e-5            // Three channels after denoise, normalize and detrend
+#define MAX_SPECTRUM_DEVIATION 1.4e-5       // Band spectrum of the green trace, relative to its peak
+#define MAX_NORMALIZE_DEVIATION 5e-6        // normalizeSamples alone
+
+// Largest deviation of the vector kernels from the scalar ones. The box filter adds in the same
+// order; the band DFT too, but NEON may fuse its multiply-adds
+#define MAX_NORMALIZE_KERNEL_DEVIATION 3.3e-6
+#define MAX_MAGNITUDE_KERNEL_DEVIATION 1e-5     // Relative to the largest magnitude
+
+static double uniform(double a, double b) {
+    return a + (b - a) * rand() / RAND_MAX;
+}
+
+static double gaussian(double sigma) {
+    // Box-Muller
+    const double u = uniform(1e-12, 1), v = uniform(0, 1);
+    return sigma * sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+// Raw color means of a face over one window: pulse, drift, noise and a detection jump
+struct Window {
+    int n;
+    std::vector<double> rgb;        // n x 3
+    std::vector<uint8_t> jumps;
+};
+
+static Window randomWindow() {
+    Window w;
+    w.n = MIN_SAMPLES + rand() % (MAX_SAMPLES - MIN_SAMPLES + 1);
+    w.rgb.resize(w.n * 3);
+    w.jumps.assign(w.n, 0);
+    const int jump = 1 + rand() % (w.n - 1);
+    w.jumps[jump] = 1;
+    const double bpm = uniform(50, 180), phase = uniform(0, 2 * M_PI);
+    double level[3], drift[3], step[3];
+    for (int c = 0; c < 3; c++) {
+        level[c] = uniform(60, 200);
+        drift[c] = uniform(-2, 2);
+        step[c] = uniform(-10, 10);
+    }
+    for (int i = 0; i < w.n; i++) {
+        const double t = (double)i / FPS;
+        const double pulse = sin(2 * M_PI * bpm / SEC_PER_MIN * t + phase);
+        for (int c = 0; c < 3; c++) {
+            w.rgb[i * 3 + c] = level[c] + (c == 1 ? 0.6 : 0.3) * pulse + drift[c] * t
+                               + (i >= jump ? step[c] : 0) + gaussian(0.2);
+        }
+    }
+    return w;
+}
+
+static pipeline::Context context(const Window &w) {
+    pipeline::Context context;
+    context.jumps = &w.jumps[0];
+    context.lambda = FPS;
+    context.window = (int)fmax(floor(FPS / 6.0), 2);
+    context.passes = 3;
+    return context;
+}
+
+// Green trace through all stages in the sample type T, loaded as in RPPG
+template <typename T>
+static std::vector<T> greenTrace(const Window &w) {
+    std::vector<T> s(w.n);
+    pipeline::load<1, T>(&w.rgb[1], 3, w.n, &s[0]);
+    pipeline::Context ctx = context(w);
+    pipeline::Trace<1, T> trace(&s[0], w.n);
+    pipeline::Pipeline<1, T, pipeline::Denoise, pipeline::Normalize, pipeline::Detrend, pipeline::MovingAverage>::run(trace, ctx);
+    return s;
+}
+
+// All channels through the shared stages in the sample type T
+template <typename T>
+static std::vector<T> rgbTrace(const Window &w) {
+    std::vector<T> s(w.n * 3);
+    pipeline::load<3, T>(&w.rgb[0], 3, w.n, &s[0]);
+    pipeline::Context ctx = context(w);
+    pipeline::Trace<3, T> trace(&s[0], w.n);
+    pipeline::Pipeline<3, T, pipeline::Denoise, pipeline::Normalize, pipeline::Detrend>::run(trace, ctx);
+    return s;
+}
+
+// Band magnitudes in double, as zoomSpectrum
+static std::vector<double> bandMagnitudesDouble(const std::vector<double> &x, int low, int zoom, int bins) {
+    const int n = (int)x.size();
+    std::vector<double> magnitude(bins);
+    for (int j = 0; j < bins; j++) {
+        const double w = -2 * M_PI * (low + (double)j / zoom) / n;
+        const double cw = cos(w), sw = sin(w);
+        double re = 0, im = 0, pr = 1, pi = 0;
+        for (int i = 0; i < n; i++) {
+            re += x[i] * pr;
+            im += x[i] * pi;
+            const double t = pr * cw - pi * sw;
+            pi = pr * sw + pi * cw;
+            pr = t;
+        }
+        magnitude[j] = sqrt(re * re + im * im);
+    }
+    return magnitude;
+}
+
+template <typename A, typename B>
+static double maxDeviation(const std::vector<A> &a, const std::vector<B> &b) {
+    double worst = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        worst = std::max(worst, fabs((double)a[i] - (double)b[i]));
+    }
+    return worst;
+}
+
+static void checkFloatPath() {
+
+    double trace = 0, rgb = 0, spectrum = 0, normalize = 0;
+    int peakChanged = 0;
+
+    for (int k = 0; k < WINDOWS; k++) {
+
+        const Window w = randomWindow();
+
+        const std::vector<double> green = greenTrace<double>(w);
+        const std::vector<float> greenFloat = greenTrace<float>(w);
+        trace = std::max(trace, maxDeviation(greenFloat, green));
+
+        rgb = std::max(rgb, maxDeviation(rgbTrace<float>(w), rgbTrace<double>(w)));
+
+        // Band spectrum of the filtered green trace, each from its own precision
+        const int n = w.n;
+        const int low = std::min(n * LOW_BPM / SEC_PER_MIN / FPS, n / 2);
+        const int high = std::max(low, std::min(n * HIGH_BPM / SEC_PER_MIN / FPS + 1, n / 2));
+        const int bins = (high - low) * ZOOM + 1;
+        const std::vector<double> reference = bandMagnitudesDouble(green, low, ZOOM, bins);
+        std::vector<float> magnitude(bins);
+        bandMagnitudes(&greenFloat[0], n, low, ZOOM, bins, &magnitude[0]);
+        const size_t peak = std::max_element(reference.begin(), reference.end()) - reference.begin();
+        const size_t peakFloat = std::max_element(magnitude.begin(), magnitude.end()) - magnitude.begin();
+        spectrum = std::max(spectrum, maxDeviation(magnitude, reference) / reference[peak]);
+        peakChanged += peak != peakFloat;
+
+        // Normalization alone, of the same float samples loaded as in RPPG
+        std::vector<float> x(n);
+        std::vector<double> y(n);
+        pipeline::load<1, float>(&w.rgb[0], 3, n, &x[0]);
+        double sum = 0, sumSq = 0;
+        for (int i = 0; i < n; i++) {
+            y[i] = x[i];
+            sum += y[i];
+            sumSq += y[i] * y[i];
+        }
+        const double mean = sum / n, stddev = sqrt(std::max(sumSq / n - mean * mean, 0.0));
+        for (int i = 0; i < n; i++) {
+            y[i] = (y[i] - mean) / stddev;
+        }
+        normalizeSamples(&x[0], n);
+        normalize = std::max(normalize, maxDeviation(x, y));
+    }
+
+    printf("float path over %d windows: trace %.2g, rgb %.2g, spectrum %.2g, normalize %.2g, peak changed %d\n",
+           WINDOWS, trace, rgb, spectrum, normalize, peakChanged);
+    CHECK_LE(trace, MAX_TRACE_DEVIATION);
+    CHECK_LE(rgb, MAX_RGB_DEVIATION);
+    CHECK_LE(spectrum, MAX_SPECTRUM_DEVIATION);
+    CHECK_LE(normalize, MAX_NORMALIZE_DEVIATION);
+    CHECK(peakChanged == 0);
+}
+
+// Samples as the kernels get them, relative to the first raw sample
+static std::vector<float> noise(int n) {
+    std::vector<float> x(n);
+    for (int i = 0; i < n; i++) {
+        x[i] = (float)gaussian(1) + 2;
+    }
+    return x;
+}
+
+static void checkKernels(const char *name, NormalizeSamples normalize, BoxFilterSamples boxFilter, BandMagnitudes magnitudes) {
+
+    double normalizeDeviation = 0, magnitudeDeviation = 0;
+    for (int n = 2; n <= MAX_SAMPLES; n += 7) {
+
+        std::vector<float> a = noise(n), b = a;
+        normalize(&a[0], n);
+        normalizeSamples_c(&b[0], n);
+        normalizeDeviation = std::max(normalizeDeviation, maxDeviation(a, b));
+
+        for (int window = 2; window <= 6; window++) {
+            const std::vector<float> padded = noise(n + window - 1);
+            for (int x = 0; x < std::min(n, 5); x++) {
+                std::vector<float> dst(n, 0), dst_c(n, 0);
+                boxFilter(&padded[0], &dst[0], x, n, window);
+                boxFilterSamples_c(&padded[0], &dst_c[0], x, n, window);
+                CHECK(dst == dst_c);
+            }
+        }
+
+        const int bins = 1 + rand() % 40;
+        std::vector<float> cw(bins), sw(bins);
+        for (int j = 0; j < bins; j++) {
+            const double w = -2 * M_PI * uniform(0, n / 2.0) / n;
+            cw[j] = (float)cos(w);
+            sw[j] = (float)sin(w);
+        }
+        for (int j = 0; j < std::min(bins, 5); j++) {
+            std::vector<float> m(bins, 0), m_c(bins, 0);
+            magnitudes(&a[0], n, &cw[0], &sw[0], &m[0], j, bins);
+            bandMagnitudes_c(&a[0], n, &cw[0], &sw[0], &m_c[0], j, bins);
+            const double peak = *std::max_element(m_c.begin(), m_c.end());
+            magnitudeDeviation = std::max(magnitudeDeviation, maxDeviation(m, m_c) / peak);
+        }
+    }
+
+    printf("%s kernels: normalize %.2g, band DFT %.2g\n", name, normalizeDeviation, magnitudeDeviation);
+    CHECK_LE(normalizeDeviation, MAX_NORMALIZE_KERNEL_DEVIATION);
+    CHECK_LE(magnitudeDeviation, MAX_MAGNITUDE_KERNEL_DEVIATION);
+}
+
+int main(int argc, char *argv[]) {
+
+    srand(argc > 1 ? atoi(argv[1]) : 1);
+    checkFloatPath();
+
+#if defined(__SSE2__)
+    checkKernels("SSE2", normalizeSamples_sse2, boxFilterSamples_sse2, bandMagnitudes_sse2);
+#endif
+#if defined(HAVE_AVX)
+    if (hasAvx()) {
+        checkKernels("AVX", normalizeSamples_avx, boxFilterSamples_avx, bandMagnitudes_avx);
+    } else {
+        printf("AVX kernels not checked, the CPU has no AVX\n");
+    }
+#endif
+#if defined(HAVE_NEON)
+    checkKernels("NEON", normalizeSamples_neon, boxFilterSamples_neon, bandMagnitudes_neon);
+#endif
+
+    return report("signal_test");
+}
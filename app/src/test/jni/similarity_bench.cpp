@@ -0,0 +1,110 @@
+//
+//  similarity_bench.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+//  estimateSimilarity against estimateRigidTransform (similarity mode), which trackFace used before,
+//  on tracked corners with noise and outliers: time per call and error against the true motion.
+//
+//    g++ -std=c++11 -O2 -I../../main/jni similarity_bench.cpp ../../main/jni/similarity.cpp -o similarity_bench
+//        `pkg-config --cflags --libs opencv`
+//
+//  Usage: similarity_bench [points] [outliers]
+//
+
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/video/video.hpp>
+
+#include "harness.hpp"
+#include "similarity.hpp"
+
+#define TRIALS 200          // Random motions
+#define CALLS 20            // Timed calls per motion
+#define NOISE 0.5           // Tracking noise in pixels
+#define FACE_SIZE 200       // Corners are spread over the face box
+
+using namespace cv;
+
+struct Error {
+    double scale, rotation, translation;
+    int failed;
+    Error() : scale(0), rotation(0), translation(0), failed(0) {;}
+};
+
+static void accumulate(Error &error, const Similarity &truth, const Similarity &estimate) {
+    error.scale += fabs(estimate.scale() - truth.scale());
+    error.rotation += fabs(estimate.rotation() - truth.rotation());
+    error.translation += hypot(estimate.tx - truth.tx, estimate.ty - truth.ty);
+}
+
+static void print(const char *name, double ms, const Error &error, int trials) {
+    const int valid = std::max(trials - error.failed, 1);
+    printf("  %-24s %8.2f us   scale %.5f   rotation %.5f rad   translation %.3f px   failed %d\n",
+           name, ms * 1000, error.scale / valid, error.rotation / valid, error.translation / valid, error.failed);
+}
+
+int main(int argc, char *argv[]) {
+
+    const int points = argc > 1 ? atoi(argv[1]) : 10;
+    const int outliers = argc > 2 ? atoi(argv[2]) : 2;
+
+    RNG rng(1);
+    Error closedError, rigidError;
+    double closedMs = 0, rigidMs = 0;
+
+    for (int t = 0; t < TRIALS; t++) {
+
+        // Frame to frame head motion
+        Similarity truth;
+        const double scale = 1 + rng.uniform(-0.03, 0.03);
+        const double angle = rng.uniform(-0.05, 0.05);
+        truth.a = scale * cos(angle);
+        truth.b = scale * sin(angle);
+        truth.tx = rng.uniform(-8.0, 8.0);
+        truth.ty = rng.uniform(-8.0, 8.0);
+
+        std::vector<Point2f> src(points), dst(points);
+        for (int i = 0; i < points; i++) {
+            src[i] = Point2f(rng.uniform(0.f, (float)FACE_SIZE), rng.uniform(0.f, (float)FACE_SIZE));
+            dst[i] = truth.apply(src[i]) + Point2f((float)rng.gaussian(NOISE), (float)rng.gaussian(NOISE));
+            if (i < outliers) {
+                // Corner lost to the background
+                dst[i] += Point2f(rng.uniform(-30.f, 30.f), rng.uniform(-30.f, 30.f));
+            }
+        }
+
+        Similarity closed;
+        bool ok = false;
+        closedMs += timeMs([&]() { ok = estimateSimilarity(src, dst, closed); }, CALLS, 1);
+        if (ok) {
+            accumulate(closedError, truth, closed);
+        } else {
+            closedError.failed++;
+        }
+
+        Mat transform;
+        rigidMs += timeMs([&]() { transform = estimateRigidTransform(src, dst, false); }, CALLS, 1);
+        if (!transform.empty()) {
+            Similarity rigid;
+            rigid.a = transform.at<double>(0, 0);
+            rigid.b = transform.at<double>(1, 0);
+            rigid.tx = transform.at<double>(0, 2);
+            rigid.ty = transform.at<double>(1, 2);
+            accumulate(rigidError, truth, rigid);
+        } else {
+            rigidError.failed++;
+        }
+    }
+
+    printf("%d points, %d outliers, %d motions, mean time per call and mean absolute error\n", points, outliers, TRIALS);
+    print("estimateSimilarity", closedMs / TRIALS, closedError, TRIALS);
+    print("estimateRigidTransform", rigidMs / TRIALS, rigidError, TRIALS);
+
+    return 0;
+}
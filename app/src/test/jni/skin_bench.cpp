@@ -0,0 +1,141 @@
+//
+//  skin_bench.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+//  Cost of the skin sums per frame for both frame formats, each row kernel on a whole 720p and
+//  1080p frame and on a face box of a third of the frame height. Pixels are a mix of skin and
+//  other colors, so that the scalar kernels pay for their branches as on camera frames.
+//
+//    g++ -std=c++11 -O2 -msse2 -I../../main/jni skin_bench.cpp ../../main/jni/skin.cpp -o skin_bench
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "harness.hpp"
+#include "skin.hpp"
+
+#define CALLS 20
+
+struct Size {
+    int width;
+    int height;
+};
+
+// Half of the pixels skin colored, the rest random
+static void fillRGBA(std::vector<uint8_t> &rgba, int pixels) {
+    const uint8_t *table = skinChromaTable();
+    rgba.resize(4 * pixels + 16);
+    for (int i = 0; i < pixels; i++) {
+        uint8_t *p = &rgba[4 * i];
+        const bool skin = rand() % 2 != 0;
+        do {
+            p[0] = (uint8_t)(rand() % 256);
+            p[1] = (uint8_t)(rand() % 256);
+            p[2] = (uint8_t)(rand() % 256);
+            p[3] = 255;
+            SkinSums sums;
+            memset(&sums, 0, sizeof(sums));
+            skinSumsRowRGBA_c(p, table, 0, 1, sums);
+            if ((sums.count != 0) == skin) {
+                break;
+            }
+        } while (true);
+    }
+}
+
+// Luma in range, half of the VU pairs in the skin cluster
+static void fillNV21(std::vector<uint8_t> &nv21, int width, int height) {
+    const uint8_t *table = skinChromaTable();
+    nv21.resize(width * height * 3 / 2 + 16);
+    for (int i = 0; i < width * height; i++) {
+        nv21[i] = (uint8_t)(SKIN_MIN_LUMA + rand() % (SKIN_MAX_LUMA - SKIN_MIN_LUMA));
+    }
+    for (int i = width * height; i < width * height * 3 / 2; i += 2) {
+        const bool skin = rand() % 2 != 0;
+        int c;
+        do {
+            c = rand() % (256 * 256);
+        } while ((table[c] != 0) != skin);
+        nv21[i] = (uint8_t)(c >> 8);
+        nv21[i + 1] = (uint8_t)(c & 0xFF);
+    }
+}
+
+static double timeRGBA(SkinSumsRowRGBA row, const std::vector<uint8_t> &rgba, int stride, int x, int y, int width, int height) {
+    const uint8_t *table = skinChromaTable();
+    return timeMs([&]() {
+        SkinSums sums;
+        memset(&sums, 0, sizeof(sums));
+        for (int j = y; j < y + height; j++) {
+            row(&rgba[j * stride + 4 * x], table, 0, width, sums);
+        }
+    }, CALLS);
+}
+
+static double timeNV21(SkinSumsRowNV21 row, const std::vector<uint8_t> &nv21, int stride, int frameHeight,
+                       int x, int y, int width, int height) {
+    const uint8_t *table = skinChromaTable();
+    const uint8_t *vu = &nv21[stride * frameHeight];
+    std::vector<uint8_t> skin(stride / 2 + 16);
+    return timeMs([&]() {
+        SkinSums sums;
+        memset(&sums, 0, sizeof(sums));
+        // Classification of the pairs included, as in skinSumsNV21
+        for (int j = y; j < y + height; j++) {
+            const uint8_t *pairs = vu + (j >> 1) * stride;
+            if (j == y || !(j & 1)) {
+                for (int c = x >> 1; c < (x + width + 1) >> 1; c++) {
+                    skin[c] = table[pairs[2 * c] * 256 + pairs[2 * c + 1]];
+                }
+            }
+            row(&nv21[j * stride], pairs, &skin[0], x, x + width, sums);
+        }
+    }, CALLS);
+}
+
+int main() {
+
+    srand(1);
+    const Size sizes[] = {{1280, 720}, {1920, 1080}};
+
+    printf("Mean time per frame\n");
+    printf("%-10s %-6s %-8s %10s %10s\n", "frame", "area", "kernel", "RGBA", "NV21");
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+
+        const int width = sizes[s].width, height = sizes[s].height;
+        std::vector<uint8_t> rgba, nv21;
+        fillRGBA(rgba, width * height);
+        fillNV21(nv21, width, height);
+
+        // Whole frame, and a face box of a third of its height
+        const int face = height / 3;
+        const int areas[2][4] = {{0, 0, width, height}, {width / 2 - face / 2, height / 3, face, face}};
+        const char *areaNames[] = {"frame", "face"};
+
+        for (int a = 0; a < 2; a++) {
+            const int *r = areas[a];
+            char frame[16];
+            snprintf(frame, sizeof(frame), "%dx%d", width, height);
+            printf("%-10s %-6s %-8s %7.3f ms %7.3f ms\n", frame, areaNames[a], "c",
+                   timeRGBA(skinSumsRowRGBA_c, rgba, 4 * width, r[0], r[1], r[2], r[3]),
+                   timeNV21(skinSumsRowNV21_c, nv21, width, height, r[0], r[1], r[2], r[3]));
+#if defined(__SSE2__)
+            printf("%-10s %-6s %-8s %7.3f ms %7.3f ms\n", frame, areaNames[a], "sse2",
+                   timeRGBA(skinSumsRowRGBA_sse2, rgba, 4 * width, r[0], r[1], r[2], r[3]),
+                   timeNV21(skinSumsRowNV21_sse2, nv21, width, height, r[0], r[1], r[2], r[3]));
+#endif
+#if defined(HAVE_NEON)
+            printf("%-10s %-6s %-8s %7.3f ms %7.3f ms\n", frame, areaNames[a], "neon",
+                   timeRGBA(skinSumsRowRGBA_neon, rgba, 4 * width, r[0], r[1], r[2], r[3]),
+                   timeNV21(skinSumsRowNV21_neon, nv21, width, height, r[0], r[1], r[2], r[3]));
+#endif
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,211 @@
+//
+//  skin_test.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+//  Host test of the skin module: the SIMD row kernels against the scalar reference, and
+//  skinSumsNV21 and skinSumsRGBA over rectangles at odd and even offsets against a per-pixel sum.
+//
+//    g++ -std=c++11 -O2 -msse2 -I../../main/jni skin_test.cpp ../../main/jni/skin.cpp -o skin_test
+//
+//  The NEON kernels build on hosts without NEON against the scalar intrinsics in neon/:
+//
+//    g++ -std=c++11 -O2 -DHAVE_NEON -Ineon -I../../main/jni skin_test.cpp ../../main/jni/skin.cpp
+//        ../../main/jni/skin_neon.cpp -o skin_test_neon
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+#include "harness.hpp"
+#include "skin.hpp"
+
+#define MAX_WIDTH 67
+#define PADDING 16          // The kernels may read a vector past the end of a row
+#define FRAME_WIDTH 64
+#define FRAME_HEIGHT 48
+
+static bool equal(const SkinSums &a, const SkinSums &b) {
+    return a.sum[0] == b.sum[0] && a.sum[1] == b.sum[1] && a.sum[2] == b.sum[2] && a.count == b.count;
+}
+
+// Luma around the thresholds half of the time
+static uint8_t randomLuma() {
+    if (rand() % 2) {
+        const int edges[] = {SKIN_MIN_LUMA, SKIN_MAX_LUMA};
+        return (uint8_t)(edges[rand() % 2] + rand() % 3 - 1);
+    }
+    return (uint8_t)(rand() % 256);
+}
+
+static void checkRowKernel(SkinSumsRowNV21 row) {
+    for (int width = 1; width <= MAX_WIDTH; width++) {
+        std::vector<uint8_t> luma(width + PADDING), vu(width + 1 + PADDING), skin(width / 2 + 1 + PADDING);
+        for (int i = 0; i < width; i++) {
+            luma[i] = randomLuma();
+        }
+        for (size_t i = 0; i < vu.size(); i++) {
+            vu[i] = (uint8_t)(rand() % 256);
+        }
+        for (size_t i = 0; i < skin.size(); i++) {
+            skin[i] = rand() % 3 ? 0xFF : 0;
+        }
+        for (int x = 0; x < std::min(width, 5); x++) {
+            SkinSums sums, reference;
+            memset(&sums, 0, sizeof(sums));
+            memset(&reference, 0, sizeof(reference));
+            row(&luma[0], &vu[0], &skin[0], x, width, sums);
+            skinSumsRowNV21_c(&luma[0], &vu[0], &skin[0], x, width, reference);
+            CHECK(equal(sums, reference));
+        }
+    }
+}
+
+// RGBA pixels, a third of them skin and some of those at the luma thresholds
+static void randomRGBA(uint8_t *p, int pixels) {
+    static std::vector<uint32_t> skinColors;
+    if (skinColors.empty()) {
+        const uint8_t *table = skinChromaTable();
+        while (skinColors.size() < 1000) {
+            uint8_t c[4] = {(uint8_t)(rand() % 256), (uint8_t)(rand() % 256), (uint8_t)(rand() % 256), 255};
+            SkinSums sums;
+            memset(&sums, 0, sizeof(sums));
+            skinSumsRowRGBA_c(c, table, 0, 1, sums);
+            if (sums.count) {
+                skinColors.push_back(c[0] | c[1] << 8 | c[2] << 16 | 0xFF000000u);
+            }
+        }
+    }
+    for (int i = 0; i < pixels; i++, p += 4) {
+        if (rand() % 3) {
+            p[0] = (uint8_t)(rand() % 256);
+            p[1] = (uint8_t)(rand() % 256);
+            p[2] = (uint8_t)(rand() % 256);
+        } else {
+            const uint32_t c = skinColors[rand() % skinColors.size()];
+            const int shade = rand() % 2 ? 0 : rand() % 41 - 20;
+            p[0] = (uint8_t)std::max(0, std::min(255, (int)(c & 0xFF) + shade));
+            p[1] = (uint8_t)std::max(0, std::min(255, (int)(c >> 8 & 0xFF) + shade));
+            p[2] = (uint8_t)std::max(0, std::min(255, (int)(c >> 16 & 0xFF) + shade));
+        }
+        p[3] = 255;
+    }
+}
+
+static void checkRowKernelRGBA(SkinSumsRowRGBA row) {
+    const uint8_t *table = skinChromaTable();
+    for (int width = 1; width <= MAX_WIDTH; width++) {
+        std::vector<uint8_t> rgba(4 * width + PADDING);
+        randomRGBA(&rgba[0], width);
+        for (int x = 0; x < std::min(width, 5); x++) {
+            SkinSums sums, reference;
+            memset(&sums, 0, sizeof(sums));
+            memset(&reference, 0, sizeof(reference));
+            row(&rgba[0], table, x, width, sums);
+            skinSumsRowRGBA_c(&rgba[0], table, x, width, reference);
+            CHECK(equal(sums, reference));
+        }
+    }
+}
+
+static void checkRectangles() {
+
+    const uint8_t *table = skinChromaTable();
+    std::vector<int> skinPairs;
+    for (int c = 0; c < 256 * 256; c++) {
+        if (table[c]) {
+            skinPairs.push_back(c);
+        }
+    }
+    CHECK(!skinPairs.empty());
+
+    // Half of the VU pairs in the skin cluster
+    std::vector<uint8_t> frame(FRAME_WIDTH * FRAME_HEIGHT * 3 / 2 + PADDING, 0);
+    for (int i = 0; i < FRAME_WIDTH * FRAME_HEIGHT; i++) {
+        frame[i] = randomLuma();
+    }
+    for (int i = FRAME_WIDTH * FRAME_HEIGHT; i < FRAME_WIDTH * FRAME_HEIGHT * 3 / 2; i += 2) {
+        const int c = rand() % 2 ? skinPairs[rand() % skinPairs.size()] : rand() % (256 * 256);
+        frame[i] = (uint8_t)(c >> 8);
+        frame[i + 1] = (uint8_t)(c & 0xFF);
+    }
+    const uint8_t *luma = &frame[0];
+    const uint8_t *vu = luma + FRAME_WIDTH * FRAME_HEIGHT;
+
+    uint64_t skinPixels = 0;
+    for (int k = 0; k < 200; k++) {
+        const int x = rand() % (FRAME_WIDTH - 1), y = rand() % (FRAME_HEIGHT - 1);
+        const int width = 1 + rand() % (FRAME_WIDTH - x), height = 1 + rand() % (FRAME_HEIGHT - y);
+
+        SkinSums sums, reference;
+        memset(&sums, 0, sizeof(sums));
+        memset(&reference, 0, sizeof(reference));
+        skinSumsNV21(luma, FRAME_WIDTH, vu, FRAME_WIDTH, x, y, width, height, sums);
+
+        for (int j = y; j < y + height; j++) {
+            for (int i = x; i < x + width; i++) {
+                const uint8_t l = luma[j * FRAME_WIDTH + i];
+                const uint8_t *pair = vu + (j / 2) * FRAME_WIDTH + (i / 2) * 2;
+                if (table[pair[0] * 256 + pair[1]] && l >= SKIN_MIN_LUMA && l <= SKIN_MAX_LUMA) {
+                    reference.sum[0] += l;
+                    reference.sum[1] += pair[0];
+                    reference.sum[2] += pair[1];
+                    reference.count++;
+                }
+            }
+        }
+        CHECK(equal(sums, reference));
+        skinPixels += reference.count;
+    }
+    printf("rectangles: %llu skin pixels\n", (unsigned long long)skinPixels);
+    CHECK(skinPixels > 0);
+}
+
+static void checkRectanglesRGBA() {
+
+    const uint8_t *table = skinChromaTable();
+    std::vector<uint8_t> frame(FRAME_WIDTH * FRAME_HEIGHT * 4 + PADDING);
+    randomRGBA(&frame[0], FRAME_WIDTH * FRAME_HEIGHT);
+
+    uint64_t skinPixels = 0;
+    for (int k = 0; k < 200; k++) {
+        const int x = rand() % (FRAME_WIDTH - 1), y = rand() % (FRAME_HEIGHT - 1);
+        const int width = 1 + rand() % (FRAME_WIDTH - x), height = 1 + rand() % (FRAME_HEIGHT - y);
+
+        SkinSums sums, reference;
+        memset(&sums, 0, sizeof(sums));
+        memset(&reference, 0, sizeof(reference));
+        skinSumsRGBA(&frame[0], FRAME_WIDTH * 4, x, y, width, height, sums);
+
+        for (int j = y; j < y + height; j++) {
+            for (int i = x; i < x + width; i++) {
+                skinSumsRowRGBA_c(&frame[(j * FRAME_WIDTH + i) * 4], table, 0, 1, reference);
+            }
+        }
+        CHECK(equal(sums, reference));
+        skinPixels += reference.count;
+    }
+    printf("RGBA rectangles: %llu skin pixels\n", (unsigned long long)skinPixels);
+    CHECK(skinPixels > 0);
+}
+
+int main() {
+
+    srand(1);
+
+#if defined(__SSE2__)
+    checkRowKernel(skinSumsRowNV21_sse2);
+    checkRowKernelRGBA(skinSumsRowRGBA_sse2);
+#endif
+#if defined(HAVE_NEON)
+    checkRowKernel(skinSumsRowNV21_neon);
+    checkRowKernelRGBA(skinSumsRowRGBA_neon);
+#endif
+    checkRectangles();
+    checkRectanglesRGBA();
+
+    return report("skin_test");
+}
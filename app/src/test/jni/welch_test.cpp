@@ -0,0 +1,144 @@
+//
+//  welch_test.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+//  Host test of the Welch segments as RPPG drives them: a sliding window of camera frames with
+//  jittered timestamps and dropped frames, so that the measured frame rate changes every frame.
+//  Segment length and band must stay fixed, segments must accumulate half a segment apart up to
+//  what the window holds, and the mean must be that of the segments still in the window.
+//
+//    g++ -std=c++11 -O2 -I../../main/jni welch_test.cpp ../../main/jni/Welch.cpp -o welch_test
+//
+
+#include <stdlib.h>
+#include <math.h>
+#include <deque>
+#include <vector>
+#include <algorithm>
+
+#include "harness.hpp"
+#include "Welch.hpp"
+
+#define FRAMES 3000
+#define FPS 30
+#define JITTER_MS 8             // Timestamps vary by up to this much either way
+#define DROP_RATE 20            // One frame in this many is dropped
+#define MAX_SIGNAL_SIZE 6       // Seconds in the window, as in Main
+#define SEGMENT_SECONDS 2
+#define LOW_BPM 42              // As in RPPG
+#define HIGH_BPM 240
+
+struct Run {
+    int length;
+    int low;
+    int high;
+    int minFps100;          // Measured frame rate range, in 1/100 fps
+    int maxFps100;
+    int mostSegments;
+};
+
+static Run run(unsigned seed) {
+
+    srand(seed);
+    Welch welch;
+    std::deque<double> times;                   // Window of frame times (s)
+    std::deque<std::pair<int64_t, double> > added;  // End and value of each segment added
+    Run r = {0, 0, 0, 1 << 30, 0, 0};
+    int64_t samples = 0;
+    double time = 0;
+
+    for (int frame = 0; frame < FRAMES; frame++) {
+
+        time += 1.0 / FPS + (rand() % (2 * JITTER_MS + 1) - JITTER_MS) / 1000.0;
+        if (rand() % DROP_RATE == 0) {
+            time += 1.0 / FPS;
+        }
+        times.push_back(time);
+        samples++;
+
+        // Window trimmed by time as RPPG does, frame rate measured over it
+        while (times.back() - times.front() > MAX_SIGNAL_SIZE) {
+            times.pop_front();
+        }
+        const int total = (int)times.size();
+        if (total < 2) {
+            continue;
+        }
+        const double fps = (total - 1) / (times.back() - times.front());
+        r.minFps100 = std::min(r.minFps100, (int)(fps * 100));
+        r.maxFps100 = std::max(r.maxFps100, (int)(fps * 100));
+
+        const int before = welch.segmentCount();
+        const bool due = welch.advance(fps, SEGMENT_SECONDS, LOW_BPM, HIGH_BPM, samples, total);
+        if (welch.segmentLength() == 0) {
+            CHECK(!due);
+            continue;
+        }
+
+        // Fixed by the first window that covers a segment
+        if (r.length == 0) {
+            r.length = welch.segmentLength();
+            r.low = welch.bandLow();
+            r.high = welch.bandHigh();
+            CHECK(due);
+        }
+        CHECK(welch.segmentLength() == r.length);
+        CHECK(welch.bandLow() == r.low);
+        CHECK(welch.bandHigh() == r.high);
+
+        // Only segments that started before the window are dropped
+        while (!added.empty() && added.front().first - r.length < samples - total) {
+            added.pop_front();
+        }
+        CHECK(welch.segmentCount() == (int)added.size());
+        CHECK(welch.segmentCount() >= before - 1);
+
+        if (due) {
+            CHECK(added.empty() || samples - added.back().first == std::max(r.length / 2, 1));
+            const double value = (double)samples;
+            welch.add(std::vector<double>(r.high - r.low + 1, value));
+            added.push_back(std::make_pair(samples, value));
+        }
+
+        // A window holds every segment that fits into it, half a segment apart
+        if (frame > 2 * MAX_SIGNAL_SIZE * FPS) {
+            CHECK(welch.segmentCount() >= (total - r.length) / std::max(r.length / 2, 1));
+        }
+        r.mostSegments = std::max(r.mostSegments, welch.segmentCount());
+
+        std::vector<double> mean;
+        welch.mean(mean);
+        double expected = 0;
+        for (size_t i = 0; i < added.size(); i++) {
+            expected += added[i].second;
+        }
+        expected /= std::max(added.size(), (size_t)1);
+        CHECK(mean.size() == (added.empty() ? 0 : (size_t)(r.high - r.low + 1)));
+        CHECK(mean.empty() || fabs(mean[0] - expected) <= 1e-9 * expected);
+    }
+    return r;
+}
+
+int main() {
+
+    for (unsigned seed = 1; seed <= 5; seed++) {
+        const Run r = run(seed);
+        printf("seed %u: %.2f-%.2f fps, segment %d samples, band %d-%d, up to %d segments\n", seed,
+               r.minFps100 / 100.0, r.maxFps100 / 100.0, r.length, r.low, r.high, r.mostSegments);
+        CHECK(r.length > 0 && r.high > r.low);
+        CHECK(r.mostSegments >= (MAX_SIGNAL_SIZE - SEGMENT_SECONDS) * 2 / SEGMENT_SECONDS);
+    }
+
+    // Cleared state is set up again
+    Welch welch;
+    CHECK(welch.advance(FPS, SEGMENT_SECONDS, LOW_BPM, HIGH_BPM, 100, 100));
+    welch.add(std::vector<double>(3, 1.0));
+    welch.clear();
+    CHECK(welch.segmentLength() == 0 && welch.segmentCount() == 0);
+    CHECK(welch.advance(FPS / 2, SEGMENT_SECONDS, LOW_BPM, HIGH_BPM, 100, 100));
+    CHECK(welch.segmentLength() == SEGMENT_SECONDS * FPS / 2);
+
+    return report("welch_test");
+}
@@ -0,0 +1,128 @@
+//
+//  window_bench.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+//  Time to the first result and CPU per frame against the signal window length, with and
+//  without spectral zoom, on a recording made by the app. Each window length is run with
+//  minSignalSize = maxSignalSize, so the first result comes as soon as one window is filled.
+//  RPPG runs single-threaded on the calling thread, whose CPU time is measured.
+//
+//    g++ -std=c++11 -O2 -pthread -I../../main/jni window_bench.cpp ../../main/jni/RPPG.cpp
+//        ../../main/jni/ThreadPool.cpp ../../main/jni/FrameHistory.cpp ../../main/jni/CascadeRegistry.cpp
+//        ../../main/jni/HaarCascade.cpp ../../main/jni/opencv.cpp ../../main/jni/similarity.cpp
+//        ../../main/jni/skin.cpp ../../main/jni/signal.cpp ../../main/jni/ChirpZ.cpp
+//        ../../main/jni/RunningStatistics.cpp ../../main/jni/Welch.cpp ../../main/jni/FFmpegDecoder.cpp ../../main/jni/yuv.cpp
+//        -o window_bench `pkg-config --cflags --libs opencv libavformat libavcodec libswscale libavutil`
+//
+//  Usage: window_bench cascade.xml recording [window seconds...]
+//
+
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "harness.hpp"
+#include "FFmpegDecoder.hpp"
+#include "RPPG.hpp"
+
+#define TIME_BASE 0.001     // Decoder timestamps are milliseconds
+#define POOL_SIZE 8
+#define SAMPLING_FREQUENCY 1
+#define RESCAN_FREQUENCY 0.2
+#define MIN_TRACKING_CONFIDENCE 0.5
+#define SPECTRAL_ZOOM 4
+
+using namespace cv;
+
+static double threadCpuMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+struct Run {
+    double firstResult;     // Seconds of the recording until the first result, negative if none
+    double cpuPerFrame;     // Milliseconds
+    double meanBpm;         // Of the last result
+    int results;
+};
+
+static bool run(const char *cascade, const char *recording, int window, int spectrum, int zoom, Run &out) {
+
+    FFmpegDecoder decoder;
+    if (!decoder.OpenFile(recording, POOL_SIZE, 1)) {
+        return false;
+    }
+
+    out.firstResult = -1;
+    out.meanBpm = 0;
+    out.results = 0;
+    const int64_t start = decoder.GetStartTime();
+    RPPG::ResultCallback callback = [&out, start](int64_t time, int id, int algorithm, double meanBpm, double minBpm, double maxBpm,
+                                                  double medianBpm, const std::vector<double> &quantileBpms, double snr) {
+        if (out.results++ == 0) {
+            out.firstResult = (time - start) * TIME_BASE;
+        }
+        out.meanBpm = meanBpm;
+    };
+
+    RPPG rppg;
+    rppg.load(callback, g, false, decoder.GetWidth(), decoder.GetHeight(), TIME_BASE, 1,
+              SAMPLING_FREQUENCY, RESCAN_FREQUENCY, MIN_TRACKING_CONFIDENCE,
+              window, window, 0, spectrum, zoom, 0, std::vector<double>(),
+              false, true, 0, true,
+              1, 1, "", cascade, "", false, false);
+
+    Mat frameRGB;
+    Mat frameNV21(decoder.GetHeight() * 3 / 2, decoder.GetWidth(), CV_8UC1);
+    int64_t time;
+    int frames = 0;
+    double cpu = 0;
+    while (decoder.ReadFrame(frameNV21.data, time)) {
+        const double before = threadCpuMs();
+        rppg.processFrameNV21(frameRGB, frameNV21, time);
+        cpu += threadCpuMs() - before;
+        frames++;
+    }
+    out.cpuPerFrame = frames > 0 ? cpu / frames : 0;
+
+    rppg.exit();
+    decoder.CloseFile();
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc < 3) {
+        fprintf(stderr, "Usage: window_bench cascade.xml recording [window seconds...]\n");
+        return 1;
+    }
+
+    std::vector<int> windows;
+    for (int i = 3; i < argc; i++) {
+        windows.push_back(atoi(argv[i]));
+    }
+    if (windows.empty()) {
+        const int defaults[] = {2, 3, 4, 6, 8, 10};
+        windows.assign(defaults, defaults + sizeof(defaults) / sizeof(defaults[0]));
+    }
+
+    printf("%-8s %-12s %14s %14s %10s %8s\n", "window", "spectrum", "first result", "cpu/frame", "last bpm", "results");
+    for (size_t i = 0; i < windows.size(); i++) {
+        for (int zoomed = 0; zoomed < 2; zoomed++) {
+            Run r;
+            if (!run(argv[1], argv[2], windows[i], zoomed ? chirpz : fft, zoomed ? SPECTRAL_ZOOM : 1, r)) {
+                fprintf(stderr, "Could not open %s\n", argv[2]);
+                return 1;
+            }
+            printf("%-6d s  %-12s %12.2f s %11.3f ms %10.1f %8d\n", windows[i], zoomed ? "chirpz x4" : "fft",
+                   r.firstResult, r.cpuPerFrame, r.meanBpm, r.results);
+        }
+    }
+
+    return 0;
+}
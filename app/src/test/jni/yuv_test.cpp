@@ -0,0 +1,224 @@
+//
+//  yuv_test.cpp
+//  Heartbeat
+//
+//  Copyright © 2016 Philipp Roüast. All rights reserved.
+//
+//  Host test of the yuv module: the SIMD kernels against the scalar reference, and
+//  rgbaToYuv420p against BT.601 evaluated in double. With -DHAVE_SWSCALE it is also compared
+//  with the swscale conversion FFmpegEncoder used before (SWS_BILINEAR).
+//
+//    g++ -std=c++11 -O2 -msse2 -I../../main/jni yuv_test.cpp ../../main/jni/yuv.cpp -o yuv_test
+//        [-DHAVE_SWSCALE `pkg-config --cflags --libs libswscale libavutil`]
+//
+//  The NEON kernels build on hosts without NEON against the scalar intrinsics in neon/:
+//
+//    g++ -std=c++11 -O2 -DHAVE_NEON -Ineon -I../../main/jni yuv_test.cpp ../../main/jni/yuv.cpp
+//        ../../main/jni/yuv_neon.cpp -o yuv_test_neon
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#if defined(HAVE_SWSCALE)
+extern "C" {
+#include <libswscale/swscale.h>
+}
+#endif
+
+#include "harness.hpp"
+#include "yuv.hpp"
+
+// Largest difference to BT.601 in double, in code values, on any content. The kernels use
+// 8-bit coefficients and round the 2x2 average before converting it, each worth up to half a value.
+#define MAX_EXACT_DIFF 1
+
+// Largest difference to swscale in code values. Luma only rounds differently.
+// swscale filters chroma over a wider support than the 2x2 block: on camera-like content
+// that is within one value, on per-pixel noise it differs by tens of values and is not checked.
+#define MAX_LUMA_DIFF 1
+#define MAX_CHROMA_DIFF 2
+#define MEAN_CHROMA_DIFF 0.25
+
+static std::vector<uint8_t> noise(int size, unsigned seed) {
+    std::vector<uint8_t> data(size);
+    srand(seed);
+    for (int i = 0; i < size; i++) {
+        data[i] = (uint8_t)(rand() & 0xff);
+    }
+    return data;
+}
+
+// Smooth gradients with mild sensor noise, as from the camera
+static std::vector<uint8_t> scene(int width, int height, unsigned seed) {
+    std::vector<uint8_t> data(width * height * 4);
+    srand(seed);
+    for (int j = 0; j < height; j++) {
+        for (int i = 0; i < width; i++) {
+            uint8_t *p = &data[(j * width + i) * 4];
+            const double s = sin(i * 0.05) * cos(j * 0.03);
+            const int n = (rand() % 5) - 2;
+            p[0] = (uint8_t)std::min(255.0, std::max(0.0, 150 + 80 * s + n));
+            p[1] = (uint8_t)std::min(255.0, std::max(0.0, 110 + 60 * s * s + n));
+            p[2] = (uint8_t)std::min(255.0, std::max(0.0, 90 + 50 * cos(i * 0.02 + j * 0.04) + n));
+            p[3] = 255;
+        }
+    }
+    return data;
+}
+
+static void checkKernel(RgbaToYuv420pRows kernel) {
+    for (int width = 1; width <= 67; width++) {
+        const std::vector<uint8_t> src = noise(2 * width * 4, width);
+        const int chroma = (width + 1) / 2;
+        for (int x = 0; x < width; x += 2) {
+            std::vector<uint8_t> y0(width, 0), y1(width, 0), u(chroma, 0), v(chroma, 0);
+            std::vector<uint8_t> y0_c(y0), y1_c(y1), u_c(u), v_c(v);
+            kernel(&src[0], &src[width * 4], &y0[0], &y1[0], &u[0], &v[0], x, width);
+            rgbaToYuv420pRows_c(&src[0], &src[width * 4], &y0_c[0], &y1_c[0], &u_c[0], &v_c[0], x, width);
+            CHECK(y0 == y0_c && y1 == y1_c && u == u_c && v == v_c);
+        }
+    }
+}
+
+static void checkVU(SplitVURow split, MergeVURow merge) {
+    for (int width = 1; width <= 67; width++) {
+        const std::vector<uint8_t> vu = noise(2 * width, width);
+        std::vector<uint8_t> u(width), v(width), u_c(width), v_c(width);
+        std::vector<uint8_t> out(2 * width, 0), out_c(2 * width, 0);
+        split(&vu[0], &u[0], &v[0], 0, width);
+        splitVURow_c(&vu[0], &u_c[0], &v_c[0], 0, width);
+        CHECK(u == u_c && v == v_c);
+        merge(&u[0], &v[0], &out[0], 0, width);
+        mergeVURow_c(&u[0], &v[0], &out_c[0], 0, width);
+        CHECK(out == out_c && out == vu);
+    }
+}
+
+// Compare one plane, returns the largest difference and adds up the total
+static int planeDiff(const uint8_t *a, const uint8_t *b, int size, double &total) {
+    int worst = 0;
+    for (int i = 0; i < size; i++) {
+        const int d = abs((int)a[i] - (int)b[i]);
+        worst = std::max(worst, d);
+        total += d;
+    }
+    return worst;
+}
+
+// BT.601 limited range, chroma of the exact 2x2 average, odd sizes replicating the last column/row
+static void exactYuv420p(const std::vector<uint8_t> &src, int width, int height, std::vector<uint8_t> &yuv) {
+    const int cw = (width + 1) / 2, ch = (height + 1) / 2;
+    yuv.resize(width * height + 2 * cw * ch);
+    uint8_t *u = &yuv[width * height], *v = u + cw * ch;
+    for (int j = 0; j < height; j++) {
+        for (int i = 0; i < width; i++) {
+            const uint8_t *p = &src[(j * width + i) * 4];
+            yuv[j * width + i] = (uint8_t)lround(16 + 219.0 / 255 * (0.299 * p[0] + 0.587 * p[1] + 0.114 * p[2]));
+        }
+    }
+    for (int j = 0; j < ch; j++) {
+        for (int i = 0; i < cw; i++) {
+            double r = 0, g = 0, b = 0;
+            for (int k = 0; k < 4; k++) {
+                const int x = std::min(2 * i + (k & 1), width - 1), y = std::min(2 * j + (k >> 1), height - 1);
+                const uint8_t *p = &src[(y * width + x) * 4];
+                r += p[0] / 4.0;
+                g += p[1] / 4.0;
+                b += p[2] / 4.0;
+            }
+            u[j * cw + i] = (uint8_t)lround(128 + 224.0 / 255 * (-0.168736 * r - 0.331264 * g + 0.5 * b));
+            v[j * cw + i] = (uint8_t)lround(128 + 224.0 / 255 * (0.5 * r - 0.418688 * g - 0.081312 * b));
+        }
+    }
+}
+
+static void checkExact(int width, int height, bool smooth) {
+
+    const std::vector<uint8_t> src = smooth ? scene(width, height, width * height) : noise(width * height * 4, width);
+    const int cw = (width + 1) / 2, ch = (height + 1) / 2;
+
+    std::vector<uint8_t> yuv(width * height + 2 * cw * ch), ref;
+    uint8_t *const dst[3] = {&yuv[0], &yuv[width * height], &yuv[width * height + cw * ch]};
+    const int dstStride[3] = {width, cw, cw};
+    rgbaToYuv420p(&src[0], width * 4, dst, dstStride, width, height);
+    exactYuv420p(src, width, height, ref);
+
+    double lumaTotal = 0, chromaTotal = 0;
+    const int luma = planeDiff(&yuv[0], &ref[0], width * height, lumaTotal);
+    const int chroma = planeDiff(&yuv[width * height], &ref[width * height], 2 * cw * ch, chromaTotal);
+    printf("BT.601 %dx%d %s: luma max %d mean %.3f, chroma max %d mean %.3f\n", width, height, smooth ? "scene" : "noise",
+           luma, lumaTotal / (width * height), chroma, chromaTotal / (2 * cw * ch));
+    CHECK_LE(luma, MAX_EXACT_DIFF);
+    CHECK_LE(chroma, MAX_EXACT_DIFF);
+}
+
+#if defined(HAVE_SWSCALE)
+static void checkSwscale(int width, int height, bool smooth) {
+
+    const std::vector<uint8_t> src = smooth ? scene(width, height, width * height) : noise(width * height * 4, width);
+    const int cw = (width + 1) / 2, ch = (height + 1) / 2;
+
+    std::vector<uint8_t> yuv(width * height + 2 * cw * ch), ref(yuv.size());
+    uint8_t *const dst[3] = {&yuv[0], &yuv[width * height], &yuv[width * height + cw * ch]};
+    uint8_t *const refDst[4] = {&ref[0], &ref[width * height], &ref[width * height + cw * ch], NULL};
+    const int dstStride[4] = {width, cw, cw, 0};
+
+    rgbaToYuv420p(&src[0], width * 4, dst, dstStride, width, height);
+
+    struct SwsContext *ctx = sws_getContext(width, height, AV_PIX_FMT_RGBA, width, height, AV_PIX_FMT_YUV420P,
+                                            SWS_BILINEAR, NULL, NULL, NULL);
+    const uint8_t *const srcSlice[4] = {&src[0], NULL, NULL, NULL};
+    const int srcStride[4] = {width * 4, 0, 0, 0};
+    sws_scale(ctx, srcSlice, srcStride, 0, height, refDst, dstStride);
+    sws_freeContext(ctx);
+
+    double lumaTotal = 0, chromaTotal = 0;
+    const int luma = planeDiff(dst[0], refDst[0], width * height, lumaTotal);
+    const int chroma = std::max(planeDiff(dst[1], refDst[1], cw * ch, chromaTotal),
+                                planeDiff(dst[2], refDst[2], cw * ch, chromaTotal));
+    printf("swscale %dx%d %s: luma max %d mean %.3f, chroma max %d mean %.3f\n", width, height, smooth ? "scene" : "noise",
+           luma, lumaTotal / (width * height), chroma, chromaTotal / (2 * cw * ch));
+    CHECK_LE(luma, MAX_LUMA_DIFF);
+    if (smooth) {
+        CHECK_LE(chroma, MAX_CHROMA_DIFF);
+        CHECK_LE(chromaTotal / (2 * cw * ch), MEAN_CHROMA_DIFF);
+    }
+}
+#endif
+
+int main() {
+
+#if defined(__SSE2__)
+    checkKernel(rgbaToYuv420pRows_sse2);
+    checkVU(splitVURow_sse2, mergeVURow_sse2);
+#endif
+#if defined(HAVE_AVX2)
+    if (hasAvx2()) {
+        checkKernel(rgbaToYuv420pRows_avx2);
+        checkVU(splitVURow_avx2, mergeVURow_avx2);
+    } else {
+        printf("AVX2 kernels not checked, the CPU has no AVX2\n");
+    }
+#endif
+#if defined(HAVE_NEON)
+    checkKernel(rgbaToYuv420pRows_neon);
+    checkVU(splitVURow_neon, mergeVURow_neon);
+#endif
+
+    checkExact(640, 480, true);
+    checkExact(1280, 720, true);
+    checkExact(1280, 720, false);
+    checkExact(67, 33, false);
+
+#if defined(HAVE_SWSCALE)
+    checkSwscale(640, 480, true);
+    checkSwscale(1280, 720, true);
+    checkSwscale(1280, 720, false);
+#endif
+
+    return report("yuv_test");
+}